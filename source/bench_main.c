@@ -0,0 +1,467 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "diagnostics.h"
+#include "distributions.h"
+#include "sorting.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+/**
+ * The max number of values of a list option.
+ */
+#define MAX_LIST_VALUES 32
+
+/**
+ * Specifies the benchmarked algorithms.
+ */
+typedef enum BenchAlgorithmId
+{
+    BENCH_MERGESORT = 0,
+    BENCH_QUICKSORT,
+    BENCH_BININSSORT,
+    BENCH_MERGEBININSSORT,
+    BENCH_ALGORITHM_COUNT
+} BenchAlgorithmId;
+
+/**
+ * The names of the benchmarked algorithms, indexed by BenchAlgorithmId.
+ */
+static const char *const ALGORITHM_NAMES[BENCH_ALGORITHM_COUNT] = {
+    "merge_sort",
+    "quick_sort",
+    "binary_insertion_sort",
+    "merge_binary_insertion_sort"};
+
+/**
+ * The options of the benchmark.
+ */
+typedef struct BenchOptions
+{
+    size_t sizes[MAX_LIST_VALUES];                 /** The numbers of elements. */
+    size_t num_sizes;                              /** The count of `sizes`. */
+    size_t elem_sizes[MAX_LIST_VALUES];            /** The element sizes, in bytes. */
+    size_t num_elem_sizes;                         /** The count of `elem_sizes`. */
+    DistributionId distributions[MAX_LIST_VALUES]; /** The input distributions. */
+    size_t num_distributions;                      /** The count of `distributions`. */
+    int algorithms[BENCH_ALGORITHM_COUNT];         /** Whether each algorithm is benchmarked. */
+    size_t threshold;                              /** The threshold of merge binary insertion sort. */
+    size_t repetitions;                            /** The number of timed repetitions of each run. */
+    uint64_t seed;                                 /** The seed of the input generator. */
+    int cpu;                                       /** The CPU the benchmark is pinned to (-1 to not pin). */
+    double max_seconds;                            /** The max predicted duration of a single repetition. */
+    size_t max_memory;                             /** The max memory used by the input and working arrays. */
+} BenchOptions;
+
+/**
+ * Gets a pointer to the element at the specified index inside the specified array.
+ */
+#define GET_ELEMENT(base, index, size) ((void *)(((unsigned char *)(base)) + (index) * (size)))
+
+/**
+ * Compares two elements by their key, stored in the first 4 bytes.
+ */
+static int key_comparator(const void *left, const void *right)
+{
+    uint32_t a = *(const uint32_t *)left;
+    uint32_t b = *(const uint32_t *)right;
+
+    return (a > b) - (a < b);
+}
+
+/**
+ * Compares two doubles (used to compute the median of the timings).
+ */
+static int double_comparator(const void *left, const void *right)
+{
+    double a = *(const double *)left;
+    double b = *(const double *)right;
+
+    return (a > b) - (a < b);
+}
+
+/**
+ * Reads a monotonic clock, in nanoseconds.
+ */
+static double get_time_ns(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER counter, frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif
+}
+
+/**
+ * Pins the calling thread to the specified CPU.
+ */
+static void pin_to_cpu(int cpu)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    if (sched_setaffinity(0, sizeof(set), &set))
+        printf("# Unable to pin the benchmark to CPU %d, timings may be noisier.\n", cpu);
+#elif defined(_WIN32)
+    if (!SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu))
+        printf("# Unable to pin the benchmark to CPU %d, timings may be noisier.\n", cpu);
+#else
+    printf("# CPU pinning is not supported on this platform, timings may be noisier.\n");
+    (void)cpu;
+#endif
+}
+
+/**
+ * Fills the input array with elements whose keys follow the specified distribution.
+ */
+static void generate_input(void *input, size_t nitems, size_t elem_size, DistributionId distribution_id, uint64_t seed)
+{
+    Distribution *distribution;
+    uint32_t key;
+    size_t i;
+
+    distribution = create_distribution(distribution_id, nitems, NULL, seed);
+    memset(input, 0, nitems * elem_size);
+
+    for (i = 0; i < nitems; i++)
+    {
+        key = (uint32_t)distribution_value(distribution, i);
+        memcpy(GET_ELEMENT(input, i, elem_size), &key, sizeof(key));
+    }
+
+    destroy_distribution(distribution);
+}
+
+/**
+ * Runs the specified algorithm over the array.
+ */
+static void run_algorithm(BenchAlgorithmId algorithm_id, void *base, size_t nitems, size_t elem_size, size_t threshold)
+{
+    switch (algorithm_id)
+    {
+    case BENCH_MERGESORT:
+        merge_sort(base, nitems, elem_size, key_comparator);
+        return;
+    case BENCH_QUICKSORT:
+        quick_sort(base, nitems, elem_size, key_comparator);
+        return;
+    case BENCH_BININSSORT:
+        binary_insertion_sort(base, nitems, elem_size, key_comparator);
+        return;
+    case BENCH_MERGEBININSSORT:
+        merge_binary_insertion_sort(base, nitems, elem_size, threshold, key_comparator);
+        return;
+    case BENCH_ALGORITHM_COUNT:
+        break;
+    }
+
+    UNREACHABLE();
+}
+
+/**
+ * Returns 1 if the array is sorted, 0 otherwise.
+ */
+static int is_sorted(const void *base, size_t nitems, size_t elem_size)
+{
+    size_t i;
+
+    for (i = 1; i < nitems; i++)
+    {
+        if (key_comparator(GET_ELEMENT(base, i - 1, elem_size), GET_ELEMENT(base, i, elem_size)) > 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * The timings of the previous runs of an (algorithm, element size, distribution) series, used to predict the
+ * duration of the next run and skip the ones that would take too long (e.g., quadratic algorithms on large inputs).
+ */
+typedef struct SeriesHistory
+{
+    size_t last_nitems[2]; /** The sizes of the last two runs (0 if not run). */
+    double last_ns[2];     /** The durations of the last two runs. */
+} SeriesHistory;
+
+/**
+ * Predicts the duration of a run over `nitems` elements, extrapolating the growth of the previous runs.
+ */
+static double predict_seconds(const SeriesHistory *history, size_t nitems)
+{
+    double exponent;
+
+    if (!history->last_nitems[1])
+        return 0;
+
+    exponent = 2;
+
+    if (history->last_nitems[0] && history->last_ns[0] > 0 && history->last_ns[1] > 0)
+    {
+        exponent = log(history->last_ns[1] / history->last_ns[0]) / log((double)history->last_nitems[1] / (double)history->last_nitems[0]);
+        exponent = exponent < 1 ? 1 : (exponent > 2 ? 2 : exponent);
+    }
+
+    return history->last_ns[1] * pow((double)nitems / (double)history->last_nitems[1], exponent) / 1e9;
+}
+
+/**
+ * Benchmarks the algorithm over the input, printing the results.
+ */
+static void bench_run(BenchAlgorithmId algorithm_id, const void *input, void *work, size_t nitems, size_t elem_size,
+                      DistributionId distribution_id, const BenchOptions *options, SeriesHistory *history)
+{
+    double times[MAX_LIST_VALUES], start, predicted;
+    size_t rep;
+
+    predicted = predict_seconds(history, nitems);
+
+    if (predicted > options->max_seconds)
+    {
+        printf("%s,%zu,%s,%zu,skipped (predicted %.0f s per repetition)\n", ALGORITHM_NAMES[algorithm_id], elem_size,
+               get_distribution_name(distribution_id), nitems, predicted);
+        return;
+    }
+
+    for (rep = 0; rep < options->repetitions; rep++)
+    {
+        memcpy(work, input, nitems * elem_size);
+
+        start = get_time_ns();
+        run_algorithm(algorithm_id, work, nitems, elem_size, options->threshold);
+        times[rep] = get_time_ns() - start;
+
+        if (rep == 0)
+            ASSERT(is_sorted(work, nitems, elem_size), "The benchmarked algorithm did not sort the array", bench_run);
+    }
+
+    merge_sort(times, options->repetitions, sizeof(double), double_comparator);
+
+    printf("%s,%zu,%s,%zu,%.3f,%.3f\n", ALGORITHM_NAMES[algorithm_id], elem_size, get_distribution_name(distribution_id),
+           nitems, times[0] / (double)nitems, times[options->repetitions / 2] / (double)nitems);
+    fflush(stdout);
+
+    history->last_nitems[0] = history->last_nitems[1];
+    history->last_ns[0] = history->last_ns[1];
+    history->last_nitems[1] = nitems;
+    history->last_ns[1] = times[0];
+}
+
+/**
+ * Runs the whole benchmark suite.
+ */
+static void bench_execution(const BenchOptions *options)
+{
+    SeriesHistory history[BENCH_ALGORITHM_COUNT];
+    void *input, *work;
+    size_t e, d, s, elem_size, nitems;
+    int a;
+
+    printf("algorithm,elem_size,distribution,n,min_ns_per_elem,median_ns_per_elem\n");
+
+    for (e = 0; e < options->num_elem_sizes; e++)
+    {
+        elem_size = options->elem_sizes[e];
+
+        for (d = 0; d < options->num_distributions; d++)
+        {
+            memset(history, 0, sizeof(history));
+
+            for (s = 0; s < options->num_sizes; s++)
+            {
+                nitems = options->sizes[s];
+
+                // The input, the working copy and the merge scratch memory.
+                if (nitems * elem_size > options->max_memory / 3)
+                {
+                    printf("# Skipping n=%zu with %zu-byte elements (exceeds the memory limit).\n", nitems, elem_size);
+                    continue;
+                }
+
+                input = malloc(nitems * elem_size);
+                work = malloc(nitems * elem_size);
+                ASSERT(input && work, "Unable to allocate memory for the benchmark arrays", bench_execution);
+
+                generate_input(input, nitems, elem_size, options->distributions[d], options->seed);
+
+                for (a = 0; a < BENCH_ALGORITHM_COUNT; a++)
+                {
+                    if (options->algorithms[a])
+                        bench_run((BenchAlgorithmId)a, input, work, nitems, elem_size, options->distributions[d], options, &history[a]);
+                }
+
+                free(input);
+                free(work);
+            }
+        }
+    }
+}
+
+/**
+ * Parses a comma separated list of sizes.
+ */
+static size_t parse_size_list(const char *list, size_t *values)
+{
+    size_t count;
+    int consumed;
+
+    count = 0;
+
+    while (*list)
+    {
+        ASSERT(count < MAX_LIST_VALUES, "Too many values in the list", parse_size_list);
+        ASSERT(sscanf(list, "%zu%n", &values[count], &consumed) == 1 && values[count] > 0, "Unable to parse a list value", parse_size_list);
+
+        count++;
+        list += consumed;
+
+        if (*list == ',')
+            list++;
+    }
+
+    return count;
+}
+
+/**
+ * Parses a comma separated list of distributions.
+ */
+static size_t parse_distribution_list(char *list, DistributionId *values)
+{
+    size_t count;
+    char *name;
+
+    count = 0;
+
+    for (name = strtok(list, ","); name; name = strtok(NULL, ","))
+    {
+        ASSERT(count < MAX_LIST_VALUES, "Too many values in the list", parse_distribution_list);
+
+        values[count] = parse_distribution_name(name);
+        ASSERT(values[count], "Unknown distribution", parse_distribution_list);
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Parses a comma separated list of algorithms.
+ */
+static void parse_algorithm_list(char *list, int *algorithms)
+{
+    char *name;
+    int a;
+
+    memset(algorithms, 0, sizeof(int) * BENCH_ALGORITHM_COUNT);
+
+    for (name = strtok(list, ","); name; name = strtok(NULL, ","))
+    {
+        for (a = 0; a < BENCH_ALGORITHM_COUNT && strcmp(ALGORITHM_NAMES[a], name); a++)
+            ;
+
+        ASSERT(a < BENCH_ALGORITHM_COUNT, "Unknown algorithm", parse_algorithm_list);
+        algorithms[a] = 1;
+    }
+}
+
+/**
+ * Entry point.
+ */
+int main(int argc, char *argv[])
+{
+    static const size_t DEFAULT_SIZES[] = {16, 256, 4096, 65536, 1048576, 16777216, 100000000};
+    static const size_t DEFAULT_ELEM_SIZES[] = {4, 8, 16, 44, 128};
+    BenchOptions options;
+    size_t max_memory_mb;
+    unsigned long long seed;
+    int i;
+
+    memset(&options, 0, sizeof(options));
+
+    options.num_sizes = sizeof(DEFAULT_SIZES) / sizeof(DEFAULT_SIZES[0]);
+    memcpy(options.sizes, DEFAULT_SIZES, sizeof(DEFAULT_SIZES));
+    options.num_elem_sizes = sizeof(DEFAULT_ELEM_SIZES) / sizeof(DEFAULT_ELEM_SIZES[0]);
+    memcpy(options.elem_sizes, DEFAULT_ELEM_SIZES, sizeof(DEFAULT_ELEM_SIZES));
+
+    for (options.num_distributions = 0; options.num_distributions < DISTRIBUTION_ALL_EQUAL; options.num_distributions++)
+        options.distributions[options.num_distributions] = (DistributionId)(DISTRIBUTION_UNIFORM + options.num_distributions);
+
+    for (i = 0; i < BENCH_ALGORITHM_COUNT; i++)
+        options.algorithms[i] = 1;
+
+    options.threshold = 50;
+    options.repetitions = 5;
+    options.seed = 42;
+    options.cpu = 0;
+    options.max_seconds = 10;
+    options.max_memory = (size_t)4096 << 20;
+
+    for (i = 1; i < argc; i += 2)
+    {
+        ASSERT(i + 1 < argc, "Wrong number of arguments (option value not found)", main);
+
+        if (!strcmp(argv[i], "--sizes"))
+            options.num_sizes = parse_size_list(argv[i + 1], options.sizes);
+        else if (!strcmp(argv[i], "--elem-sizes"))
+            options.num_elem_sizes = parse_size_list(argv[i + 1], options.elem_sizes);
+        else if (!strcmp(argv[i], "--dists"))
+            options.num_distributions = parse_distribution_list(argv[i + 1], options.distributions);
+        else if (!strcmp(argv[i], "--algorithms"))
+            parse_algorithm_list(argv[i + 1], options.algorithms);
+        else if (!strcmp(argv[i], "--threshold"))
+            ASSERT(sscanf(argv[i + 1], "%zu", &options.threshold) == 1 && options.threshold > 1, "The threshold must be greater than one", main);
+        else if (!strcmp(argv[i], "--reps"))
+            ASSERT(sscanf(argv[i + 1], "%zu", &options.repetitions) == 1 && options.repetitions > 0 && options.repetitions <= MAX_LIST_VALUES, "The number of repetitions must be in range [1, 32]", main);
+        else if (!strcmp(argv[i], "--seed"))
+        {
+            ASSERT(sscanf(argv[i + 1], "%llu", &seed) == 1, "The seed has not been correctly specified", main);
+            options.seed = (uint64_t)seed;
+        }
+        else if (!strcmp(argv[i], "--cpu"))
+            ASSERT(sscanf(argv[i + 1], "%d", &options.cpu) == 1, "The CPU has not been correctly specified", main);
+        else if (!strcmp(argv[i], "--max-seconds"))
+            ASSERT(sscanf(argv[i + 1], "%lf", &options.max_seconds) == 1, "The max duration has not been correctly specified", main);
+        else if (!strcmp(argv[i], "--max-memory"))
+        {
+            ASSERT(sscanf(argv[i + 1], "%zu", &max_memory_mb) == 1, "The memory limit has not been correctly specified", main);
+            options.max_memory = max_memory_mb << 20;
+        }
+        else
+            PRINT_ERROR("Unknown option", main);
+    }
+
+    for (i = 0; i < (int)options.num_elem_sizes; i++)
+        ASSERT(options.elem_sizes[i] >= sizeof(uint32_t) && options.elem_sizes[i] % sizeof(uint32_t) == 0, "The element sizes must be multiples of 4 bytes", main);
+
+    if (options.cpu >= 0)
+        pin_to_cpu(options.cpu);
+
+    printf("# seed=%llu reps=%zu threshold=%zu cpu=%d\n", (unsigned long long)options.seed, options.repetitions, options.threshold, options.cpu);
+
+    bench_execution(&options);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,743 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "compressed-io.h"
+#include "diagnostics.h"
+#include "large-alloc.h"
+#include "records-index.h"
+#include "records-io.h"
+#include "records-sorter.h"
+#include "records-writer.h"
+#include "sorting.h"
+
+/**
+ * The path of the socket, when not specified by `--socket`.
+ */
+#define DEFAULT_SOCKET_PATH "/tmp/sortingd.sock"
+
+/**
+ * The maximum number of resident datasets.
+ */
+#define MAX_DATASETS 64
+
+/**
+ * The maximum length of a request line.
+ */
+#define MAX_REQUEST_LEN 4096
+
+/**
+ * The maximum number of words of a request (the command and its arguments).
+ */
+#define MAX_REQUEST_WORDS 8
+
+/**
+ * The number of connections waiting to be accepted.
+ */
+#define LISTEN_BACKLOG 16
+
+/**
+ * The records of an input file, kept resident between requests.
+ */
+typedef struct Dataset
+{
+    char *path;         /** The path of the input file, as requested. */
+    Record *records;    /** The records, in the order of the file. */
+    size_t num_records; /** The number of records. */
+    time_t mtime;       /** The modification time of the file when it was loaded. */
+    off_t size;         /** The size of the file when it was loaded. */
+} Dataset;
+
+/**
+ * The state of the daemon.
+ */
+typedef struct Daemon
+{
+    Dataset datasets[MAX_DATASETS]; /** The resident datasets. */
+    size_t num_datasets;            /** The number of resident datasets. */
+    Record *work;                   /** The buffer the datasets are copied to and sorted in (kept warm between requests). */
+    size_t work_capacity;           /** The number of records of the work buffer. */
+    int stopping;                   /** Whether a `SHUTDOWN` request has been received. */
+} Daemon;
+
+/**
+ * A name of a field or algorithm id, as accepted by the requests.
+ */
+typedef struct IdName
+{
+    const char *name; /** The name (also accepted with the `FIELD_` or `ALGORITHM_` prefix). */
+    int id;           /** The id. */
+} IdName;
+
+/**
+ * The names of the field ids.
+ */
+static const IdName FIELD_NAMES[] = {{"STRING", FIELD_STRING}, {"INTEGER", FIELD_INTEGER}, {"FLOAT", FIELD_FLOAT}};
+
+/**
+ * The names of the algorithm ids.
+ */
+static const IdName ALGORITHM_NAMES[] = {{"MERGESORT", ALGORITHM_MERGESORT}, {"QUICKSORT", ALGORITHM_QUICKSORT}, {"BININSSORT", ALGORITHM_BININSSORT}, {"MERGEBININSSORT", ALGORITHM_MERGEBININSSORT}, {"AUTO", ALGORITHM_AUTO}};
+
+/**
+ * Parses an id, either numeric or by name, returning -1 if it is not valid (unlike the tools, a bad request does
+ * not abort the daemon).
+ */
+static int parse_id(const char *arg, const char *prefix, const IdName *names, size_t num_names)
+{
+    size_t i, prefix_len;
+    int id;
+    char extra;
+
+    if (sscanf(arg, "%d%c", &id, &extra) == 1)
+        return id >= names[0].id && id <= names[num_names - 1].id ? id : -1;
+
+    prefix_len = strlen(prefix);
+
+    if (!strncmp(arg, prefix, prefix_len))
+        arg += prefix_len;
+
+    for (i = 0; i < num_names; i++)
+    {
+        if (!strcmp(arg, names[i].name))
+            return names[i].id;
+    }
+
+    return -1;
+}
+
+/**
+ * Parses a positive count (e.g., the K of `TOP`), returning 0 if it is not valid.
+ */
+static size_t parse_count(const char *arg)
+{
+    size_t count;
+    char extra;
+
+    if (sscanf(arg, "%zu%c", &count, &extra) != 1)
+        return 0;
+
+    return count;
+}
+
+/**
+ * Reads a monotonic clock, in seconds.
+ */
+static double get_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Prints the final line of a failed request.
+ */
+static void reply_error(FILE *out_file, const char *message)
+{
+    fprintf(out_file, "ERROR %s\n", message);
+}
+
+/**
+ * Forks a child process running a step of a request which may fail: the library aborts on a malformed input or a
+ * failed I/O, which shall only fail the request. The pending output is flushed first, so that it is not written twice.
+ * Returns the pid of the child (0 in the child, -1 if it cannot be created).
+ */
+static pid_t fork_step(void)
+{
+    fflush(NULL);
+    return fork();
+}
+
+/**
+ * Waits for a child forked by `fork_step`, returning whether it exited successfully.
+ */
+static int wait_step(pid_t pid)
+{
+    int status;
+
+    if (waitpid(pid, &status, 0) != pid)
+        return 0;
+
+    return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+/**
+ * Reads exactly `len` bytes from a pipe, returning 0 if it is closed before.
+ */
+static int read_pipe(int fd, void *buffer, size_t len)
+{
+    char *bytes;
+    ssize_t result;
+
+    for (bytes = buffer; len > 0; bytes += result, len -= (size_t)result)
+    {
+        result = read(fd, bytes, len);
+
+        if (result <= 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Writes exactly `len` bytes to a pipe, returning 0 if it is closed before.
+ */
+static int write_pipe(int fd, const void *buffer, size_t len)
+{
+    const char *bytes;
+    ssize_t result;
+
+    for (bytes = buffer; len > 0; bytes += result, len -= (size_t)result)
+    {
+        result = write(fd, bytes, len);
+
+        if (result <= 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Loads the records of an input file in a child process, which sends them through a pipe. Returns NULL if the file
+ * cannot be loaded (the library error is printed by the child).
+ */
+static Record *load_dataset_records(const char *path, size_t *num_records)
+{
+    Record *records;
+    FILE *in_file;
+    size_t count;
+    pid_t pid;
+    int fds[2], received;
+
+    if (pipe(fds))
+        return NULL;
+
+    pid = fork_step();
+
+    if (!pid)
+    {
+        close(fds[0]);
+
+        in_file = open_input_file(path);
+        records = load_records_file(in_file, &count);
+        ASSERT(!fclose(in_file), "Unable to close input file", load_dataset_records);
+
+        exit(write_pipe(fds[1], &count, sizeof(count)) && write_pipe(fds[1], records, sizeof(Record) * count) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    records = NULL;
+    received = 0;
+
+    if (pid > 0 && read_pipe(fds[0], &count, sizeof(count)))
+    {
+        records = allocate_large(sizeof(Record) * (count ? count : 1));
+        received = records && read_pipe(fds[0], records, sizeof(Record) * count);
+    }
+
+    close(fds[0]);
+
+    if (pid < 0 || !wait_step(pid) || !received)
+    {
+        free_large(records);
+        return NULL;
+    }
+
+    *num_records = count;
+    return records;
+}
+
+/**
+ * Retrieves the dataset of an input file, loading it if it is not resident or if the file changed since it was
+ * loaded. Returns NULL (with the error message) if the file cannot be read; a resident dataset is kept as it was.
+ */
+static Dataset *get_dataset(Daemon *daemon, const char *path, const char **error)
+{
+    struct stat info;
+    Dataset *dataset;
+    Record *records;
+    size_t num_records, i;
+
+    if (stat(path, &info) || !S_ISREG(info.st_mode))
+    {
+        *error = "The input file cannot be read";
+        return NULL;
+    }
+
+    dataset = NULL;
+
+    for (i = 0; i < daemon->num_datasets && !dataset; i++)
+    {
+        if (!strcmp(daemon->datasets[i].path, path))
+            dataset = &daemon->datasets[i];
+    }
+
+    if (dataset && dataset->mtime == info.st_mtime && dataset->size == info.st_size)
+        return dataset;
+
+    if (!dataset && daemon->num_datasets == MAX_DATASETS)
+    {
+        *error = "Too many resident datasets (drop some first)";
+        return NULL;
+    }
+
+    printf("Loading '%s'...\n", path);
+
+    records = load_dataset_records(path, &num_records);
+
+    if (!records)
+    {
+        *error = "The input file cannot be loaded (see the daemon log)";
+        return NULL;
+    }
+
+    if (!dataset)
+    {
+        dataset = &daemon->datasets[daemon->num_datasets++];
+        dataset->path = malloc(strlen(path) + 1);
+        ASSERT(dataset->path, "Unable to allocate memory for the dataset path", get_dataset);
+        strcpy(dataset->path, path);
+    }
+    else
+        free_large(dataset->records);
+
+    dataset->records = records;
+    dataset->num_records = num_records;
+    dataset->mtime = info.st_mtime;
+    dataset->size = info.st_size;
+
+    return dataset;
+}
+
+/**
+ * Copies the records of a dataset to the work buffer, which is grown (and prefaulted) only when it is too small.
+ */
+static Record *copy_to_work(Daemon *daemon, const Dataset *dataset)
+{
+    if (dataset->num_records > daemon->work_capacity)
+    {
+        free_large(daemon->work);
+
+        daemon->work = allocate_large(sizeof(Record) * dataset->num_records);
+        ASSERT(daemon->work, "Unable to allocate memory for the work buffer", copy_to_work);
+        prefault_large(daemon->work, sizeof(Record) * dataset->num_records);
+        daemon->work_capacity = dataset->num_records;
+    }
+
+    if (dataset->num_records > 0)
+        memcpy(daemon->work, dataset->records, sizeof(Record) * dataset->num_records);
+
+    return daemon->work;
+}
+
+/**
+ * Writes records either to an output file (replying its path) or, if the path is `-`, to the client (replying the
+ * number of records).
+ */
+static void reply_records(FILE *out_file, const char *out_path, const Record *records, size_t num_records)
+{
+    RecordsWriter *writer;
+    FILE *file;
+    size_t i;
+    pid_t pid;
+
+    if (!strcmp(out_path, "-"))
+    {
+        for (i = 0; i < num_records; i++)
+            write_record_csv(out_file, &records[i]);
+
+        fprintf(out_file, "OK %zu\n", num_records);
+        return;
+    }
+
+    // The child writes the file from its copy-on-write view of the records.
+    pid = fork_step();
+
+    if (!pid)
+    {
+        file = open_output_file(out_path, 0);
+        writer = open_records_writer(file);
+        write_records(writer, records, num_records);
+        close_records_writer(writer);
+        ASSERT(!fclose(file), "Unable to close output file", reply_records);
+
+        exit(EXIT_SUCCESS);
+    }
+
+    if (pid < 0 || !wait_step(pid))
+        reply_error(out_file, "The output file cannot be written (see the daemon log)");
+    else
+        fprintf(out_file, "OK %s\n", out_path);
+}
+
+/**
+ * Runs `SORT <input> <output|-> <field> <algorithm> <threshold?>`.
+ */
+static void run_sort_request(Daemon *daemon, char **words, size_t num_words, FILE *out_file)
+{
+    Dataset *dataset;
+    Record *records;
+    const char *error;
+    int field_id, algorithm_id;
+    size_t threshold;
+
+    if (num_words < 5 || num_words > 6)
+    {
+        reply_error(out_file, "Usage: SORT <input> <output|-> <field> <algorithm> <threshold?>");
+        return;
+    }
+
+    field_id = parse_id(words[3], "FIELD_", FIELD_NAMES, sizeof(FIELD_NAMES) / sizeof(FIELD_NAMES[0]));
+    algorithm_id = parse_id(words[4], "ALGORITHM_", ALGORITHM_NAMES, sizeof(ALGORITHM_NAMES) / sizeof(ALGORITHM_NAMES[0]));
+    threshold = num_words > 5 ? parse_count(words[5]) : 0;
+
+    if (field_id < 0 || algorithm_id < 0 || (num_words > 5 && threshold < 2))
+    {
+        reply_error(out_file, "The field id, the algorithm id or the threshold has not been correctly specified");
+        return;
+    }
+
+    dataset = get_dataset(daemon, words[1], &error);
+
+    if (!dataset)
+    {
+        reply_error(out_file, error);
+        return;
+    }
+
+    records = copy_to_work(daemon, dataset);
+    sort_loaded_records(records, dataset->num_records, (FieldId)field_id, (AlgorithmId)algorithm_id, (void *)threshold);
+
+    reply_records(out_file, words[2], records, dataset->num_records);
+}
+
+/**
+ * Runs `TOP <input> <k> <field> <output?>`.
+ */
+static void run_top_request(Daemon *daemon, char **words, size_t num_words, FILE *out_file)
+{
+    Dataset *dataset;
+    Record *records;
+    const char *error;
+    int field_id;
+    size_t k;
+
+    if (num_words < 4 || num_words > 5)
+    {
+        reply_error(out_file, "Usage: TOP <input> <k> <field> <output?>");
+        return;
+    }
+
+    k = parse_count(words[2]);
+    field_id = parse_id(words[3], "FIELD_", FIELD_NAMES, sizeof(FIELD_NAMES) / sizeof(FIELD_NAMES[0]));
+
+    if (!k || field_id < 0)
+    {
+        reply_error(out_file, "The number of records or the field id has not been correctly specified");
+        return;
+    }
+
+    dataset = get_dataset(daemon, words[1], &error);
+
+    if (!dataset)
+    {
+        reply_error(out_file, error);
+        return;
+    }
+
+    records = copy_to_work(daemon, dataset);
+
+    if (k > dataset->num_records)
+        k = dataset->num_records;
+
+    if (k > 0)
+        partial_sort(records, dataset->num_records, sizeof(Record), k, get_records_comparator((FieldId)field_id));
+
+    reply_records(out_file, num_words > 4 ? words[4] : "-", records, k);
+}
+
+/**
+ * Runs `QUERY <sorted_file> <low_key> <high_key?>`.
+ */
+static void run_query_request(char **words, size_t num_words, FILE *out_file)
+{
+    char index_path[MAX_REQUEST_LEN + sizeof(INDEX_FILE_EXTENSION)];
+    size_t num_records;
+    pid_t pid;
+
+    if (num_words < 3 || num_words > 4)
+    {
+        reply_error(out_file, "Usage: QUERY <sorted_file> <low_key> <high_key?>");
+        return;
+    }
+
+    snprintf(index_path, sizeof(index_path), "%s" INDEX_FILE_EXTENSION, words[1]);
+
+    if (access(words[1], R_OK) || access(index_path, R_OK))
+    {
+        reply_error(out_file, "The sorted file or its index cannot be read");
+        return;
+    }
+
+    // The child streams the matching records to the client, and ends the response if the query succeeds.
+    pid = fork_step();
+
+    if (!pid)
+    {
+        num_records = query_sorted_file(words[1], words[2], num_words > 3 ? words[3] : words[2], out_file);
+        fprintf(out_file, "OK %zu\n", num_records);
+
+        exit(EXIT_SUCCESS);
+    }
+
+    if (pid < 0 || !wait_step(pid))
+        reply_error(out_file, "The query failed, e.g. on a malformed key or a stale index (see the daemon log)");
+}
+
+/**
+ * Runs `LOAD <input>`, `DROP <input>` and `LIST`, which manage the resident datasets.
+ */
+static void run_dataset_request(Daemon *daemon, char **words, size_t num_words, FILE *out_file)
+{
+    Dataset *dataset;
+    const char *error;
+    size_t i;
+
+    if (!strcmp(words[0], "LIST"))
+    {
+        for (i = 0; i < daemon->num_datasets; i++)
+            fprintf(out_file, "%s %zu\n", daemon->datasets[i].path, daemon->datasets[i].num_records);
+
+        fprintf(out_file, "OK %zu\n", daemon->num_datasets);
+        return;
+    }
+
+    if (num_words != 2)
+    {
+        reply_error(out_file, "Usage: LOAD <input>, DROP <input>");
+        return;
+    }
+
+    if (!strcmp(words[0], "LOAD"))
+    {
+        dataset = get_dataset(daemon, words[1], &error);
+
+        if (dataset)
+            fprintf(out_file, "OK %zu\n", dataset->num_records);
+        else
+            reply_error(out_file, error);
+
+        return;
+    }
+
+    for (i = 0; i < daemon->num_datasets; i++)
+    {
+        if (!strcmp(daemon->datasets[i].path, words[1]))
+        {
+            free(daemon->datasets[i].path);
+            free_large(daemon->datasets[i].records);
+            daemon->datasets[i] = daemon->datasets[--daemon->num_datasets];
+
+            fprintf(out_file, "OK\n");
+            return;
+        }
+    }
+
+    reply_error(out_file, "The dataset is not resident");
+}
+
+/**
+ * Reads a request line from a client, and writes the response.
+ */
+static void serve_request(Daemon *daemon, FILE *in_file, FILE *out_file)
+{
+    char line[MAX_REQUEST_LEN];
+    char *words[MAX_REQUEST_WORDS + 1];
+    size_t num_words;
+    double start;
+
+    if (!fgets(line, sizeof(line), in_file))
+        return;
+
+    num_words = 0;
+
+    for (words[0] = strtok(line, " \t\r\n"); words[num_words] && num_words < MAX_REQUEST_WORDS; words[num_words] = strtok(NULL, " \t\r\n"))
+        num_words++;
+
+    if (!num_words)
+    {
+        reply_error(out_file, "Empty request");
+        return;
+    }
+
+    printf("Request: %s\n", words[0]);
+    start = get_time();
+
+    if (words[num_words])
+        reply_error(out_file, "Too many arguments");
+    else if (!strcmp(words[0], "SORT"))
+        run_sort_request(daemon, words, num_words, out_file);
+    else if (!strcmp(words[0], "TOP"))
+        run_top_request(daemon, words, num_words, out_file);
+    else if (!strcmp(words[0], "QUERY"))
+        run_query_request(words, num_words, out_file);
+    else if (!strcmp(words[0], "LOAD") || !strcmp(words[0], "DROP") || !strcmp(words[0], "LIST"))
+        run_dataset_request(daemon, words, num_words, out_file);
+    else if (!strcmp(words[0], "SHUTDOWN"))
+    {
+        daemon->stopping = 1;
+        fprintf(out_file, "OK\n");
+    }
+    else
+        reply_error(out_file, "Unknown request (valid: SORT, TOP, QUERY, LOAD, DROP, LIST, SHUTDOWN)");
+
+    printf("Served in %.3f s.\n", get_time() - start);
+    fflush(stdout);
+}
+
+/**
+ * Fills the address of the socket at the specified path.
+ */
+static void make_socket_address(struct sockaddr_un *address, const char *socket_path)
+{
+    ASSERT(strlen(socket_path) < sizeof(address->sun_path), "The socket path is too long", make_socket_address);
+
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    strcpy(address->sun_path, socket_path);
+}
+
+/**
+ * Runs the daemon: accepts the clients one at a time, serving a request for each connection, until `SHUTDOWN`.
+ */
+static void run_daemon(const char *socket_path)
+{
+    struct sockaddr_un address;
+    Daemon daemon;
+    FILE *in_file, *out_file;
+    int server_fd, client_fd;
+    size_t i;
+
+    memset(&daemon, 0, sizeof(daemon));
+    make_socket_address(&address, socket_path);
+
+    // A client closing the connection while its response is written shall not terminate the daemon.
+    signal(SIGPIPE, SIG_IGN);
+
+    server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT(server_fd >= 0, "Unable to create the socket", run_daemon);
+
+    unlink(socket_path);
+    ASSERT(!bind(server_fd, (struct sockaddr *)&address, sizeof(address)), "Unable to bind the socket", run_daemon);
+    ASSERT(!listen(server_fd, LISTEN_BACKLOG), "Unable to listen on the socket", run_daemon);
+
+    printf("Listening on '%s'.\n", socket_path);
+    fflush(stdout);
+
+    while (!daemon.stopping)
+    {
+        client_fd = accept(server_fd, NULL, NULL);
+
+        if (client_fd < 0)
+            continue;
+
+        in_file = fdopen(client_fd, "r");
+        out_file = fdopen(dup(client_fd), "w");
+        ASSERT(in_file && out_file, "Unable to open the client connection", run_daemon);
+
+        serve_request(&daemon, in_file, out_file);
+
+        fclose(out_file);
+        fclose(in_file);
+    }
+
+    close(server_fd);
+    unlink(socket_path);
+
+    for (i = 0; i < daemon.num_datasets; i++)
+    {
+        free(daemon.datasets[i].path);
+        free_large(daemon.datasets[i].records);
+    }
+
+    free_large(daemon.work);
+}
+
+/**
+ * Sends a request (the words of the command line) to the daemon, and prints the response. Returns whether the
+ * request succeeded.
+ */
+static int send_request(const char *socket_path, int num_words, char *words[])
+{
+    struct sockaddr_un address;
+    char line[MAX_REQUEST_LEN];
+    FILE *in_file, *out_file;
+    int client_fd, i, succeeded;
+
+    make_socket_address(&address, socket_path);
+
+    client_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT(client_fd >= 0, "Unable to create the socket", send_request);
+    ASSERT(!connect(client_fd, (struct sockaddr *)&address, sizeof(address)), "Unable to connect to the daemon", send_request);
+
+    in_file = fdopen(client_fd, "r");
+    out_file = fdopen(dup(client_fd), "w");
+    ASSERT(in_file && out_file, "Unable to open the daemon connection", send_request);
+
+    for (i = 0; i < num_words; i++)
+        fprintf(out_file, i ? " %s" : "%s", words[i]);
+
+    fprintf(out_file, "\n");
+    fclose(out_file);
+
+    // Every line is copied to the standard output; the last one reports the outcome.
+    succeeded = 0;
+
+    while (fgets(line, sizeof(line), in_file))
+    {
+        fputs(line, stdout);
+        succeeded = !strncmp(line, "OK", 2);
+    }
+
+    fclose(in_file);
+    return succeeded;
+}
+
+/**
+ * Entry point.
+ */
+int main(int argc, char *argv[])
+{
+    const char *socket_path;
+    int first_arg;
+
+    socket_path = DEFAULT_SOCKET_PATH;
+    first_arg = 1;
+
+    if (argc > 2 && !strcmp(argv[1], "--socket"))
+    {
+        socket_path = argv[2];
+        first_arg = 3;
+    }
+
+    ASSERT(argc > first_arg, "Wrong number of arguments (either 'serve' or a request expected)", main);
+
+    if (!strcmp(argv[first_arg], "serve"))
+    {
+        run_daemon(socket_path);
+        return EXIT_SUCCESS;
+    }
+
+    return send_request(socket_path, argc - first_arg, &argv[first_arg]) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
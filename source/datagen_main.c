@@ -0,0 +1,314 @@
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compressed-io.h"
+#include "diagnostics.h"
+#include "distributions.h"
+#include "records-io.h"
+
+/**
+ * Defines constants for indexing `argv`.
+ */
+enum Args
+{
+    ARG_OUT_FILE_PATH = 1,
+    ARG_NUM_RECORDS,
+    OPTARG_FIRST_OPTION
+};
+
+/**
+ * The size of the output file buffer.
+ */
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/**
+ * The number of generated columns (string, integer and float fields).
+ */
+#define NUM_COLUMNS 3
+
+/**
+ * Specifies the distributions of the string field length.
+ */
+typedef enum LengthDistributionId
+{
+    LENGTH_FIXED = 1, // Every string has the same length.
+    LENGTH_UNIFORM,   // Lengths are uniformly distributed in range [min, max].
+    LENGTH_NORMAL     // Lengths are normally distributed (mean, standard deviation).
+} LengthDistributionId;
+
+/**
+ * The distribution of the string field length.
+ */
+typedef struct LengthDistribution
+{
+    LengthDistributionId id; /** The distribution of the lengths. */
+    double first;            /** The fixed length, the minimum length or the mean. */
+    double second;           /** The maximum length or the standard deviation. */
+} LengthDistribution;
+
+/**
+ * The options of the generator.
+ */
+typedef struct GeneratorOptions
+{
+    DistributionId distributions[NUM_COLUMNS]; /** The distribution of each column. */
+    DistributionParams params;                 /** The parameters of the distributions. */
+    LengthDistribution string_length;          /** The distribution of the string field length. */
+    uint64_t seed;                             /** The seed of the generator. */
+    int binary;                                /** Whether a binary records file is generated instead of a CSV. */
+} GeneratorOptions;
+
+/**
+ * Indexes of the columns in `GeneratorOptions.distributions`.
+ */
+enum Columns
+{
+    COLUMN_STRING = 0,
+    COLUMN_INTEGER,
+    COLUMN_FLOAT
+};
+
+/**
+ * Hashes a key, so that random choices depending on the key are the same for equal keys.
+ */
+static uint64_t hash_key(uint64_t key, uint64_t seed)
+{
+    Rng rng;
+
+    rng_seed(&rng, key ^ (seed * 0xD6E8FEB86659FD93ull));
+    return rng_next(&rng);
+}
+
+/**
+ * Draws the length of the string generated from a key.
+ */
+static size_t draw_string_length(const LengthDistribution *length, Rng *rng)
+{
+    double drawn;
+
+    switch (length->id)
+    {
+    case LENGTH_FIXED:
+        drawn = length->first;
+        break;
+    case LENGTH_UNIFORM:
+        drawn = length->first + (double)rng_next_below(rng, (uint64_t)(length->second - length->first) + 1);
+        break;
+    case LENGTH_NORMAL:
+        // Box-Muller transform.
+        drawn = length->first + length->second * sqrt(-2.0 * log(1.0 - rng_next_double(rng))) * cos(6.283185307179586 * rng_next_double(rng));
+        break;
+    default:
+        UNREACHABLE();
+    }
+
+    if (drawn < 1)
+        return 1;
+
+    if (drawn > STRING_FIELD_LEN - 1)
+        return STRING_FIELD_LEN - 1;
+
+    return (size_t)(drawn + 0.5);
+}
+
+/**
+ * Generates the string field from a key.
+ *
+ * The string starts with the key written in base 26 over a fixed number of letters, so that strings preserve the
+ * order of keys, followed by letters depending only on the key, so that equal keys produce equal strings.
+ */
+static void generate_string(char *str, uint64_t key, size_t key_letters, const LengthDistribution *length, uint64_t seed)
+{
+    Rng rng;
+    size_t len, i;
+    uint64_t remaining;
+
+    rng_seed(&rng, hash_key(key, seed));
+    len = draw_string_length(length, &rng);
+
+    if (len < key_letters)
+        len = key_letters;
+
+    remaining = key;
+
+    for (i = key_letters; i > 0; i--)
+    {
+        str[i - 1] = (char)('a' + remaining % 26);
+        remaining /= 26;
+    }
+
+    for (i = key_letters; i < len; i++)
+        str[i] = (char)('a' + rng_next_below(&rng, 26));
+
+    str[len] = '\0';
+}
+
+/**
+ * Computes the number of base 26 letters needed to represent keys lower than `bound`.
+ */
+static size_t count_key_letters(uint64_t bound)
+{
+    size_t letters;
+    uint64_t capacity;
+
+    for (letters = 1, capacity = 26; capacity < bound; letters++)
+        capacity *= 26;
+
+    return letters;
+}
+
+/**
+ * Generates the records file.
+ */
+static void generate_records(const char *out_path, size_t num_records, const GeneratorOptions *options)
+{
+    FILE *out_file;
+    Distribution *distributions[NUM_COLUMNS];
+    Record record;
+    size_t i, key_letters;
+    int column;
+
+    for (column = 0; column < NUM_COLUMNS; column++)
+        distributions[column] = create_distribution(options->distributions[column], num_records, &options->params, options->seed + (uint64_t)column);
+
+    key_letters = count_key_letters(distribution_bound(distributions[COLUMN_STRING]));
+    ASSERT(key_letters < STRING_FIELD_LEN, "Too many distinct string keys for the string field length", generate_records);
+
+    out_file = open_output_file(out_path, options->binary);
+    setvbuf(out_file, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    if (options->binary)
+        write_records_file_header(out_file, num_records);
+
+    memset(&record, 0, sizeof(record));
+
+    for (i = 0; i < num_records; i++)
+    {
+        record.id = (int)(i + 1);
+        generate_string(record.field1, distribution_value(distributions[COLUMN_STRING], i), key_letters, &options->string_length, options->seed);
+        record.field2 = (int)(distribution_value(distributions[COLUMN_INTEGER], i) % ((uint64_t)INT_MAX + 1));
+        record.field3 = (float)((double)distribution_value(distributions[COLUMN_FLOAT], i) / 100.0);
+
+        if (options->binary)
+            write_binary_records(out_file, &record, 1);
+        else
+            write_record_csv(out_file, &record);
+    }
+
+    ASSERT(!fclose(out_file), "Unable to close output file", generate_records);
+
+    for (column = 0; column < NUM_COLUMNS; column++)
+        destroy_distribution(distributions[column]);
+}
+
+/**
+ * Parses the name of a distribution, aborting if it is not valid.
+ */
+static DistributionId parse_distribution(const char *name)
+{
+    DistributionId distribution_id;
+
+    distribution_id = parse_distribution_name(name);
+    ASSERT(distribution_id, "Unknown distribution (valid: uniform, sorted, reversed, nearly-sorted, few-unique, zipf, organ-pipe, sawtooth, all-equal)", parse_distribution);
+
+    return distribution_id;
+}
+
+/**
+ * Parses the string length distribution (`fixed:N`, `uniform:MIN:MAX` or `normal:MEAN:STDDEV`).
+ */
+static void parse_string_length(const char *spec, LengthDistribution *length)
+{
+    if (sscanf(spec, "fixed:%lf", &length->first) == 1)
+        length->id = LENGTH_FIXED;
+    else if (sscanf(spec, "uniform:%lf:%lf", &length->first, &length->second) == 2)
+        length->id = LENGTH_UNIFORM;
+    else if (sscanf(spec, "normal:%lf:%lf", &length->first, &length->second) == 2)
+        length->id = LENGTH_NORMAL;
+    else
+        PRINT_ERROR("The string length has not been correctly specified (valid: fixed:N, uniform:MIN:MAX, normal:MEAN:STDDEV)", parse_string_length);
+
+    ASSERT(length->first >= 1, "The string length must be at least one", parse_string_length);
+    ASSERT(length->id != LENGTH_UNIFORM || length->second >= length->first, "The maximum string length must not be lower than the minimum", parse_string_length);
+}
+
+/**
+ * Tests whether the argument at the specified index is the specified option.
+ */
+#define TEST_OPTION(name, argv, i) (!strcmp((argv)[(i)], (name)))
+
+/**
+ * Entry point.
+ */
+int main(int argc, char *argv[])
+{
+    const char *out_path;
+    size_t num_records, len;
+    unsigned long long seed;
+    GeneratorOptions options;
+    int i, column;
+
+    ASSERT(argc > ARG_OUT_FILE_PATH, "Wrong number of arguments (output file path not found)", main);
+    ASSERT(argc > ARG_NUM_RECORDS, "Wrong number of arguments (number of records not found)", main);
+
+    out_path = argv[ARG_OUT_FILE_PATH];
+    ASSERT(sscanf(argv[ARG_NUM_RECORDS], "%zu", &num_records) == 1 && num_records > 0, "The number of records has not been correctly specified", main);
+
+    memset(&options, 0, sizeof(options));
+
+    for (column = 0; column < NUM_COLUMNS; column++)
+        options.distributions[column] = DISTRIBUTION_UNIFORM;
+
+    options.string_length.id = LENGTH_UNIFORM;
+    options.string_length.first = 5;
+    options.string_length.second = 20;
+    options.seed = 42;
+
+    // A gzipped output keeps the format of the extension preceding `.gz` (e.g., `records.bin.gz`).
+    len = strlen(out_path) - (is_gzip_path(out_path) ? strlen(GZIP_FILE_EXTENSION) : 0);
+    options.binary = len >= strlen(".bin") && !strncmp(out_path + len - strlen(".bin"), ".bin", strlen(".bin"));
+
+    for (i = OPTARG_FIRST_OPTION; i < argc; i += 2)
+    {
+        ASSERT(i + 1 < argc, "Wrong number of arguments (option value not found)", main);
+
+        if (TEST_OPTION("--dist", argv, i))
+        {
+            for (column = 0; column < NUM_COLUMNS; column++)
+                options.distributions[column] = parse_distribution(argv[i + 1]);
+        }
+        else if (TEST_OPTION("--string-dist", argv, i))
+            options.distributions[COLUMN_STRING] = parse_distribution(argv[i + 1]);
+        else if (TEST_OPTION("--int-dist", argv, i))
+            options.distributions[COLUMN_INTEGER] = parse_distribution(argv[i + 1]);
+        else if (TEST_OPTION("--float-dist", argv, i))
+            options.distributions[COLUMN_FLOAT] = parse_distribution(argv[i + 1]);
+        else if (TEST_OPTION("--seed", argv, i))
+        {
+            ASSERT(sscanf(argv[i + 1], "%llu", &seed) == 1, "The seed has not been correctly specified", main);
+            options.seed = (uint64_t)seed;
+        }
+        else if (TEST_OPTION("--swaps", argv, i))
+            ASSERT(sscanf(argv[i + 1], "%zu", &options.params.swaps) == 1, "The number of swaps has not been correctly specified", main);
+        else if (TEST_OPTION("--unique", argv, i))
+            ASSERT(sscanf(argv[i + 1], "%zu", &options.params.unique) == 1, "The number of unique keys has not been correctly specified", main);
+        else if (TEST_OPTION("--zipf-exponent", argv, i))
+            ASSERT(sscanf(argv[i + 1], "%lf", &options.params.zipf_exponent) == 1, "The Zipf exponent has not been correctly specified", main);
+        else if (TEST_OPTION("--period", argv, i))
+            ASSERT(sscanf(argv[i + 1], "%zu", &options.params.period) == 1, "The sawtooth period has not been correctly specified", main);
+        else if (TEST_OPTION("--string-length", argv, i))
+            parse_string_length(argv[i + 1], &options.string_length);
+        else if (TEST_OPTION("--format", argv, i))
+        {
+            ASSERT(!strcmp(argv[i + 1], "csv") || !strcmp(argv[i + 1], "binary"), "The format has not been correctly specified (valid: csv, binary)", main);
+            options.binary = !strcmp(argv[i + 1], "binary");
+        }
+        else
+            PRINT_ERROR("Unknown option", main);
+    }
+
+    generate_records(out_path, num_records, &options);
+
+    return EXIT_SUCCESS;
+}
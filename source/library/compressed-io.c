@@ -0,0 +1,593 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "compressed-io.h"
+#include "diagnostics.h"
+#include "parallel.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_ZLIB) && defined(__GLIBC__)
+#define GZIP_STREAMS_FOPENCOOKIE
+#elif defined(HAVE_ZLIB) && (defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__))
+#define GZIP_STREAMS_FUNOPEN
+#endif
+
+#if defined(GZIP_STREAMS_FOPENCOOKIE) || defined(GZIP_STREAMS_FUNOPEN)
+#include <zlib.h>
+#if defined(HAVE_PTHREADS)
+#include <pthread.h>
+#endif
+#endif
+
+/**
+ * The first two bytes of a gzipped file.
+ */
+static const unsigned char GZIP_MAGIC[2] = {0x1f, 0x8b};
+
+int is_gzip_path(const char *path)
+{
+    size_t len, extension_len;
+
+    ASSERT_NULL_PARAMETER(path, is_gzip_path);
+
+    len = strlen(path);
+    extension_len = strlen(GZIP_FILE_EXTENSION);
+
+    return len > extension_len && !strcmp(path + len - extension_len, GZIP_FILE_EXTENSION);
+}
+
+#if defined(GZIP_STREAMS_FOPENCOOKIE) || defined(GZIP_STREAMS_FUNOPEN)
+
+/**
+ * A gzipped file, exchanging blocks with the thread (de)compressing it through a circular queue.
+ *
+ * The reading stream holds the block at `consumed` while reading it, and releases it once exhausted; the writing
+ * stream fills the block at `produced`, and queues it once full.
+ */
+typedef struct GzipStream
+{
+    gzFile file;                                /** The gzipped file. */
+    int writing;                                /** Whether the file is being written (compressed). */
+    char *blocks[GZIP_QUEUE_BLOCKS];            /** The queued blocks. */
+    size_t lengths[GZIP_QUEUE_BLOCKS];          /** The number of bytes of each queued block. */
+    size_t produced;                            /** The number of blocks queued so far. */
+    size_t consumed;                            /** The number of blocks released so far. */
+    int done;                                   /** Whether no more blocks will be queued. */
+    int failed;                                 /** Whether zlib reported an error. */
+    int stopping;                               /** Whether the stream is being closed before the end of the file. */
+    int holding;                                /** Whether the reading stream holds the block at `consumed`. */
+    size_t offset;                              /** The position in the held (or filled) block. */
+    uint64_t position;                          /** The position in the file of the held (or next) block. */
+#if defined(HAVE_PTHREADS)
+    pthread_mutex_t lock;                       /** Protects the queue. */
+    pthread_cond_t changed;                     /** Signaled whenever a block is queued or released. */
+    TaskGroup *task;                            /** The task (de)compressing the file. */
+#endif
+} GzipStream;
+
+/**
+ * Locks the queue of the specified stream.
+ */
+static void lock_queue(GzipStream *stream)
+{
+#if defined(HAVE_PTHREADS)
+    pthread_mutex_lock(&stream->lock);
+#else
+    (void)stream;
+#endif
+}
+
+/**
+ * Unlocks the queue of the specified stream, waking up the other side.
+ */
+static void unlock_queue(GzipStream *stream)
+{
+#if defined(HAVE_PTHREADS)
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+#else
+    (void)stream;
+#endif
+}
+
+/**
+ * Inflates the next block of the file into the queue, which shall not be full (called with the queue unlocked).
+ *
+ * @return 0 once the end of the file has been reached, 1 otherwise.
+ */
+static int inflate_next_block(GzipStream *stream)
+{
+    size_t slot;
+    int read;
+
+    slot = stream->produced % GZIP_QUEUE_BLOCKS;
+    read = gzread(stream->file, stream->blocks[slot], GZIP_BLOCK_SIZE);
+
+    lock_queue(stream);
+
+    if (read > 0)
+    {
+        stream->lengths[slot] = (size_t)read;
+        stream->produced++;
+    }
+    else
+    {
+        stream->failed = read < 0;
+        stream->done = 1;
+    }
+
+    unlock_queue(stream);
+    return read > 0;
+}
+
+/**
+ * Deflates the block at the head of the queue, which shall not be empty, and releases it.
+ */
+static void deflate_next_block(GzipStream *stream)
+{
+    size_t slot;
+    int failed;
+
+    slot = stream->consumed % GZIP_QUEUE_BLOCKS;
+    failed = gzwrite(stream->file, stream->blocks[slot], (unsigned)stream->lengths[slot]) != (int)stream->lengths[slot];
+
+    lock_queue(stream);
+    stream->failed |= failed;
+    stream->consumed++;
+    unlock_queue(stream);
+}
+
+#if defined(HAVE_PTHREADS)
+
+/**
+ * Inflates the file into the queue, waiting for the reader whenever the queue is full.
+ */
+static void inflate_task(void *context, size_t index)
+{
+    GzipStream *stream;
+    int stopping;
+
+    (void)index;
+    stream = context;
+
+    do
+    {
+        pthread_mutex_lock(&stream->lock);
+
+        while (stream->produced - stream->consumed == GZIP_QUEUE_BLOCKS && !stream->stopping)
+            pthread_cond_wait(&stream->changed, &stream->lock);
+
+        stopping = stream->stopping;
+        pthread_mutex_unlock(&stream->lock);
+    } while (!stopping && inflate_next_block(stream));
+}
+
+/**
+ * Deflates the blocks queued by the writer, until the stream is closed.
+ */
+static void deflate_task(void *context, size_t index)
+{
+    GzipStream *stream;
+
+    (void)index;
+    stream = context;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&stream->lock);
+
+        while (stream->produced == stream->consumed && !stream->done)
+            pthread_cond_wait(&stream->changed, &stream->lock);
+
+        if (stream->produced == stream->consumed)
+        {
+            pthread_mutex_unlock(&stream->lock);
+            return;
+        }
+
+        pthread_mutex_unlock(&stream->lock);
+        deflate_next_block(stream);
+    }
+}
+
+#endif
+
+/**
+ * Waits for a block to be queued, and holds it.
+ *
+ * @return 0 if the end of the file has been reached, 1 otherwise.
+ */
+static int hold_next_block(GzipStream *stream)
+{
+#if defined(HAVE_PTHREADS)
+    pthread_mutex_lock(&stream->lock);
+
+    while (stream->produced == stream->consumed && !stream->done)
+        pthread_cond_wait(&stream->changed, &stream->lock);
+
+    stream->holding = stream->produced != stream->consumed;
+    pthread_mutex_unlock(&stream->lock);
+#else
+    // The block is inflated on demand, so the queue is always empty here.
+    stream->holding = !stream->done && inflate_next_block(stream);
+#endif
+
+    stream->offset = 0;
+    return stream->holding;
+}
+
+/**
+ * Releases the held block, letting the inflating task reuse it.
+ */
+static void release_block(GzipStream *stream)
+{
+    stream->position += stream->lengths[stream->consumed % GZIP_QUEUE_BLOCKS];
+    stream->holding = 0;
+
+    lock_queue(stream);
+    stream->consumed++;
+    unlock_queue(stream);
+}
+
+/**
+ * Queues the filled block, waiting for the deflating task to release the next one.
+ */
+static void queue_block(GzipStream *stream)
+{
+    stream->lengths[stream->produced % GZIP_QUEUE_BLOCKS] = stream->offset;
+    stream->position += stream->offset;
+    stream->offset = 0;
+
+    lock_queue(stream);
+    stream->produced++;
+    unlock_queue(stream);
+
+#if defined(HAVE_PTHREADS)
+    pthread_mutex_lock(&stream->lock);
+
+    while (stream->produced - stream->consumed == GZIP_QUEUE_BLOCKS)
+        pthread_cond_wait(&stream->changed, &stream->lock);
+
+    pthread_mutex_unlock(&stream->lock);
+#else
+    deflate_next_block(stream);
+#endif
+}
+
+/**
+ * Reads from the held blocks, holding the next ones as needed.
+ */
+static long long read_gzip_stream(GzipStream *stream, char *buffer, size_t size)
+{
+    size_t copied, available;
+
+    copied = 0;
+
+    while (copied < size)
+    {
+        if (!stream->holding && !hold_next_block(stream))
+            break;
+
+        available = stream->lengths[stream->consumed % GZIP_QUEUE_BLOCKS] - stream->offset;
+
+        if (!available)
+        {
+            release_block(stream);
+            continue;
+        }
+
+        if (available > size - copied)
+            available = size - copied;
+
+        memcpy(buffer + copied, stream->blocks[stream->consumed % GZIP_QUEUE_BLOCKS] + stream->offset, available);
+        stream->offset += available;
+        copied += available;
+    }
+
+    return !copied && stream->failed ? -1 : (long long)copied;
+}
+
+/**
+ * Writes to the filled blocks, queuing them once full.
+ */
+static long long write_gzip_stream(GzipStream *stream, const char *buffer, size_t size)
+{
+    size_t copied, available;
+
+    if (stream->failed)
+        return -1;
+
+    copied = 0;
+
+    while (copied < size)
+    {
+        available = GZIP_BLOCK_SIZE - stream->offset;
+
+        if (available > size - copied)
+            available = size - copied;
+
+        memcpy(stream->blocks[stream->produced % GZIP_QUEUE_BLOCKS] + stream->offset, buffer + copied, available);
+        stream->offset += available;
+        copied += available;
+
+        if (stream->offset == GZIP_BLOCK_SIZE)
+            queue_block(stream);
+    }
+
+    return (long long)copied;
+}
+
+/**
+ * Seeks the stream, which is only possible within the held block.
+ *
+ * @return The new position, or -1 if the position is out of the held block.
+ */
+static long long seek_gzip_stream(GzipStream *stream, long long offset, int whence)
+{
+    long long target, start, end;
+
+    start = (long long)stream->position;
+    end = start + (long long)(stream->holding ? stream->lengths[stream->consumed % GZIP_QUEUE_BLOCKS] : 0);
+
+    if (whence == SEEK_SET)
+        target = offset;
+    else if (whence == SEEK_CUR)
+        target = start + (long long)stream->offset + offset;
+    else
+        return -1;
+
+    // Writing streams can only report their position.
+    if (stream->writing)
+        return target == start + (long long)stream->offset ? target : -1;
+
+    if (target < start || target > end)
+        return -1;
+
+    stream->offset = (size_t)(target - start);
+    return target;
+}
+
+/**
+ * Closes the stream, waiting for the (de)compression to complete.
+ *
+ * @return 0 on success, -1 if zlib reported an error.
+ */
+static int close_gzip_stream(GzipStream *stream)
+{
+    int failed, i;
+
+    if (stream->writing)
+    {
+        if (stream->offset)
+            queue_block(stream);
+
+        lock_queue(stream);
+        stream->done = 1;
+        unlock_queue(stream);
+    }
+    else
+    {
+        lock_queue(stream);
+        stream->stopping = 1;
+        unlock_queue(stream);
+    }
+
+#if defined(HAVE_PTHREADS)
+    wait_tasks(stream->task);
+    pthread_cond_destroy(&stream->changed);
+    pthread_mutex_destroy(&stream->lock);
+#endif
+
+    failed = stream->failed;
+    failed |= gzclose(stream->file) != Z_OK && stream->writing;
+
+    for (i = 0; i < GZIP_QUEUE_BLOCKS; i++)
+        free(stream->blocks[i]);
+
+    free(stream);
+    return failed ? -1 : 0;
+}
+
+#if defined(GZIP_STREAMS_FOPENCOOKIE)
+
+/**
+ * Adapts `read_gzip_stream` to `cookie_io_functions_t`.
+ */
+static ssize_t cookie_read(void *cookie, char *buffer, size_t size)
+{
+    return (ssize_t)read_gzip_stream(cookie, buffer, size);
+}
+
+/**
+ * Adapts `write_gzip_stream` to `cookie_io_functions_t` (0 reports an error).
+ */
+static ssize_t cookie_write(void *cookie, const char *buffer, size_t size)
+{
+    long long written;
+
+    written = write_gzip_stream(cookie, buffer, size);
+    return written < 0 ? 0 : (ssize_t)written;
+}
+
+/**
+ * Adapts `seek_gzip_stream` to `cookie_io_functions_t`.
+ */
+static int cookie_seek(void *cookie, off64_t *offset, int whence)
+{
+    long long position;
+
+    position = seek_gzip_stream(cookie, (long long)*offset, whence);
+
+    if (position < 0)
+        return -1;
+
+    *offset = (off64_t)position;
+    return 0;
+}
+
+/**
+ * Adapts `close_gzip_stream` to `cookie_io_functions_t`.
+ */
+static int cookie_close(void *cookie)
+{
+    return close_gzip_stream(cookie);
+}
+
+/**
+ * Wraps the specified gzipped stream into a standard stream.
+ */
+static FILE *wrap_gzip_stream(GzipStream *stream)
+{
+    cookie_io_functions_t functions;
+
+    functions.read = cookie_read;
+    functions.write = cookie_write;
+    functions.seek = cookie_seek;
+    functions.close = cookie_close;
+
+    return fopencookie(stream, stream->writing ? "w" : "r", functions);
+}
+
+#else
+
+/**
+ * Adapts `read_gzip_stream` to `funopen`.
+ */
+static int funopen_read(void *cookie, char *buffer, int size)
+{
+    return (int)read_gzip_stream(cookie, buffer, (size_t)size);
+}
+
+/**
+ * Adapts `write_gzip_stream` to `funopen`.
+ */
+static int funopen_write(void *cookie, const char *buffer, int size)
+{
+    return (int)write_gzip_stream(cookie, buffer, (size_t)size);
+}
+
+/**
+ * Adapts `seek_gzip_stream` to `funopen`.
+ */
+static fpos_t funopen_seek(void *cookie, fpos_t offset, int whence)
+{
+    return (fpos_t)seek_gzip_stream(cookie, (long long)offset, whence);
+}
+
+/**
+ * Adapts `close_gzip_stream` to `funopen`.
+ */
+static int funopen_close(void *cookie)
+{
+    return close_gzip_stream(cookie);
+}
+
+/**
+ * Wraps the specified gzipped stream into a standard stream.
+ */
+static FILE *wrap_gzip_stream(GzipStream *stream)
+{
+    return funopen(stream,
+                   stream->writing ? NULL : funopen_read,
+                   stream->writing ? funopen_write : NULL,
+                   funopen_seek,
+                   funopen_close);
+}
+
+#endif
+
+/**
+ * Opens a gzipped file, starting the task (de)compressing it.
+ */
+static FILE *open_gzip_stream(const char *path, int writing)
+{
+    GzipStream *stream;
+    FILE *file;
+    int i;
+
+    stream = calloc(1, sizeof(GzipStream));
+    ASSERT(stream, "Unable to allocate memory for the gzipped stream", open_gzip_stream);
+
+    stream->writing = writing;
+    stream->file = gzopen(path, writing ? "wb" : "rb");
+    ASSERT(stream->file, "Unable to open the gzipped file", open_gzip_stream);
+    gzbuffer(stream->file, GZIP_BLOCK_SIZE);
+
+    for (i = 0; i < GZIP_QUEUE_BLOCKS; i++)
+    {
+        stream->blocks[i] = malloc(GZIP_BLOCK_SIZE);
+        ASSERT(stream->blocks[i], "Unable to allocate memory for the gzipped stream", open_gzip_stream);
+    }
+
+    file = wrap_gzip_stream(stream);
+    ASSERT(file, "Unable to create the gzipped stream", open_gzip_stream);
+
+    if (!writing)
+        setvbuf(file, NULL, _IOFBF, INPUT_FILE_BUFFER_SIZE);
+
+#if defined(HAVE_PTHREADS)
+    ASSERT(!pthread_mutex_init(&stream->lock, NULL), "Unable to create the gzipped stream lock", open_gzip_stream);
+    ASSERT(!pthread_cond_init(&stream->changed, NULL), "Unable to create the gzipped stream condition", open_gzip_stream);
+    stream->task = start_tasks(1, writing ? deflate_task : inflate_task, stream);
+#endif
+
+    return file;
+}
+
+#else
+
+/**
+ * Aborts: gzipped files are not supported by this build.
+ */
+static FILE *open_gzip_stream(const char *path, int writing)
+{
+    (void)path;
+    (void)writing;
+
+#if defined(HAVE_ZLIB)
+    PRINT_ERROR("Gzipped files are not supported on this platform", open_gzip_stream);
+#else
+    PRINT_ERROR("Gzipped files are not supported (zlib has not been found at build time)", open_gzip_stream);
+#endif
+}
+
+#endif
+
+FILE *open_input_file(const char *path)
+{
+    FILE *file;
+    unsigned char magic[sizeof(GZIP_MAGIC)];
+
+    ASSERT_NULL_PARAMETER(path, open_input_file);
+
+    file = fopen(path, "rb");
+    ASSERT(file, "Unable to open input file", open_input_file);
+    setvbuf(file, NULL, _IOFBF, INPUT_FILE_BUFFER_SIZE);
+
+    if (fread(magic, 1, sizeof(magic), file) == sizeof(magic) && !memcmp(magic, GZIP_MAGIC, sizeof(magic)))
+    {
+        fclose(file);
+        return open_gzip_stream(path, 0);
+    }
+
+    rewind(file);
+    return file;
+}
+
+FILE *open_output_file(const char *path, int binary)
+{
+    FILE *file;
+
+    ASSERT_NULL_PARAMETER(path, open_output_file);
+
+    if (is_gzip_path(path))
+        return open_gzip_stream(path, 1);
+
+    file = fopen(path, binary ? "wb" : "w");
+    ASSERT(file, "Unable to open output file", open_output_file);
+
+    return file;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdio.h>
+
+/**
+ * The extension of the paths of gzipped files.
+ */
+#define GZIP_FILE_EXTENSION ".gz"
+
+/**
+ * The size of the blocks exchanged with the thread (de)compressing a gzipped file.
+ */
+#define GZIP_BLOCK_SIZE (1 << 20)
+
+/**
+ * The size of the buffer of the files read as records (`open_input_file` sets it right after opening them).
+ */
+#define INPUT_FILE_BUFFER_SIZE (1 << 20)
+
+/**
+ * The number of blocks queued between the thread (de)compressing a gzipped file and the stream.
+ */
+#define GZIP_QUEUE_BLOCKS 4
+
+/**
+ * @brief Tests whether the specified path names a gzipped file (i.e., it ends with `GZIP_FILE_EXTENSION`).
+ *
+ * @param path The path.
+ * @return 1 if the path ends with `GZIP_FILE_EXTENSION`, 0 otherwise.
+ */
+int is_gzip_path(const char *path);
+
+/**
+ * @brief Opens a file for reading, transparently decompressing it if it is gzipped.
+ *
+ * @remark Gzipped files are recognized by their content, not by their extension. They are inflated on a background
+ * thread (if `HAVE_PTHREADS` is defined), which fills a queue of `GZIP_BLOCK_SIZE` blocks consumed by the returned
+ * stream. The stream can only seek within the block being read (e.g., to rewind after sniffing the records file
+ * header), and must be closed with `fclose`.
+ *
+ * @remark Reading a gzipped file aborts if zlib is not available (`HAVE_ZLIB` not defined), or if the platform
+ * does not support custom streams (`fopencookie` or `funopen`).
+ *
+ * @param path The path of the file.
+ * @return The opened stream (never NULL: the execution is aborted if the file cannot be opened).
+ */
+FILE *open_input_file(const char *path);
+
+/**
+ * @brief Opens a file for writing, compressing it with gzip if its path ends with `GZIP_FILE_EXTENSION`.
+ *
+ * @remark Gzipped files are deflated on a background thread (if `HAVE_PTHREADS` is defined), which consumes a queue
+ * of `GZIP_BLOCK_SIZE` blocks filled by the returned stream, so that the writer is not slowed down by the
+ * compression. The stream is not seekable, and must be closed with `fclose`, which waits for the compression
+ * to complete (a failure of the compression is reported as a failure of `fclose`).
+ *
+ * @param path   The path of the file.
+ * @param binary Whether the file is opened in binary mode (ignored by gzipped files, which are always binary).
+ * @return The opened stream (never NULL: the execution is aborted if the file cannot be opened).
+ */
+FILE *open_output_file(const char *path, int binary);
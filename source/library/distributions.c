@@ -0,0 +1,300 @@
+#include "distributions.h"
+#include "diagnostics.h"
+#include <math.h>
+#include <string.h>
+
+/**
+ * The default number of distinct keys of DISTRIBUTION_FEW_UNIQUE.
+ */
+#define DEFAULT_FEW_UNIQUE 16
+
+/**
+ * The default number of distinct keys of DISTRIBUTION_ZIPF.
+ */
+#define DEFAULT_ZIPF_UNIQUE 1000
+
+/**
+ * An entry of the sparse map of the positions displaced by DISTRIBUTION_NEARLY_SORTED.
+ */
+typedef struct SwapEntry
+{
+    size_t position; /** The displaced position, plus one (0 marks an empty entry). */
+    size_t value;    /** The key at the displaced position. */
+} SwapEntry;
+
+struct Distribution
+{
+    DistributionId id;  /** The distribution of the keys. */
+    size_t nitems;      /** The number of keys. */
+    uint64_t bound;     /** The (exclusive) upper bound of the keys. */
+    size_t period;      /** The length of the runs of DISTRIBUTION_SAWTOOTH. */
+    Rng rng;            /** The generator of the random choices. */
+    SwapEntry *swaps;   /** The open-addressing map of the displaced positions of DISTRIBUTION_NEARLY_SORTED. */
+    size_t swaps_mask;  /** The capacity of `swaps`, minus one (capacity is a power of two). */
+    double *zipf_cdf;   /** The cumulative distribution function of DISTRIBUTION_ZIPF. */
+};
+
+void rng_seed(Rng *rng, uint64_t seed)
+{
+    ASSERT_NULL_PARAMETER(rng, rng_seed);
+    rng->state = seed;
+}
+
+uint64_t rng_next(Rng *rng)
+{
+    uint64_t z;
+
+    z = (rng->state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+uint64_t rng_next_below(Rng *rng, uint64_t bound)
+{
+    ASSERT(bound > 0, "The bound must be greater than zero", rng_next_below);
+    return rng_next(rng) % bound;
+}
+
+double rng_next_double(Rng *rng)
+{
+    return (double)(rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Finds the entry of the specified position in the swaps map (either the existing one or an empty one).
+ */
+static SwapEntry *find_swap_entry(Distribution *distribution, size_t position)
+{
+    size_t slot;
+
+    slot = (size_t)((position * 0x9E3779B97F4A7C15ull) >> 17) & distribution->swaps_mask;
+
+    while (distribution->swaps[slot].position && distribution->swaps[slot].position != position + 1)
+        slot = (slot + 1) & distribution->swaps_mask;
+
+    return &distribution->swaps[slot];
+}
+
+/**
+ * Retrieves the key at the specified position of DISTRIBUTION_NEARLY_SORTED.
+ */
+static size_t get_swapped_value(Distribution *distribution, size_t position)
+{
+    SwapEntry *entry;
+
+    entry = find_swap_entry(distribution, position);
+    return entry->position ? entry->value : position;
+}
+
+/**
+ * Sets the key at the specified position of DISTRIBUTION_NEARLY_SORTED.
+ */
+static void set_swapped_value(Distribution *distribution, size_t position, size_t value)
+{
+    SwapEntry *entry;
+
+    entry = find_swap_entry(distribution, position);
+    entry->position = position + 1;
+    entry->value = value;
+}
+
+/**
+ * Applies the random swaps of DISTRIBUTION_NEARLY_SORTED, storing only the displaced positions.
+ */
+static void init_nearly_sorted(Distribution *distribution, size_t swaps)
+{
+    size_t capacity, i, left, right, left_value;
+
+    for (capacity = 16; capacity < 4 * swaps; capacity *= 2)
+        ;
+
+    distribution->swaps = calloc(capacity, sizeof(SwapEntry));
+    ASSERT(distribution->swaps, "Unable to allocate memory for the swaps map", init_nearly_sorted);
+    distribution->swaps_mask = capacity - 1;
+
+    for (i = 0; i < swaps && distribution->nitems > 1; i++)
+    {
+        left = (size_t)rng_next_below(&distribution->rng, distribution->nitems);
+        right = (size_t)rng_next_below(&distribution->rng, distribution->nitems);
+
+        left_value = get_swapped_value(distribution, left);
+        set_swapped_value(distribution, left, get_swapped_value(distribution, right));
+        set_swapped_value(distribution, right, left_value);
+    }
+}
+
+/**
+ * Precomputes the cumulative distribution function of DISTRIBUTION_ZIPF.
+ */
+static void init_zipf(Distribution *distribution, double exponent)
+{
+    size_t i;
+    double sum;
+
+    distribution->zipf_cdf = malloc(sizeof(double) * (size_t)distribution->bound);
+    ASSERT(distribution->zipf_cdf, "Unable to allocate memory for the Zipf CDF", init_zipf);
+
+    sum = 0;
+
+    for (i = 0; i < distribution->bound; i++)
+    {
+        sum += 1.0 / pow((double)(i + 1), exponent);
+        distribution->zipf_cdf[i] = sum;
+    }
+
+    for (i = 0; i < distribution->bound; i++)
+        distribution->zipf_cdf[i] /= sum;
+}
+
+/**
+ * Draws a key of DISTRIBUTION_ZIPF, searching the drawn probability in the CDF.
+ */
+static uint64_t next_zipf_value(Distribution *distribution)
+{
+    size_t lower, upper, half;
+    double p;
+
+    p = rng_next_double(&distribution->rng);
+    lower = 0;
+    upper = (size_t)distribution->bound - 1;
+
+    while (lower < upper)
+    {
+        half = (lower + upper) / 2;
+
+        if (distribution->zipf_cdf[half] < p)
+            lower = half + 1;
+        else
+            upper = half;
+    }
+
+    return lower;
+}
+
+Distribution *create_distribution(DistributionId distribution_id, size_t nitems, const DistributionParams *params, uint64_t seed)
+{
+    Distribution *distribution;
+    DistributionParams defaults;
+
+    ASSERT(distribution_id >= DISTRIBUTION_UNIFORM && distribution_id <= DISTRIBUTION_ALL_EQUAL, "Invalid distribution id", create_distribution);
+    ASSERT(nitems > 0, "The number of keys must be greater than zero", create_distribution);
+
+    if (!params)
+    {
+        memset(&defaults, 0, sizeof(defaults));
+        params = &defaults;
+    }
+
+    distribution = calloc(1, sizeof(Distribution));
+    ASSERT(distribution, "Unable to allocate memory for the distribution", create_distribution);
+
+    distribution->id = distribution_id;
+    distribution->nitems = nitems;
+    distribution->bound = nitems;
+    rng_seed(&distribution->rng, seed);
+
+    switch (distribution_id)
+    {
+    case DISTRIBUTION_NEARLY_SORTED:
+        init_nearly_sorted(distribution, params->swaps ? params->swaps : nitems / 100);
+        break;
+    case DISTRIBUTION_FEW_UNIQUE:
+        distribution->bound = params->unique ? params->unique : DEFAULT_FEW_UNIQUE;
+        break;
+    case DISTRIBUTION_ZIPF:
+        distribution->bound = params->unique ? params->unique : DEFAULT_ZIPF_UNIQUE;
+        init_zipf(distribution, params->zipf_exponent > 0 ? params->zipf_exponent : 1.0);
+        break;
+    case DISTRIBUTION_ORGAN_PIPE:
+        distribution->bound = (nitems + 1) / 2;
+        break;
+    case DISTRIBUTION_SAWTOOTH:
+        distribution->period = params->period ? params->period : (nitems + 7) / 8;
+        distribution->bound = distribution->period < nitems ? distribution->period : nitems;
+        break;
+    case DISTRIBUTION_ALL_EQUAL:
+        distribution->bound = 1;
+        break;
+    default:
+        break;
+    }
+
+    return distribution;
+}
+
+void destroy_distribution(Distribution *distribution)
+{
+    ASSERT_NULL_PARAMETER(distribution, destroy_distribution);
+
+    free(distribution->swaps);
+    free(distribution->zipf_cdf);
+    free(distribution);
+}
+
+uint64_t distribution_value(Distribution *distribution, size_t index)
+{
+    switch (distribution->id)
+    {
+    case DISTRIBUTION_UNIFORM:
+    case DISTRIBUTION_FEW_UNIQUE:
+        return rng_next_below(&distribution->rng, distribution->bound);
+    case DISTRIBUTION_SORTED:
+        return index;
+    case DISTRIBUTION_REVERSED:
+        return distribution->nitems - 1 - index;
+    case DISTRIBUTION_NEARLY_SORTED:
+        return get_swapped_value(distribution, index);
+    case DISTRIBUTION_ZIPF:
+        return next_zipf_value(distribution);
+    case DISTRIBUTION_ORGAN_PIPE:
+        return index < distribution->bound ? index : distribution->nitems - 1 - index;
+    case DISTRIBUTION_SAWTOOTH:
+        return index % distribution->period;
+    case DISTRIBUTION_ALL_EQUAL:
+        return 0;
+    }
+
+    PRINT_ERROR("Invalid distribution ID", distribution_value);
+}
+
+uint64_t distribution_bound(const Distribution *distribution)
+{
+    return distribution->bound;
+}
+
+/**
+ * The names of the distributions, indexed by DistributionId.
+ */
+static const char *const DISTRIBUTION_NAMES[] = {
+    NULL,
+    "uniform",
+    "sorted",
+    "reversed",
+    "nearly-sorted",
+    "few-unique",
+    "zipf",
+    "organ-pipe",
+    "sawtooth",
+    "all-equal"};
+
+DistributionId parse_distribution_name(const char *name)
+{
+    int i;
+
+    ASSERT_NULL_PARAMETER(name, parse_distribution_name);
+
+    for (i = DISTRIBUTION_UNIFORM; i <= DISTRIBUTION_ALL_EQUAL; i++)
+    {
+        if (!strcmp(DISTRIBUTION_NAMES[i], name))
+            return (DistributionId)i;
+    }
+
+    return (DistributionId)0;
+}
+
+const char *get_distribution_name(DistributionId distribution_id)
+{
+    ASSERT(distribution_id >= DISTRIBUTION_UNIFORM && distribution_id <= DISTRIBUTION_ALL_EQUAL, "Invalid distribution ID", get_distribution_name);
+    return DISTRIBUTION_NAMES[distribution_id];
+}
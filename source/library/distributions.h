@@ -0,0 +1,133 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief A seeded pseudo-random number generator (splitmix64).
+ *
+ * @remark Unlike `rand()`, the generated sequence only depends on the seed, so it is the same on every platform.
+ */
+typedef struct Rng
+{
+    uint64_t state; /** The internal state of the generator. */
+} Rng;
+
+/**
+ * @brief Seeds the specified generator.
+ *
+ * @param rng  Pointer to the generator.
+ * @param seed The seed.
+ */
+void rng_seed(Rng *rng, uint64_t seed);
+
+/**
+ * @brief Generates the next 64-bit pseudo-random value.
+ *
+ * @param rng Pointer to the generator.
+ * @return The generated value.
+ */
+uint64_t rng_next(Rng *rng);
+
+/**
+ * @brief Generates a pseudo-random value in range `[0, bound - 1]`.
+ *
+ * @param rng   Pointer to the generator.
+ * @param bound The (exclusive) upper bound, which shall be greater than zero.
+ * @return The generated value.
+ */
+uint64_t rng_next_below(Rng *rng, uint64_t bound);
+
+/**
+ * @brief Generates a pseudo-random value in range `[0, 1)`.
+ *
+ * @param rng Pointer to the generator.
+ * @return The generated value.
+ */
+double rng_next_double(Rng *rng);
+
+/**
+ * @brief Specifies the various input distributions of the generated keys.
+ */
+typedef enum DistributionId
+{
+    DISTRIBUTION_UNIFORM = 1,   // Uniformly random keys in range [0, N - 1].
+    DISTRIBUTION_SORTED,        // Ascending keys.
+    DISTRIBUTION_REVERSED,      // Descending keys.
+    DISTRIBUTION_NEARLY_SORTED, // Ascending keys with K random swaps.
+    DISTRIBUTION_FEW_UNIQUE,    // Uniformly random keys among U distinct values.
+    DISTRIBUTION_ZIPF,          // Zipf-distributed keys among U distinct values (key 0 being the most frequent).
+    DISTRIBUTION_ORGAN_PIPE,    // Ascending keys up to the half, then descending keys.
+    DISTRIBUTION_SAWTOOTH,      // Ascending runs of P keys.
+    DISTRIBUTION_ALL_EQUAL      // The same key repeated.
+} DistributionId;
+
+/**
+ * @brief The parameters of the distributions (ignored by the distributions that do not need them).
+ */
+typedef struct DistributionParams
+{
+    size_t swaps;         /** The number of swaps of DISTRIBUTION_NEARLY_SORTED (0 means N / 100). */
+    size_t unique;        /** The number of distinct keys of DISTRIBUTION_FEW_UNIQUE and DISTRIBUTION_ZIPF (0 means the default). */
+    double zipf_exponent; /** The exponent of DISTRIBUTION_ZIPF (0 means 1.0). */
+    size_t period;        /** The length of the runs of DISTRIBUTION_SAWTOOTH (0 means N / 8). */
+} DistributionParams;
+
+/**
+ * @brief A generator of N keys following a distribution.
+ */
+typedef struct Distribution Distribution;
+
+/**
+ * @brief Creates a generator of keys following the specified distribution.
+ *
+ * @param distribution_id The distribution of the keys.
+ * @param nitems          The number of keys to be generated.
+ * @param params          The parameters of the distribution (NULL to use the defaults).
+ * @param seed            The seed of the random choices made by the distribution.
+ * @return The created generator.
+ */
+Distribution *create_distribution(DistributionId distribution_id, size_t nitems, const DistributionParams *params, uint64_t seed);
+
+/**
+ * @brief Destroys the specified generator.
+ *
+ * @param distribution The generator to be destroyed.
+ */
+void destroy_distribution(Distribution *distribution);
+
+/**
+ * @brief Generates the key at the specified index.
+ *
+ * @remark Keys must be requested in order, from index 0 to N - 1: the random distributions draw a new value on
+ * each call.
+ *
+ * @param distribution The generator.
+ * @param index        The index of the key.
+ * @return The generated key, in range `[0, distribution_bound(distribution) - 1]`.
+ */
+uint64_t distribution_value(Distribution *distribution, size_t index);
+
+/**
+ * @brief Retrieves the (exclusive) upper bound of the generated keys.
+ *
+ * @param distribution The generator.
+ * @return The upper bound of the generated keys.
+ */
+uint64_t distribution_bound(const Distribution *distribution);
+
+/**
+ * @brief Parses the name of a distribution (e.g., `uniform`, `nearly-sorted`, `zipf`).
+ *
+ * @param name The name of the distribution.
+ * @return The parsed distribution ID, or 0 if the name is not valid.
+ */
+DistributionId parse_distribution_name(const char *name);
+
+/**
+ * @brief Retrieves the name of the specified distribution.
+ *
+ * @param distribution_id The ID of the distribution.
+ * @return A string representing the name of the distribution.
+ */
+const char *get_distribution_name(DistributionId distribution_id);
@@ -0,0 +1,246 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "large-alloc.h"
+#include "diagnostics.h"
+#include "parallel.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+#if defined(HAVE_NUMA)
+#include <numa.h>
+#endif
+
+/**
+ * The space reserved before a large buffer for its header (so that the buffer is aligned to a cache line).
+ */
+#define LARGE_ALLOC_HEADER 64
+
+/**
+ * The size of a (default) huge page, to which mapped buffers are aligned.
+ */
+#define HUGE_PAGE_SIZE ((size_t)1 << 21)
+
+/**
+ * The distance between the bytes written by `prefault_large` (the smallest page size).
+ */
+#define PREFAULT_STRIDE 4096
+
+/**
+ * Aligns an address up to a power of two.
+ */
+#define ALIGN_UP(address, alignment) (((uintptr_t)(address) + (alignment) - 1) & ~(uintptr_t)((alignment) - 1))
+
+/**
+ * The header stored right before a large buffer.
+ */
+typedef struct LargeHeader
+{
+    void *base;    /** The beginning of the mapping, or of the `malloc` block. */
+    size_t mapped; /** The size of the mapping (0 if the buffer has been allocated by `malloc`). */
+} LargeHeader;
+
+/**
+ * Specifies the huge pages backing the mapped buffers (see `HUGE_PAGES_ENV`).
+ */
+typedef enum HugePagesMode
+{
+    HUGE_PAGES_TRANSPARENT = 0, // Transparent huge pages, where the kernel supports them.
+    HUGE_PAGES_EXPLICIT,        // Reserved huge pages, falling back to transparent ones.
+    HUGE_PAGES_OFF              // Regular pages.
+} HugePagesMode;
+
+/**
+ * Reads the huge pages mode from the environment.
+ */
+static HugePagesMode get_huge_pages_mode(void)
+{
+    const char *value;
+
+    value = getenv(HUGE_PAGES_ENV);
+
+    if (value && !strcmp(value, "explicit"))
+        return HUGE_PAGES_EXPLICIT;
+
+    if (value && !strcmp(value, "off"))
+        return HUGE_PAGES_OFF;
+
+    return HUGE_PAGES_TRANSPARENT;
+}
+
+#if !defined(_WIN32)
+
+/**
+ * Interleaves the pages of a mapping over the NUMA nodes, unless first-touch placement has been requested.
+ */
+static void place_pages(void *mapping, size_t mapped)
+{
+#if defined(HAVE_NUMA)
+    const char *value;
+
+    value = getenv(NUMA_ENV);
+
+    if ((!value || strcmp(value, "first-touch")) && numa_available() >= 0 && numa_num_configured_nodes() > 1)
+        numa_interleave_memory(mapping, mapped, numa_all_nodes_ptr);
+#else
+    (void)mapping;
+    (void)mapped;
+#endif
+}
+
+/**
+ * Maps anonymous memory aligned to the huge page size, backed by huge pages according to the mode.
+ *
+ * @return The mapping, or NULL on failure.
+ */
+static char *map_pages(size_t mapped, HugePagesMode mode)
+{
+    char *mapping, *aligned;
+    size_t head;
+
+#if defined(MAP_HUGETLB)
+    if (mode == HUGE_PAGES_EXPLICIT)
+    {
+        mapping = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (mapping != MAP_FAILED)
+            return mapping;
+    }
+#endif
+
+    // Map a huge page more than needed, then unmap the unaligned head and tail.
+    mapping = mmap(NULL, mapped + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mapping == MAP_FAILED)
+        return NULL;
+
+    aligned = (char *)ALIGN_UP(mapping, HUGE_PAGE_SIZE);
+    head = (size_t)(aligned - mapping);
+
+    if (head)
+        munmap(mapping, head);
+
+    if (HUGE_PAGE_SIZE - head)
+        munmap(aligned + mapped, HUGE_PAGE_SIZE - head);
+
+#if defined(MADV_HUGEPAGE)
+    if (mode != HUGE_PAGES_OFF)
+        madvise(aligned, mapped, MADV_HUGEPAGE);
+#else
+    (void)mode;
+#endif
+
+    return aligned;
+}
+
+#endif
+
+void *allocate_large(size_t bytes)
+{
+    LargeHeader *header;
+    char *block, *buffer;
+#if !defined(_WIN32)
+    size_t mapped;
+
+    if (bytes >= LARGE_ALLOC_THRESHOLD)
+    {
+        mapped = (bytes + LARGE_ALLOC_HEADER + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        block = map_pages(mapped, get_huge_pages_mode());
+
+        if (block)
+        {
+            place_pages(block, mapped);
+
+            buffer = block + LARGE_ALLOC_HEADER;
+            header = (LargeHeader *)buffer - 1;
+            header->base = block;
+            header->mapped = mapped;
+
+            return buffer;
+        }
+    }
+#endif
+
+    block = malloc(bytes + 2 * LARGE_ALLOC_HEADER);
+
+    if (!block)
+        return NULL;
+
+    buffer = (char *)ALIGN_UP(block + sizeof(LargeHeader), LARGE_ALLOC_HEADER);
+    header = (LargeHeader *)buffer - 1;
+    header->base = block;
+    header->mapped = 0;
+
+    return buffer;
+}
+
+void free_large(void *ptr)
+{
+    LargeHeader *header;
+
+    if (!ptr)
+        return;
+
+    header = (LargeHeader *)ptr - 1;
+
+#if !defined(_WIN32)
+    if (header->mapped)
+    {
+        munmap(header->base, header->mapped);
+        return;
+    }
+#endif
+
+    free(header->base);
+}
+
+/**
+ * A buffer written by `prefault_large`, one slice per task.
+ */
+typedef struct PrefaultSlices
+{
+    char *buffer;      /** The buffer. */
+    size_t bytes;      /** The size of the buffer. */
+    size_t num_slices; /** The number of slices. */
+} PrefaultSlices;
+
+/**
+ * Writes a byte of each page of a slice.
+ */
+static void prefault_slice(void *context, size_t slice)
+{
+    PrefaultSlices *slices = (PrefaultSlices *)context;
+    size_t start, end;
+
+    // Slice bounds are rounded to pages, so that every page is first written by a single thread.
+    start = slices->bytes / slices->num_slices * slice / PREFAULT_STRIDE * PREFAULT_STRIDE;
+    end = slice + 1 == slices->num_slices ? slices->bytes : slices->bytes / slices->num_slices * (slice + 1) / PREFAULT_STRIDE * PREFAULT_STRIDE;
+
+    for (; start < end; start += PREFAULT_STRIDE)
+        slices->buffer[start] = 0;
+}
+
+void prefault_large(void *ptr, size_t bytes)
+{
+    PrefaultSlices slices;
+
+    ASSERT(ptr || !bytes, "'ptr' parameter is NULL", prefault_large);
+
+    if (bytes < LARGE_ALLOC_THRESHOLD)
+        return;
+
+    slices.buffer = ptr;
+    slices.bytes = bytes;
+    slices.num_slices = get_num_threads();
+
+    parallel_for(slices.num_slices, prefault_slice, &slices);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Allocations of at least this size are mapped directly (see `allocate_large`), smaller ones use `malloc`.
+ */
+#define LARGE_ALLOC_THRESHOLD ((size_t)1 << 21)
+
+/**
+ * The environment variable which selects the huge pages of large allocations: `transparent` (the default) advises
+ * the kernel to back them with transparent huge pages, `explicit` maps them from the reserved huge pages (falling
+ * back to transparent ones if none is available), `off` uses regular pages.
+ */
+#define HUGE_PAGES_ENV "SORTING_HUGE_PAGES"
+
+/**
+ * The environment variable which selects the NUMA placement of large allocations: `interleave` (the default where
+ * libnuma is available and the machine has several nodes) spreads their pages over every node, `first-touch` leaves
+ * each page on the node of the thread which first writes it.
+ */
+#define NUMA_ENV "SORTING_NUMA"
+
+/**
+ * @brief Allocates a large buffer (e.g., an array of records or the scratch memory of a sort).
+ *
+ * @remark Buffers of at least `LARGE_ALLOC_THRESHOLD` bytes are mapped with `mmap` (where available), aligned to the
+ * huge page size and backed by huge pages according to `SORTING_HUGE_PAGES`, so that sorting them causes fewer TLB
+ * misses; their pages are interleaved over the NUMA nodes according to `SORTING_NUMA` (if `HAVE_NUMA` is defined).
+ * Pages are only placed when first written: see `prefault_large` to write them from the worker threads.
+ *
+ * @param bytes The size of the buffer, in bytes.
+ * @return The allocated buffer (aligned to 64 bytes), to be released with `free_large`, or NULL on failure.
+ */
+void *allocate_large(size_t bytes);
+
+/**
+ * @brief Releases a buffer allocated by `allocate_large`.
+ *
+ * @param ptr The buffer (NULL is ignored).
+ */
+void free_large(void *ptr);
+
+/**
+ * @brief Writes the pages of a buffer from the worker threads (see `parallel_for`), each thread the pages of its own
+ * slice, so that first-touch placement spreads them over the NUMA nodes of the threads.
+ *
+ * @remark The content of the buffer is not preserved. It is only useful for buffers which would otherwise be first
+ * written by a single thread (e.g., by `fread`).
+ *
+ * @param ptr   The buffer.
+ * @param bytes The size of the buffer, in bytes.
+ */
+void prefault_large(void *ptr, size_t bytes);
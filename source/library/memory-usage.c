@@ -0,0 +1,142 @@
+#include "memory-usage.h"
+#include "diagnostics.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(HAVE_PTHREADS)
+#include <pthread.h>
+#endif
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+/**
+ * The bytes counted for each phase.
+ */
+static size_t g_phase_memory[MEMORY_PHASE_COUNT];
+
+#if defined(HAVE_PTHREADS)
+/**
+ * Protects `g_phase_memory` (buffers are also allocated by worker threads, e.g. by the batch jobs).
+ */
+static pthread_mutex_t g_phase_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/**
+ * The names of the phases, indexed by MemoryPhase.
+ */
+static const char *const PHASE_NAMES[] = {"load", "sort", "spill", "store"};
+
+void count_memory(MemoryPhase phase, size_t bytes)
+{
+    ASSERT(phase >= MEMORY_PHASE_LOAD && phase < MEMORY_PHASE_COUNT, "Invalid memory phase", count_memory);
+
+#if defined(HAVE_PTHREADS)
+    pthread_mutex_lock(&g_phase_lock);
+    g_phase_memory[phase] += bytes;
+    pthread_mutex_unlock(&g_phase_lock);
+#else
+    g_phase_memory[phase] += bytes;
+#endif
+}
+
+size_t get_phase_memory(MemoryPhase phase)
+{
+    size_t bytes;
+
+    ASSERT(phase >= MEMORY_PHASE_LOAD && phase < MEMORY_PHASE_COUNT, "Invalid memory phase", get_phase_memory);
+
+#if defined(HAVE_PTHREADS)
+    pthread_mutex_lock(&g_phase_lock);
+    bytes = g_phase_memory[phase];
+    pthread_mutex_unlock(&g_phase_lock);
+#else
+    bytes = g_phase_memory[phase];
+#endif
+
+    return bytes;
+}
+
+size_t get_peak_rss(void)
+{
+#if !defined(_WIN32)
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage))
+        return 0;
+
+#if defined(__APPLE__)
+    // macOS reports bytes, the other platforms kilobytes.
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+int parse_memory_size(const char *str, size_t *bytes)
+{
+    unsigned long long value;
+    char suffix;
+    int consumed, shift;
+
+    ASSERT_NULL_PARAMETER(str, parse_memory_size);
+    ASSERT_NULL_PARAMETER(bytes, parse_memory_size);
+
+    if (sscanf(str, "%llu%n", &value, &consumed) != 1)
+        return 0;
+
+    suffix = str[consumed];
+
+    if (suffix == 'K' || suffix == 'k')
+        shift = 10;
+    else if (suffix == 'M' || suffix == 'm')
+        shift = 20;
+    else if (suffix == 'G' || suffix == 'g')
+        shift = 30;
+    else if (suffix == '\0')
+        shift = 0;
+    else
+        return 0;
+
+    if (suffix != '\0' && str[consumed + 1] != '\0')
+        return 0;
+
+    // A size wrapping around would silently become a much smaller budget.
+    ASSERT(value <= (SIZE_MAX >> shift), "The memory size is too large", parse_memory_size);
+    value <<= shift;
+
+    *bytes = (size_t)value;
+    return value > 0;
+}
+
+/**
+ * Converts a number of bytes to mebibytes.
+ */
+#define TO_MIB(bytes) ((double)(bytes) / (1 << 20))
+
+void print_memory_report(FILE *out_file, size_t budget)
+{
+    size_t peak_rss;
+    int phase;
+
+    ASSERT_NULL_PARAMETER(out_file, print_memory_report);
+
+    peak_rss = get_peak_rss();
+
+    if (peak_rss)
+        fprintf(out_file, "Peak RSS: %.1f MiB", TO_MIB(peak_rss));
+    else
+        fprintf(out_file, "Peak RSS: not available");
+
+    if (budget)
+        fprintf(out_file, " (budget %.1f MiB)", TO_MIB(budget));
+
+    fprintf(out_file, "\n");
+
+    for (phase = MEMORY_PHASE_LOAD; phase < MEMORY_PHASE_COUNT; phase++)
+        fprintf(out_file, "  %-5s %10.1f MiB allocated\n", PHASE_NAMES[phase], TO_MIB(get_phase_memory((MemoryPhase)phase)));
+}
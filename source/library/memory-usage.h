@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @brief Specifies the phases whose allocations are reported by `print_memory_report`.
+ */
+typedef enum MemoryPhase
+{
+    MEMORY_PHASE_LOAD = 0, // The input text and the loaded records (or chunks of records).
+    MEMORY_PHASE_SORT,     // The scratch memory of the sort engines (e.g., the merge buffers of merge sort).
+    MEMORY_PHASE_SPILL,    // The buffers reading the runs spilled to disk while merging them.
+    MEMORY_PHASE_STORE,    // The buffers of the output writers.
+    MEMORY_PHASE_COUNT     // The number of phases (not a phase).
+} MemoryPhase;
+
+/**
+ * @brief Counts the bytes of a buffer allocated during the specified phase.
+ *
+ * @remark Only the large buffers (proportional to the records or to the I/O block sizes) are counted; merge sort
+ * counts its largest merge buffer, which is the one that determines its peak. Counting is thread-safe.
+ *
+ * @param phase The phase.
+ * @param bytes The number of bytes allocated.
+ */
+void count_memory(MemoryPhase phase, size_t bytes);
+
+/**
+ * @brief Retrieves the bytes counted for the specified phase so far.
+ *
+ * @param phase The phase.
+ * @return The number of bytes counted.
+ */
+size_t get_phase_memory(MemoryPhase phase);
+
+/**
+ * @brief Retrieves the peak resident set size of the process.
+ *
+ * @return The peak resident set size in bytes, or 0 if it cannot be measured (e.g., without `getrusage`).
+ */
+size_t get_peak_rss(void);
+
+/**
+ * @brief Parses a memory size, in bytes or with a `K`, `M` or `G` suffix (powers of 1024, e.g., `512M`).
+ *
+ * @param str   The string to be parsed.
+ * @param bytes Pointer to the variable receiving the number of bytes.
+ * @return 1 if the string is a valid memory size, 0 otherwise.
+ *
+ * @remark Sizes which do not fit a `size_t` are rejected with an error.
+ */
+int parse_memory_size(const char *str, size_t *bytes);
+
+/**
+ * @brief Prints the peak resident set size and the bytes counted for each phase.
+ *
+ * @param out_file The file the report is printed to.
+ * @param budget   The memory budget to be reported (0 if none).
+ */
+void print_memory_report(FILE *out_file, size_t budget);
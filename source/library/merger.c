@@ -0,0 +1,136 @@
+#include "merger.h"
+#include "diagnostics.h"
+#include <stdlib.h>
+
+/**
+ * Marks the absence of a source whose element has to be replaced.
+ */
+#define NO_SOURCE ((size_t)-1)
+
+struct Merger
+{
+    void **sources;                               /** The merged sources. */
+    size_t num_sources;                           /** The number of sources. */
+    MergeSourceFn next;                           /** The function retrieving the next element of a source. */
+    int (*compar)(const void *, const void *);    /** The comparison function of the elements. */
+    const void **current;                         /** The current element of each source (NULL if exhausted). */
+    size_t *tree;                                 /** The winner (index 0) and the losers of each internal node. */
+    size_t pending;                               /** The source of the last returned element, to be advanced. */
+};
+
+/**
+ * Tests whether the current element of source `a` precedes the one of source `b` (exhausted sources come last,
+ * ties are broken by source index).
+ */
+static int precedes(const Merger *merger, size_t a, size_t b)
+{
+    int result;
+
+    if (!merger->current[a])
+        return 0;
+
+    if (!merger->current[b])
+        return 1;
+
+    result = merger->compar(merger->current[a], merger->current[b]);
+    return result < 0 || (result == 0 && a < b);
+}
+
+Merger *create_merger(void **sources, size_t num_sources, MergeSourceFn next, int (*compar)(const void *, const void *))
+{
+    Merger *merger;
+    size_t *winners;
+    size_t i, node, left, right;
+
+    ASSERT_NULL_PARAMETER(sources, create_merger);
+    ASSERT_NULL_PARAMETER(next, create_merger);
+    ASSERT_NULL_PARAMETER(compar, create_merger);
+    ASSERT(num_sources > 0, "At least one source is required", create_merger);
+
+    merger = malloc(sizeof(Merger));
+    ASSERT(merger, "Unable to allocate memory for the merger", create_merger);
+
+    merger->sources = sources;
+    merger->num_sources = num_sources;
+    merger->next = next;
+    merger->compar = compar;
+    merger->pending = NO_SOURCE;
+
+    merger->current = malloc(sizeof(const void *) * num_sources);
+    merger->tree = malloc(sizeof(size_t) * num_sources);
+    winners = malloc(sizeof(size_t) * 2 * num_sources);
+    ASSERT(merger->current && merger->tree && winners, "Unable to allocate memory for the loser tree", create_merger);
+
+    for (i = 0; i < num_sources; i++)
+    {
+        merger->current[i] = next(sources[i]);
+        winners[num_sources + i] = i;
+    }
+
+    // Leaves are nodes [k, 2k - 1]: each internal node keeps the loser and passes the winner up.
+    for (node = num_sources - 1; node > 0; node--)
+    {
+        left = winners[2 * node];
+        right = winners[2 * node + 1];
+
+        if (precedes(merger, left, right))
+        {
+            winners[node] = left;
+            merger->tree[node] = right;
+        }
+        else
+        {
+            winners[node] = right;
+            merger->tree[node] = left;
+        }
+    }
+
+    merger->tree[0] = num_sources > 1 ? winners[1] : 0;
+
+    free(winners);
+    return merger;
+}
+
+void destroy_merger(Merger *merger)
+{
+    ASSERT_NULL_PARAMETER(merger, destroy_merger);
+
+    free(merger->current);
+    free(merger->tree);
+    free(merger);
+}
+
+const void *merger_next(Merger *merger)
+{
+    size_t winner, node, loser;
+
+    if (merger->pending != NO_SOURCE)
+    {
+        // Replace the returned element, replaying the matches from its leaf up to the root.
+        winner = merger->pending;
+        merger->current[winner] = merger->next(merger->sources[winner]);
+
+        for (node = (winner + merger->num_sources) / 2; node > 0; node /= 2)
+        {
+            if (precedes(merger, merger->tree[node], winner))
+            {
+                loser = winner;
+                winner = merger->tree[node];
+                merger->tree[node] = loser;
+            }
+        }
+
+        merger->tree[0] = winner;
+    }
+
+    winner = merger->tree[0];
+
+    if (!merger->current[winner])
+    {
+        merger->pending = NO_SOURCE;
+        return NULL;
+    }
+
+    merger->pending = winner;
+    return merger->current[winner];
+}
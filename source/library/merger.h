@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief Retrieves the next element of a sorted source.
+ *
+ * @param source The source.
+ * @return A pointer to the next element (valid until the next call on the same source), or NULL if the source is
+ *         exhausted.
+ */
+typedef const void *(*MergeSourceFn)(void *source);
+
+/**
+ * @brief A k-way merger of sorted sources (i.e., a loser tree over their current elements).
+ */
+typedef struct Merger Merger;
+
+/**
+ * @brief Creates a merger of the specified sorted sources.
+ *
+ * @remark Equal elements are produced in the order of their sources, so merging consecutive sorted runs of a
+ * stable sort is stable too.
+ *
+ * @param sources     The sources to be merged.
+ * @param num_sources The number of sources.
+ * @param next        The function retrieving the next element of a source.
+ * @param compar      The comparison function of the elements.
+ * @return The created merger.
+ */
+Merger *create_merger(void **sources, size_t num_sources, MergeSourceFn next, int (*compar)(const void *, const void *));
+
+/**
+ * @brief Destroys the specified merger (the sources are not destroyed).
+ *
+ * @param merger The merger to be destroyed.
+ */
+void destroy_merger(Merger *merger);
+
+/**
+ * @brief Retrieves the next element of the merged sequence.
+ *
+ * @param merger The merger.
+ * @return A pointer to the next element (valid until the next call), or NULL if every source is exhausted.
+ */
+const void *merger_next(Merger *merger);
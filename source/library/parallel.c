@@ -0,0 +1,339 @@
+#include "parallel.h"
+#include "diagnostics.h"
+#include <stdlib.h>
+
+#if defined(HAVE_PTHREADS)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+size_t get_num_threads(void)
+{
+    const char *value;
+    long num_threads;
+
+    value = getenv(THREADS_ENV);
+
+    if (value && *value)
+        num_threads = atol(value);
+    else
+    {
+#if defined(HAVE_PTHREADS) && defined(_SC_NPROCESSORS_ONLN)
+        num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+        num_threads = 1;
+#endif
+    }
+
+    if (num_threads < 1)
+        return 1;
+
+    if (num_threads > MAX_THREADS)
+        return MAX_THREADS;
+
+    return (size_t)num_threads;
+}
+
+#if defined(HAVE_PTHREADS)
+
+/**
+ * The arguments of a worker thread.
+ */
+typedef struct WorkerArgs
+{
+    ParallelTaskFn task; /** The task function. */
+    void *context;       /** The context shared by the tasks. */
+    size_t index;        /** The index of the task run by the worker. */
+} WorkerArgs;
+
+struct TaskGroup
+{
+    size_t num_tasks;               /** The number of tasks. */
+    pthread_t threads[MAX_THREADS]; /** The threads running the tasks. */
+    WorkerArgs args[MAX_THREADS];   /** The arguments of each thread. */
+};
+
+/**
+ * The entry point of a worker thread.
+ */
+static void *run_worker(void *args)
+{
+    WorkerArgs *worker_args = (WorkerArgs *)args;
+
+    worker_args->task(worker_args->context, worker_args->index);
+    return NULL;
+}
+
+/**
+ * Starts the tasks with indexes in range `[first, last - 1]`, each one on its own thread.
+ */
+static TaskGroup *start_task_range(size_t first, size_t last, ParallelTaskFn task, void *context)
+{
+    TaskGroup *group;
+    size_t i;
+
+    group = malloc(sizeof(TaskGroup));
+    ASSERT(group, "Unable to allocate memory for the task group", start_task_range);
+
+    group->num_tasks = last - first;
+
+    for (i = 0; i < group->num_tasks; i++)
+    {
+        group->args[i].task = task;
+        group->args[i].context = context;
+        group->args[i].index = first + i;
+
+        ASSERT(!pthread_create(&group->threads[i], NULL, run_worker, &group->args[i]), "Unable to create a worker thread", start_task_range);
+    }
+
+    return group;
+}
+
+TaskGroup *start_tasks(size_t num_tasks, ParallelTaskFn task, void *context)
+{
+    ASSERT_NULL_PARAMETER(task, start_tasks);
+    ASSERT(num_tasks <= MAX_THREADS, "Too many parallel tasks", start_tasks);
+
+    return start_task_range(0, num_tasks, task, context);
+}
+
+void wait_tasks(TaskGroup *group)
+{
+    size_t i;
+
+    if (!group)
+        return;
+
+    for (i = 0; i < group->num_tasks; i++)
+        ASSERT(!pthread_join(group->threads[i], NULL), "Unable to join a worker thread", wait_tasks);
+
+    free(group);
+}
+
+void parallel_for(size_t num_tasks, ParallelTaskFn task, void *context)
+{
+    TaskGroup *group;
+
+    ASSERT_NULL_PARAMETER(task, parallel_for);
+    ASSERT(num_tasks <= MAX_THREADS, "Too many parallel tasks", parallel_for);
+
+    if (!num_tasks)
+        return;
+
+    // The calling thread runs the first task itself.
+    group = start_task_range(1, num_tasks, task, context);
+    task(context, 0);
+    wait_tasks(group);
+}
+
+struct ThreadPool
+{
+    size_t num_threads;               /** The number of workers, including the thread running the batches. */
+    pthread_t threads[MAX_THREADS];   /** The worker threads (`num_threads - 1`). */
+    pthread_mutex_t lock;             /** Protects the fields below. */
+    pthread_cond_t batch_started;     /** Signaled when a batch is started, or when the pool is stopped. */
+    pthread_cond_t batch_completed;   /** Signaled when the last task of a batch completes. */
+    ParallelTaskFn task;              /** The task function of the current batch. */
+    void *context;                    /** The context of the current batch. */
+    size_t num_tasks;                 /** The number of tasks of the current batch. */
+    size_t next_task;                 /** The index of the next task to be taken. */
+    size_t completed_tasks;           /** The number of completed tasks of the current batch. */
+    size_t batch;                     /** The sequence number of the current batch. */
+    int stopping;                     /** Whether the workers shall exit. */
+};
+
+/**
+ * Takes and runs the tasks of the current batch until none is left (the pool lock must be held).
+ */
+static void run_batch_tasks(ThreadPool *pool)
+{
+    size_t index;
+
+    while (pool->next_task < pool->num_tasks)
+    {
+        index = pool->next_task++;
+
+        pthread_mutex_unlock(&pool->lock);
+        pool->task(pool->context, index);
+        pthread_mutex_lock(&pool->lock);
+
+        if (++pool->completed_tasks == pool->num_tasks)
+            pthread_cond_signal(&pool->batch_completed);
+    }
+}
+
+/**
+ * The entry point of a pool worker.
+ */
+static void *run_pool_worker(void *args)
+{
+    ThreadPool *pool = (ThreadPool *)args;
+    size_t batch;
+
+    pthread_mutex_lock(&pool->lock);
+    batch = pool->batch;
+
+    for (;;)
+    {
+        while (!pool->stopping && pool->batch == batch)
+            pthread_cond_wait(&pool->batch_started, &pool->lock);
+
+        if (pool->stopping)
+            break;
+
+        batch = pool->batch;
+        run_batch_tasks(pool);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+ThreadPool *create_thread_pool(size_t num_threads)
+{
+    ThreadPool *pool;
+    size_t i;
+
+    ASSERT(num_threads <= MAX_THREADS, "Too many pool threads", create_thread_pool);
+
+    pool = calloc(1, sizeof(ThreadPool));
+    ASSERT(pool, "Unable to allocate memory for the thread pool", create_thread_pool);
+
+    pool->num_threads = num_threads ? num_threads : get_num_threads();
+
+    ASSERT(!pthread_mutex_init(&pool->lock, NULL), "Unable to initialize the pool lock", create_thread_pool);
+    ASSERT(!pthread_cond_init(&pool->batch_started, NULL), "Unable to initialize a pool condition", create_thread_pool);
+    ASSERT(!pthread_cond_init(&pool->batch_completed, NULL), "Unable to initialize a pool condition", create_thread_pool);
+
+    for (i = 0; i + 1 < pool->num_threads; i++)
+        ASSERT(!pthread_create(&pool->threads[i], NULL, run_pool_worker, pool), "Unable to create a pool thread", create_thread_pool);
+
+    return pool;
+}
+
+void destroy_thread_pool(ThreadPool *pool)
+{
+    size_t i;
+
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->batch_started);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i + 1 < pool->num_threads; i++)
+        ASSERT(!pthread_join(pool->threads[i], NULL), "Unable to join a pool thread", destroy_thread_pool);
+
+    pthread_cond_destroy(&pool->batch_completed);
+    pthread_cond_destroy(&pool->batch_started);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+void run_pool_tasks(ThreadPool *pool, size_t num_tasks, ParallelTaskFn task, void *context)
+{
+    size_t i;
+
+    ASSERT_NULL_PARAMETER(pool, run_pool_tasks);
+    ASSERT_NULL_PARAMETER(task, run_pool_tasks);
+
+    if (!num_tasks)
+        return;
+
+    // A single task (or worker) does not need to wake the other workers up.
+    if (num_tasks == 1 || pool->num_threads == 1)
+    {
+        for (i = 0; i < num_tasks; i++)
+            task(context, i);
+
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    pool->task = task;
+    pool->context = context;
+    pool->num_tasks = num_tasks;
+    pool->next_task = 0;
+    pool->completed_tasks = 0;
+    pool->batch++;
+    pthread_cond_broadcast(&pool->batch_started);
+
+    // The calling thread takes tasks too, then waits for those still running on the workers.
+    run_batch_tasks(pool);
+
+    while (pool->completed_tasks < pool->num_tasks)
+        pthread_cond_wait(&pool->batch_completed, &pool->lock);
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+#else
+
+void parallel_for(size_t num_tasks, ParallelTaskFn task, void *context)
+{
+    size_t i;
+
+    ASSERT_NULL_PARAMETER(task, parallel_for);
+    ASSERT(num_tasks <= MAX_THREADS, "Too many parallel tasks", parallel_for);
+
+    for (i = 0; i < num_tasks; i++)
+        task(context, i);
+}
+
+TaskGroup *start_tasks(size_t num_tasks, ParallelTaskFn task, void *context)
+{
+    // Without thread support, the tasks have already completed when the (empty) group is returned.
+    parallel_for(num_tasks, task, context);
+    return NULL;
+}
+
+void wait_tasks(TaskGroup *group)
+{
+    (void)group;
+}
+
+struct ThreadPool
+{
+    size_t num_threads; /** The number of workers (the tasks are run sequentially anyway). */
+};
+
+ThreadPool *create_thread_pool(size_t num_threads)
+{
+    ThreadPool *pool;
+
+    ASSERT(num_threads <= MAX_THREADS, "Too many pool threads", create_thread_pool);
+
+    pool = malloc(sizeof(ThreadPool));
+    ASSERT(pool, "Unable to allocate memory for the thread pool", create_thread_pool);
+
+    pool->num_threads = num_threads ? num_threads : get_num_threads();
+    return pool;
+}
+
+void destroy_thread_pool(ThreadPool *pool)
+{
+    free(pool);
+}
+
+void run_pool_tasks(ThreadPool *pool, size_t num_tasks, ParallelTaskFn task, void *context)
+{
+    size_t i;
+
+    ASSERT_NULL_PARAMETER(pool, run_pool_tasks);
+    ASSERT_NULL_PARAMETER(task, run_pool_tasks);
+
+    for (i = 0; i < num_tasks; i++)
+        task(context, i);
+}
+
+#endif
+
+size_t get_thread_pool_size(const ThreadPool *pool)
+{
+    ASSERT_NULL_PARAMETER(pool, get_thread_pool_size);
+
+    return pool->num_threads;
+}
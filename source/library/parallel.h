@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * The environment variable which overrides the number of worker threads.
+ */
+#define THREADS_ENV "SORTING_THREADS"
+
+/**
+ * The maximum number of worker threads.
+ */
+#define MAX_THREADS 256
+
+/**
+ * @brief A task run by `parallel_for`.
+ *
+ * @param context The context shared by the tasks.
+ * @param index   The index of the task.
+ */
+typedef void (*ParallelTaskFn)(void *context, size_t index);
+
+/**
+ * @brief Retrieves the number of worker threads.
+ *
+ * @return The value of the `SORTING_THREADS` environment variable if set, the number of online processors
+ * otherwise (at least one, at most `MAX_THREADS`).
+ */
+size_t get_num_threads(void);
+
+/**
+ * @brief Runs the specified tasks, each one on its own thread, and waits for all of them to complete.
+ *
+ * @remark Without thread support (`HAVE_PTHREADS` not defined), or with a single task, the tasks are run
+ * sequentially on the calling thread.
+ *
+ * @param num_tasks The number of tasks, which shall not be greater than `MAX_THREADS`.
+ * @param task      The task function, called with indexes in range `[0, num_tasks - 1]`.
+ * @param context   The context passed to every task.
+ */
+void parallel_for(size_t num_tasks, ParallelTaskFn task, void *context);
+
+/**
+ * @brief A group of tasks running in the background.
+ */
+typedef struct TaskGroup TaskGroup;
+
+/**
+ * @brief Starts the specified tasks, each one on its own thread, without waiting for them.
+ *
+ * @remark Without thread support (`HAVE_PTHREADS` not defined), the tasks are run sequentially before returning.
+ *
+ * @param num_tasks The number of tasks, which shall not be greater than `MAX_THREADS`.
+ * @param task      The task function, called with indexes in range `[0, num_tasks - 1]`.
+ * @param context   The context passed to every task.
+ * @return The started group, to be passed to `wait_tasks`.
+ */
+TaskGroup *start_tasks(size_t num_tasks, ParallelTaskFn task, void *context);
+
+/**
+ * @brief Waits for the tasks of the specified group to complete, and destroys the group.
+ *
+ * @param group The group returned by `start_tasks` (NULL is ignored).
+ */
+void wait_tasks(TaskGroup *group);
+
+/**
+ * @brief A pool of worker threads, kept alive between the batches of tasks it runs.
+ */
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * @brief Creates a pool of worker threads.
+ *
+ * @remark The pool starts `num_threads - 1` threads: the thread calling `run_pool_tasks` is the last worker. Without
+ * thread support (`HAVE_PTHREADS` not defined), no thread is started and the tasks are run sequentially.
+ *
+ * @param num_threads The number of workers, in range `[1, MAX_THREADS]` (0 uses `get_num_threads`).
+ * @return The created pool.
+ */
+ThreadPool *create_thread_pool(size_t num_threads);
+
+/**
+ * @brief Stops the worker threads of the specified pool, and destroys it.
+ *
+ * @param pool The pool to be destroyed (NULL is ignored).
+ */
+void destroy_thread_pool(ThreadPool *pool);
+
+/**
+ * @brief Retrieves the number of workers of the specified pool (including the calling thread).
+ *
+ * @param pool The pool.
+ * @return The number of workers.
+ */
+size_t get_thread_pool_size(const ThreadPool *pool);
+
+/**
+ * @brief Runs the specified tasks on the workers of the pool, and waits for all of them to complete.
+ *
+ * @remark Unlike `parallel_for`, no thread is created: the idle workers are woken up and take the tasks one at a time,
+ * so there may be more tasks than workers. A pool runs a single batch at a time, so it shall not be shared by threads
+ * calling this function concurrently.
+ *
+ * @param pool      The pool.
+ * @param num_tasks The number of tasks.
+ * @param task      The task function, called with indexes in range `[0, num_tasks - 1]`.
+ * @param context   The context passed to every task.
+ */
+void run_pool_tasks(ThreadPool *pool, size_t num_tasks, ParallelTaskFn task, void *context);
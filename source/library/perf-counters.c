@@ -0,0 +1,218 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "perf-counters.h"
+#include "diagnostics.h"
+#include <string.h>
+
+#if defined(__linux__)
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * Builds the configuration of a generic hardware cache event.
+ */
+#define HW_CACHE_CONFIG(cache, op, result) ((cache) | ((op) << 8) | ((result) << 16))
+
+/**
+ * The file descriptors of the open counters (-1 if the counter is not open).
+ */
+static int g_counter_fds[PERF_COUNTER_COUNT] = {-1, -1, -1, -1, -1, -1};
+
+/**
+ * Fills the event attributes of the specified counter.
+ */
+static void init_counter_attributes(PerfCounterId counter_id, struct perf_event_attr *attr)
+{
+    memset(attr, 0, sizeof(*attr));
+    attr->size = sizeof(*attr);
+    attr->disabled = 1;
+    attr->exclude_kernel = 1;
+    attr->exclude_hv = 1;
+    // Threads created by the measured code (e.g., the workers of parallel and pipelined sorts) are counted too.
+    attr->inherit = 1;
+    attr->read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (counter_id)
+    {
+    case PERF_COUNTER_CYCLES:
+        attr->type = PERF_TYPE_HARDWARE;
+        attr->config = PERF_COUNT_HW_CPU_CYCLES;
+        return;
+    case PERF_COUNTER_INSTRUCTIONS:
+        attr->type = PERF_TYPE_HARDWARE;
+        attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+        return;
+    case PERF_COUNTER_L1D_MISSES:
+        attr->type = PERF_TYPE_HW_CACHE;
+        attr->config = HW_CACHE_CONFIG(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+        return;
+    case PERF_COUNTER_LLC_MISSES:
+        attr->type = PERF_TYPE_HW_CACHE;
+        attr->config = HW_CACHE_CONFIG(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+        return;
+    case PERF_COUNTER_BRANCH_MISSES:
+        attr->type = PERF_TYPE_HARDWARE;
+        attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+        return;
+    case PERF_COUNTER_DTLB_MISSES:
+        attr->type = PERF_TYPE_HW_CACHE;
+        attr->config = HW_CACHE_CONFIG(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+        return;
+    case PERF_COUNTER_COUNT:
+        break;
+    }
+
+    PRINT_ERROR("Invalid counter ID", init_counter_attributes);
+}
+
+int perf_counters_open(void)
+{
+    struct perf_event_attr attr;
+    int i, opened;
+
+    ASSERT(!perf_counters_active(), "Performance counters have been already opened", perf_counters_open);
+
+    opened = 0;
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        init_counter_attributes((PerfCounterId)i, &attr);
+
+        // Counters are opened independently (not as a group), so that an unsupported event does not disable the others.
+        g_counter_fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+
+        if (g_counter_fds[i] >= 0)
+            opened++;
+    }
+
+    return opened;
+}
+
+void perf_counters_close(void)
+{
+    int i;
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        if (g_counter_fds[i] >= 0)
+            close(g_counter_fds[i]);
+
+        g_counter_fds[i] = -1;
+    }
+}
+
+int perf_counters_active(void)
+{
+    int i;
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        if (g_counter_fds[i] >= 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+void perf_counters_start(void)
+{
+    int i;
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        if (g_counter_fds[i] < 0)
+            continue;
+
+        ioctl(g_counter_fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(g_counter_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void perf_counters_stop(PerfCounterValues *values)
+{
+    unsigned long long data[3]; // value, time enabled, time running.
+    int i;
+
+    ASSERT_NULL_PARAMETER(values, perf_counters_stop);
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        if (g_counter_fds[i] >= 0)
+            ioctl(g_counter_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        values->values[i] = 0;
+        values->available[i] = 0;
+
+        if (g_counter_fds[i] < 0 || read(g_counter_fds[i], data, sizeof(data)) != (ssize_t)sizeof(data))
+            continue;
+
+        // A counter that never got scheduled on the PMU has not measured anything.
+        if (data[2] == 0)
+            continue;
+
+        // Scale the value if the counter has been multiplexed with other events.
+        values->values[i] = data[2] < data[1]
+                                ? (unsigned long long)((double)data[0] * ((double)data[1] / (double)data[2]))
+                                : data[0];
+        values->available[i] = 1;
+    }
+}
+
+#else
+
+int perf_counters_open(void)
+{
+    return 0;
+}
+
+void perf_counters_close(void)
+{
+}
+
+int perf_counters_active(void)
+{
+    return 0;
+}
+
+void perf_counters_start(void)
+{
+}
+
+void perf_counters_stop(PerfCounterValues *values)
+{
+    ASSERT_NULL_PARAMETER(values, perf_counters_stop);
+    memset(values, 0, sizeof(*values));
+}
+
+#endif
+
+const char *perf_counter_name(PerfCounterId counter_id)
+{
+    switch (counter_id)
+    {
+    case PERF_COUNTER_CYCLES:
+        return "cycles";
+    case PERF_COUNTER_INSTRUCTIONS:
+        return "instructions";
+    case PERF_COUNTER_L1D_MISSES:
+        return "L1D-misses";
+    case PERF_COUNTER_LLC_MISSES:
+        return "LLC-misses";
+    case PERF_COUNTER_BRANCH_MISSES:
+        return "branch-misses";
+    case PERF_COUNTER_DTLB_MISSES:
+        return "dTLB-misses";
+    case PERF_COUNTER_COUNT:
+        break;
+    }
+
+    PRINT_ERROR("Invalid counter ID", perf_counter_name);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+/**
+ * @brief Specifies the hardware performance counters sampled around a measurement.
+ */
+typedef enum PerfCounterId
+{
+    PERF_COUNTER_CYCLES = 0,     // CPU cycles.
+    PERF_COUNTER_INSTRUCTIONS,   // Retired instructions.
+    PERF_COUNTER_L1D_MISSES,     // L1 data cache read misses.
+    PERF_COUNTER_LLC_MISSES,     // Last level cache read misses.
+    PERF_COUNTER_BRANCH_MISSES,  // Mispredicted branches.
+    PERF_COUNTER_DTLB_MISSES,    // Data TLB read misses.
+    PERF_COUNTER_COUNT           // The number of counters (not a counter).
+} PerfCounterId;
+
+/**
+ * @brief The values read from the hardware performance counters after a measurement.
+ */
+typedef struct PerfCounterValues
+{
+    unsigned long long values[PERF_COUNTER_COUNT]; /** The (multiplexing-scaled) value of each counter. */
+    int available[PERF_COUNTER_COUNT];             /** Whether each counter has been measured. */
+} PerfCounterValues;
+
+/**
+ * @brief Opens the hardware performance counters of the calling thread, inherited by the threads it creates.
+ *
+ * @remark The values of a measurement include the threads created (and terminated) while it runs, as the workers of
+ * parallel and pipelined sorts are, but not threads which are still running when it stops.
+ * @remark Counters that cannot be opened (e.g., unsupported events, missing `perf_event_open` permissions inside
+ * containers or non-Linux platforms) are silently skipped and reported as unavailable.
+ *
+ * @return The number of counters that have been successfully opened.
+ */
+int perf_counters_open(void);
+
+/**
+ * @brief Closes the hardware performance counters previously opened with `perf_counters_open`.
+ */
+void perf_counters_close(void);
+
+/**
+ * @brief Checks whether at least one hardware performance counter is open.
+ *
+ * @return A non-zero value if at least one counter is open, zero otherwise.
+ */
+int perf_counters_active(void);
+
+/**
+ * @brief Resets and starts the open hardware performance counters.
+ */
+void perf_counters_start(void);
+
+/**
+ * @brief Stops the open hardware performance counters and reads their values.
+ *
+ * @param values Pointer to the structure receiving the values of the counters.
+ */
+void perf_counters_stop(PerfCounterValues *values);
+
+/**
+ * @brief Retrieves the display name of the specified hardware performance counter.
+ *
+ * @param counter_id The ID of the counter.
+ * @return A string representing the name of the counter.
+ */
+const char *perf_counter_name(PerfCounterId counter_id);
@@ -0,0 +1,238 @@
+#include "records-arena.h"
+#include "diagnostics.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The size of the stack buffer in which the sort key of a string is built, in bytes (a buffer is allocated for longer
+ * strings and keys).
+ */
+#define STRING_KEY_BUFFER_SIZE 512
+
+/**
+ * The strings of the arena being compared.
+ */
+static const char *g_arena_strings;
+
+/**
+ * Writes the normalized form of a string (null-terminated), returning its length: ASCII letters are folded to lower
+ * case, and each run of digits is replaced by '0', the number of its significant digits and those digits.
+ *
+ * @remark The number of digits is a byte in range [1, 254], or 255 followed by the encoding of the number minus 254,
+ * so that longer numbers compare greater and numbers of the same length compare by their digits. The normalized form
+ * is at most `3 * length` bytes long.
+ */
+static size_t normalize_string(char *dest, const char *str, size_t length, int key_flags)
+{
+    size_t i, j, start, digits;
+
+    for (i = 0, j = 0; i < length;)
+    {
+        if ((key_flags & STRING_KEY_NATURAL) && str[i] >= '0' && str[i] <= '9')
+        {
+            for (start = i; i < length && str[i] >= '0' && str[i] <= '9'; i++)
+                ;
+
+            // Leading zeros are not significant, but a zero keeps its last digit.
+            while (start < i - 1 && str[start] == '0')
+                start++;
+
+            dest[j++] = '0';
+
+            for (digits = i - start; digits >= UCHAR_MAX; digits -= UCHAR_MAX - 1)
+                dest[j++] = (char)UCHAR_MAX;
+
+            dest[j++] = (char)digits;
+            memcpy(dest + j, str + start, i - start);
+            j += i - start;
+        }
+        else if ((key_flags & STRING_KEY_FOLD_CASE) && str[i] >= 'A' && str[i] <= 'Z')
+        {
+            dest[j++] = (char)(str[i++] - 'A' + 'a');
+        }
+        else
+        {
+            dest[j++] = str[i++];
+        }
+    }
+
+    dest[j] = '\0';
+    return j;
+}
+
+/**
+ * Adds a string to the arena, after its sort key and a null terminator.
+ *
+ * @remark A key is a null-terminated string, so comparing two stored keys byte by byte orders a key before the ones
+ * it is a prefix of, and equal keys are followed by their strings.
+ */
+static StringRef add_keyed_string(StringArena *arena, const char *str, size_t length, int key_flags)
+{
+    char stack_buffer[STRING_KEY_BUFFER_SIZE];
+    char *buffer, *normalized;
+    size_t key_capacity, buffer_size, key_length;
+    StringRef ref;
+
+    // The buffer holds the key, its terminator and the string; a collation key is transformed from the normalized
+    // string, stored after them, and transformed again into a larger buffer if it does not fit.
+    key_capacity = 3 * length + 1;
+
+    for (;;)
+    {
+        buffer_size = key_capacity + 1 + length + ((key_flags & STRING_KEY_COLLATE) ? 3 * length + 1 : 0);
+        buffer = buffer_size <= sizeof(stack_buffer) ? stack_buffer : malloc(buffer_size);
+        ASSERT(buffer, "Unable to allocate memory for the sort key", add_keyed_string);
+
+        if (!(key_flags & STRING_KEY_COLLATE))
+        {
+            key_length = normalize_string(buffer, str, length, key_flags);
+            break;
+        }
+
+        normalized = buffer + key_capacity + 1 + length;
+        normalize_string(normalized, str, length, key_flags);
+        key_length = strxfrm(buffer, normalized, key_capacity);
+
+        if (key_length < key_capacity)
+            break;
+
+        if (buffer != stack_buffer)
+            free(buffer);
+
+        key_capacity = key_length + 1;
+    }
+
+    memcpy(buffer + key_length + 1, str, length);
+    ref = add_arena_string(arena, buffer, key_length + 1 + length);
+
+    if (buffer != stack_buffer)
+        free(buffer);
+
+    return ref;
+}
+
+/**
+ * Adds a string field to the arena (see `parse_arena_record_csv`).
+ */
+static StringRef add_field_string(StringArena *arena, const char *str, size_t length, int key_flags)
+{
+    return key_flags ? add_keyed_string(arena, str, length, key_flags) : add_arena_string(arena, str, length);
+}
+
+/**
+ * Retrieves a string field from the arena, skipping its sort key.
+ */
+static const char *get_field_string(const StringArena *arena, StringRef ref, int key_flags)
+{
+    const char *str;
+
+    str = get_arena_string(arena, ref);
+
+    return key_flags ? str + strlen(str) + 1 : str;
+}
+
+const char *parse_arena_record_csv(const char *line, ArenaRecord *record, StringArena *arena, int key_flags)
+{
+    const char *field;
+    char *end;
+    size_t len;
+
+    record->id = (int)strtol(line, &end, 10);
+    ASSERT(*end == ',', "Malformed CSV record (id field)", parse_arena_record_csv);
+
+    field = end + 1;
+
+    for (len = 0; field[len] && field[len] != ',' && field[len] != '\n'; len++)
+        ;
+
+    ASSERT(field[len] == ',', "Malformed CSV record (string field)", parse_arena_record_csv);
+
+    record->field1 = add_field_string(arena, field, len, key_flags);
+
+    record->field2 = (int)strtol(field + len + 1, &end, 10);
+    ASSERT(*end == ',', "Malformed CSV record (integer field)", parse_arena_record_csv);
+
+    record->field3 = strtof(end + 1, &end);
+
+    while (*end && *end != '\n')
+        end++;
+
+    return *end ? end + 1 : end;
+}
+
+void to_arena_record(const Record *record, ArenaRecord *arena_record, StringArena *arena, int key_flags)
+{
+    arena_record->id = record->id;
+    arena_record->field1 = add_field_string(arena, record->field1, strlen(record->field1), key_flags);
+    arena_record->field2 = record->field2;
+    arena_record->field3 = record->field3;
+}
+
+void write_arena_record_csv(FILE *out_file, const ArenaRecord *record, const StringArena *arena, int key_flags)
+{
+    fprintf(out_file, "%d,%s,%d,%f\n",
+            record->id,
+            get_field_string(arena, record->field1, key_flags),
+            record->field2,
+            record->field3);
+}
+
+/**
+ * Compares arena records by their string field (as `strcmp` does).
+ */
+static int compare_arena_records_by_string(const void *record_a, const void *record_b)
+{
+    const StringRef *a = &((const ArenaRecord *)record_a)->field1;
+    const StringRef *b = &((const ArenaRecord *)record_b)->field1;
+    int result;
+
+    if (a->offset == b->offset)
+        return 0;
+
+    result = memcmp(g_arena_strings + a->offset, g_arena_strings + b->offset, a->length < b->length ? a->length : b->length);
+
+    if (result)
+        return result;
+
+    return (a->length > b->length) - (a->length < b->length);
+}
+
+/**
+ * Compares arena records by their integer field.
+ */
+static int compare_arena_records_by_integer(const void *record_a, const void *record_b)
+{
+    return int_comparator(&((const ArenaRecord *)record_a)->field2, &((const ArenaRecord *)record_b)->field2);
+}
+
+/**
+ * Compares arena records by their floating point field.
+ */
+static int compare_arena_records_by_float(const void *record_a, const void *record_b)
+{
+    return float_comparator(&((const ArenaRecord *)record_a)->field3, &((const ArenaRecord *)record_b)->field3);
+}
+
+compare_fn get_arena_records_comparator(const StringArena *arena, FieldId field_id)
+{
+    StringRef first;
+
+    ASSERT_NULL_PARAMETER(arena, get_arena_records_comparator);
+
+    first.offset = 0;
+    first.length = 0;
+
+    switch (field_id)
+    {
+    case FIELD_STRING:
+        g_arena_strings = get_arena_string(arena, first);
+        return compare_arena_records_by_string;
+    case FIELD_INTEGER:
+        return compare_arena_records_by_integer;
+    case FIELD_FLOAT:
+        return compare_arena_records_by_float;
+    }
+
+    PRINT_ERROR("Invalid field ID", get_arena_records_comparator);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdio.h>
+#include "records-sorter.h"
+#include "string-arena.h"
+
+/**
+ * Represents a record whose string field is stored in a `StringArena`, so that it has no length limit and the
+ * record is less than half the size of a `Record`.
+ */
+typedef struct ArenaRecord
+{
+    int id;           /** The identifier of the record. */
+    StringRef field1; /** The string field, in the arena. */
+    int field2;       /** The integer field. */
+    float field3;     /** The floating point field. */
+} ArenaRecord;
+
+/**
+ * @brief Specifies how the sort key of a string field is derived from the string (the flags can be combined, except
+ * for the collation with the natural order).
+ */
+typedef enum StringKeyFlags
+{
+    STRING_KEY_NONE = 0,      // The string is its own key (i.e., strings are compared byte by byte).
+    STRING_KEY_COLLATE = 1,   // The key orders strings by the collation of the current locale, as `strcoll` does.
+    STRING_KEY_FOLD_CASE = 2, // ASCII letters are folded to lower case (i.e., strings are compared ignoring case).
+    STRING_KEY_NATURAL = 4    // Runs of digits are compared by their value (e.g., `item2` precedes `item10`).
+} StringKeyFlags;
+
+/**
+ * @brief Parses a CSV line (`id,string_field,int_field,float_field`) into the specified record, adding its string
+ * field (of any length) to the arena.
+ *
+ * @remark With key flags, the string field is stored after a binary sort key computed once, the record referencing
+ * both, so that comparing the referenced bytes orders the records by their keys without normalizing the strings at
+ * each comparison. The key folds case and encodes digit runs as length-prefixed numbers as requested, and is then
+ * transformed by `strxfrm` for the collation of the current locale (`LC_COLLATE`) if requested.
+ *
+ * @param line      The beginning of the line.
+ * @param record    The record receiving the parsed fields.
+ * @param arena     The arena receiving the string field.
+ * @param key_flags The `StringKeyFlags` of the sort key of the string field (STRING_KEY_NONE stores no key).
+ * @return The beginning of the next line (or the end of the buffer).
+ */
+const char *parse_arena_record_csv(const char *line, ArenaRecord *record, StringArena *arena, int key_flags);
+
+/**
+ * @brief Converts a record into an arena record, adding its string field to the arena.
+ *
+ * @param record       The record to be converted.
+ * @param arena_record The converted record.
+ * @param arena        The arena receiving the string field.
+ * @param key_flags    The `StringKeyFlags` of the sort key of the string field (see `parse_arena_record_csv`).
+ */
+void to_arena_record(const Record *record, ArenaRecord *arena_record, StringArena *arena, int key_flags);
+
+/**
+ * @brief Writes the specified record as a CSV line (`id,string_field,int_field,float_field`).
+ *
+ * @param out_file  The output file.
+ * @param record    The record to be written.
+ * @param arena     The arena of the string field.
+ * @param key_flags The `StringKeyFlags` the record was stored with (its sort key, if any, is not written).
+ */
+void write_arena_record_csv(FILE *out_file, const ArenaRecord *record, const StringArena *arena, int key_flags);
+
+/**
+ * @brief Retrieves the comparison function of arena records by the specified field.
+ *
+ * @remark The string comparator reads the strings of the specified arena, which shall not be modified while records
+ * are compared. Records referencing the same string (always the case for equal strings of an interning arena) are
+ * equal without reading it. String fields stored with a sort key are ordered by their keys, then (for equal keys)
+ * by their bytes. Only one arena can be compared at a time.
+ *
+ * @param arena    The arena of the string fields.
+ * @param field_id The field by which records are compared.
+ * @return The comparison function of two `ArenaRecord` pointers.
+ */
+compare_fn get_arena_records_comparator(const StringArena *arena, FieldId field_id);
@@ -0,0 +1,469 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "records-index.h"
+#include "diagnostics.h"
+#include "records-io.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+/**
+ * The maximum length of the path of an index file.
+ */
+#define INDEX_MAX_PATH 4096
+
+/**
+ * The size of the blocks in which a query reads the range of the sorted file (grown if a line does not fit).
+ */
+#define QUERY_BLOCK_SIZE (1 << 16)
+
+/**
+ * The header of a sparse index file, followed by the keys and the ranks (in Eytzinger order) and by the offsets
+ * (in sorted order).
+ */
+typedef struct IndexFileHeader
+{
+    char magic[4];        /** The magic number (INDEX_FILE_MAGIC). */
+    uint32_t version;     /** The version of the format (INDEX_FILE_VERSION). */
+    uint32_t field_id;    /** The field by which the indexed file is sorted. */
+    uint32_t key_size;    /** The size of each key, in bytes. */
+    uint64_t every;       /** The number of records between two indexed records. */
+    uint64_t num_entries; /** The number of indexed records. */
+    uint64_t num_records; /** The number of records of the indexed file. */
+    uint64_t file_size;   /** The size of the indexed file, in bytes. */
+} IndexFileHeader;
+
+struct SparseIndex
+{
+    FieldId field_id;   /** The field by which the indexed file is sorted. */
+    size_t key_size;    /** The size of each key, in bytes. */
+    compare_fn compare; /** The comparison function of the keys. */
+    size_t every;       /** The number of records between two indexed records. */
+    char *keys;         /** The keys, in sorted order while building, in Eytzinger order once loaded. */
+    uint64_t *ranks;    /** The sorted rank of each key in Eytzinger order (only once loaded). */
+    uint64_t *offsets;  /** The byte offsets of the indexed records, in sorted order. */
+    size_t num_entries; /** The number of indexed records. */
+    size_t capacity;    /** The capacity of the arrays. */
+    uint64_t file_size; /** The size of the indexed file (only once loaded). */
+};
+
+/**
+ * Retrieves the size of the keys of the specified field.
+ */
+static size_t get_key_size(FieldId field_id)
+{
+    switch (field_id)
+    {
+    case FIELD_STRING:
+        return STRING_FIELD_LEN;
+    case FIELD_INTEGER:
+        return sizeof(int);
+    case FIELD_FLOAT:
+        return sizeof(float);
+    }
+
+    PRINT_ERROR("Invalid field ID", get_key_size);
+}
+
+/**
+ * Retrieves the comparison function of the keys of the specified field.
+ */
+static compare_fn get_key_comparator(FieldId field_id)
+{
+    switch (field_id)
+    {
+    case FIELD_STRING:
+        return string_comparator;
+    case FIELD_INTEGER:
+        return int_comparator;
+    case FIELD_FLOAT:
+        return float_comparator;
+    }
+
+    PRINT_ERROR("Invalid field ID", get_key_comparator);
+}
+
+/**
+ * Copies the key of a record.
+ */
+static void copy_key(void *key, const Record *record, FieldId field_id)
+{
+    switch (field_id)
+    {
+    case FIELD_STRING:
+        memcpy(key, record->field1, STRING_FIELD_LEN);
+        return;
+    case FIELD_INTEGER:
+        memcpy(key, &record->field2, sizeof(int));
+        return;
+    case FIELD_FLOAT:
+        memcpy(key, &record->field3, sizeof(float));
+        return;
+    }
+
+    PRINT_ERROR("Invalid field ID", copy_key);
+}
+
+/**
+ * Parses a key of the specified field from its textual representation.
+ */
+static void parse_key(void *key, const char *str, FieldId field_id)
+{
+    char *end;
+    int integer;
+    float real;
+
+    switch (field_id)
+    {
+    case FIELD_STRING:
+        memset(key, 0, STRING_FIELD_LEN);
+        strncpy((char *)key, str, STRING_FIELD_LEN - 1);
+        return;
+    case FIELD_INTEGER:
+        integer = (int)strtol(str, &end, 10);
+        ASSERT(end != str && !*end, "The key is not an integer", parse_key);
+        memcpy(key, &integer, sizeof(int));
+        return;
+    case FIELD_FLOAT:
+        real = strtof(str, &end);
+        ASSERT(end != str && !*end, "The key is not a float", parse_key);
+        memcpy(key, &real, sizeof(float));
+        return;
+    }
+
+    PRINT_ERROR("Invalid field ID", parse_key);
+}
+
+SparseIndex *create_sparse_index(FieldId field_id, size_t every)
+{
+    SparseIndex *index;
+
+    ASSERT(every > 0, "The number of records between two indexed records must be greater than zero", create_sparse_index);
+
+    index = calloc(1, sizeof(SparseIndex));
+    ASSERT(index, "Unable to allocate memory for the index", create_sparse_index);
+
+    index->field_id = field_id;
+    index->key_size = get_key_size(field_id);
+    index->compare = get_key_comparator(field_id);
+    index->every = every;
+
+    return index;
+}
+
+void destroy_sparse_index(SparseIndex *index)
+{
+    ASSERT_NULL_PARAMETER(index, destroy_sparse_index);
+
+    free(index->keys);
+    free(index->ranks);
+    free(index->offsets);
+    free(index);
+}
+
+size_t get_sparse_index_every(const SparseIndex *index)
+{
+    ASSERT_NULL_PARAMETER(index, get_sparse_index_every);
+    return index->every;
+}
+
+void add_sparse_index_entry(SparseIndex *index, const Record *record, uint64_t offset)
+{
+    ASSERT_NULL_PARAMETER(index, add_sparse_index_entry);
+    ASSERT_NULL_PARAMETER(record, add_sparse_index_entry);
+
+    if (index->num_entries == index->capacity)
+    {
+        index->capacity = index->capacity ? index->capacity * 2 : 1024;
+        index->keys = realloc(index->keys, index->key_size * index->capacity);
+        index->offsets = realloc(index->offsets, sizeof(uint64_t) * index->capacity);
+        ASSERT(index->keys && index->offsets, "Unable to allocate memory for the index", add_sparse_index_entry);
+    }
+
+    copy_key(index->keys + index->num_entries * index->key_size, record, index->field_id);
+    index->offsets[index->num_entries++] = offset;
+}
+
+/**
+ * Lays out the sorted keys in Eytzinger order (node k has children 2k and 2k + 1, the root being node 1, stored at
+ * index 0), by an in-order visit of the implicit tree. Returns the next sorted rank.
+ */
+static size_t build_eytzinger(const SparseIndex *index, char *keys, uint64_t *ranks, size_t rank, size_t node)
+{
+    if (node > index->num_entries)
+        return rank;
+
+    rank = build_eytzinger(index, keys, ranks, rank, 2 * node);
+
+    memcpy(keys + (node - 1) * index->key_size, index->keys + rank * index->key_size, index->key_size);
+    ranks[node - 1] = rank++;
+
+    return build_eytzinger(index, keys, ranks, rank, 2 * node + 1);
+}
+
+void write_sparse_index(SparseIndex *index, const char *path, uint64_t num_records, uint64_t file_size)
+{
+    IndexFileHeader header;
+    FILE *file;
+    char *keys;
+    uint64_t *ranks;
+
+    ASSERT_NULL_PARAMETER(index, write_sparse_index);
+    ASSERT_NULL_PARAMETER(path, write_sparse_index);
+
+    keys = malloc(index->key_size * index->num_entries + 1);
+    ranks = malloc(sizeof(uint64_t) * index->num_entries + 1);
+    ASSERT(keys && ranks, "Unable to allocate memory for the index", write_sparse_index);
+
+    build_eytzinger(index, keys, ranks, 0, 1);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_FILE_MAGIC, sizeof(header.magic));
+    header.version = INDEX_FILE_VERSION;
+    header.field_id = (uint32_t)index->field_id;
+    header.key_size = (uint32_t)index->key_size;
+    header.every = index->every;
+    header.num_entries = index->num_entries;
+    header.num_records = num_records;
+    header.file_size = file_size;
+
+    file = fopen(path, "wb");
+    ASSERT(file, "Unable to open the index file", write_sparse_index);
+
+    ASSERT(fwrite(&header, sizeof(header), 1, file) == 1 &&
+               fwrite(keys, index->key_size, index->num_entries, file) == index->num_entries &&
+               fwrite(ranks, sizeof(uint64_t), index->num_entries, file) == index->num_entries &&
+               fwrite(index->offsets, sizeof(uint64_t), index->num_entries, file) == index->num_entries,
+           "Unable to write the index file", write_sparse_index);
+
+    ASSERT(!fclose(file), "Unable to write the index file", write_sparse_index);
+
+    free(keys);
+    free(ranks);
+}
+
+/**
+ * Loads the sparse index of a sorted file.
+ */
+static SparseIndex *load_sparse_index(const char *path)
+{
+    IndexFileHeader header;
+    SparseIndex *index;
+    FILE *file;
+
+    file = fopen(path, "rb");
+    ASSERT(file, "Unable to open the index file", load_sparse_index);
+
+    ASSERT(fread(&header, sizeof(header), 1, file) == 1 && !memcmp(header.magic, INDEX_FILE_MAGIC, sizeof(header.magic)), "Not an index file", load_sparse_index);
+    ASSERT(header.version == INDEX_FILE_VERSION, "Unsupported index file version", load_sparse_index);
+    ASSERT(header.field_id >= FIELD_STRING && header.field_id <= FIELD_FLOAT, "Invalid field in the index file", load_sparse_index);
+
+    index = create_sparse_index((FieldId)header.field_id, (size_t)header.every);
+    ASSERT(header.key_size == index->key_size, "The index file has been produced with a different record layout", load_sparse_index);
+
+    index->num_entries = index->capacity = (size_t)header.num_entries;
+    index->file_size = header.file_size;
+    index->keys = malloc(index->key_size * index->num_entries + 1);
+    index->ranks = malloc(sizeof(uint64_t) * index->num_entries + 1);
+    index->offsets = malloc(sizeof(uint64_t) * index->num_entries + 1);
+    ASSERT(index->keys && index->ranks && index->offsets, "Unable to allocate memory for the index", load_sparse_index);
+
+    ASSERT(fread(index->keys, index->key_size, index->num_entries, file) == index->num_entries &&
+               fread(index->ranks, sizeof(uint64_t), index->num_entries, file) == index->num_entries &&
+               fread(index->offsets, sizeof(uint64_t), index->num_entries, file) == index->num_entries,
+           "Unable to read the index file", load_sparse_index);
+
+    fclose(file);
+    return index;
+}
+
+/**
+ * Searches the Eytzinger keys, returning the sorted rank of the first key greater than (if `strict`) or not lower
+ * than the specified one (`num_entries` if none).
+ */
+static size_t search_eytzinger(const SparseIndex *index, const void *key, int strict)
+{
+    size_t node, found;
+    int result;
+
+    found = 0;
+
+    // Descend the implicit tree, remembering the last node whose key satisfies the bound (the answer is the lowest).
+    for (node = 1; node <= index->num_entries;)
+    {
+        result = index->compare(index->keys + (node - 1) * index->key_size, key);
+
+        if (result > 0 || (!strict && result == 0))
+        {
+            found = node;
+            node = 2 * node;
+        }
+        else
+            node = 2 * node + 1;
+    }
+
+    return found ? (size_t)index->ranks[found - 1] : index->num_entries;
+}
+
+/**
+ * Reads the specified byte range of a file (with `pread` where available).
+ */
+static void read_range(FILE *file, char *buffer, uint64_t start, size_t len)
+{
+#if !defined(_WIN32)
+    size_t done;
+    ssize_t result;
+
+    for (done = 0; done < len; done += (size_t)result)
+    {
+        result = pread(fileno(file), buffer + done, len - done, (off_t)(start + done));
+        ASSERT(result > 0, "Unable to read the sorted file", read_range);
+    }
+#else
+    ASSERT(!_fseeki64(file, (long long)start, SEEK_SET), "Unable to seek the sorted file", read_range);
+    ASSERT(fread(buffer, 1, len, file) == len, "Unable to read the sorted file", read_range);
+#endif
+}
+
+/**
+ * Retrieves the size of the specified file, in bytes.
+ */
+static uint64_t get_file_size(FILE *file)
+{
+#if !defined(_WIN32)
+    struct stat info;
+
+    ASSERT(!fstat(fileno(file), &info), "Unable to retrieve the size of the sorted file", get_file_size);
+#else
+    struct _stat64 info;
+
+    ASSERT(!_fstat64(_fileno(file), &info), "Unable to retrieve the size of the sorted file", get_file_size);
+#endif
+
+    return (uint64_t)info.st_size;
+}
+
+/**
+ * Prints the records of the lines in range `[lines, end - 1]` whose key is in range `[low, high]`, returning their
+ * number.
+ */
+static size_t filter_lines(const SparseIndex *index, const char *lines, const char *end, const void *low, const void *high, FILE *out_file)
+{
+    char key[STRING_FIELD_LEN];
+    const char *line;
+    size_t count;
+    Record record;
+
+    for (line = lines, count = 0; line < end;)
+    {
+        line = parse_record_csv(line, &record);
+        copy_key(key, &record, index->field_id);
+
+        if (index->compare(key, low) >= 0 && index->compare(key, high) <= 0)
+        {
+            write_record_csv(out_file, &record);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Prints the records of the byte range `[start_offset, end_offset - 1]` of the sorted file whose key is in range
+ * `[low, high]`, reading it in blocks (the partial last line of a block is carried over to the next one). Returns
+ * the number of printed records.
+ */
+static size_t filter_range(const SparseIndex *index, FILE *file, uint64_t start_offset, uint64_t end_offset, const void *low, const void *high, FILE *out_file)
+{
+    char *buffer, *end;
+    uint64_t offset;
+    size_t capacity, pending, filled, len, count;
+
+    capacity = QUERY_BLOCK_SIZE;
+    buffer = malloc(capacity + 1);
+    ASSERT(buffer, "Unable to allocate memory for the read blocks", filter_range);
+
+    for (offset = start_offset, pending = 0, count = 0; offset < end_offset;)
+    {
+        len = end_offset - offset < capacity - pending ? (size_t)(end_offset - offset) : capacity - pending;
+        read_range(file, buffer + pending, offset, len);
+        offset += len;
+        filled = pending + len;
+        buffer[filled] = '\0';
+
+        // Only the complete lines are filtered, unless the range is over.
+        end = buffer + filled;
+
+        if (offset < end_offset)
+        {
+            while (end > buffer && end[-1] != '\n')
+                end--;
+
+            if (end == buffer)
+            {
+                capacity *= 2;
+                buffer = realloc(buffer, capacity + 1);
+                ASSERT(buffer, "Unable to allocate memory for the read blocks", filter_range);
+                pending = filled;
+                continue;
+            }
+        }
+
+        count += filter_lines(index, buffer, end, low, high, out_file);
+
+        pending = (size_t)(buffer + filled - end);
+        memmove(buffer, end, pending);
+    }
+
+    free(buffer);
+    return count;
+}
+
+size_t query_sorted_file(const char *sorted_path, const char *low_key, const char *high_key, FILE *out_file)
+{
+    char index_path[INDEX_MAX_PATH], low[STRING_FIELD_LEN], high[STRING_FIELD_LEN];
+    SparseIndex *index;
+    FILE *file;
+    uint64_t start_offset, end_offset;
+    size_t first, last, count;
+
+    ASSERT_NULL_PARAMETER(sorted_path, query_sorted_file);
+    ASSERT_NULL_PARAMETER(low_key, query_sorted_file);
+    ASSERT_NULL_PARAMETER(high_key, query_sorted_file);
+    ASSERT_NULL_PARAMETER(out_file, query_sorted_file);
+
+    ASSERT(snprintf(index_path, sizeof(index_path), "%s" INDEX_FILE_EXTENSION, sorted_path) < (int)sizeof(index_path), "The path is too long", query_sorted_file);
+    index = load_sparse_index(index_path);
+
+    parse_key(low, low_key, index->field_id);
+    parse_key(high, high_key, index->field_id);
+
+    file = fopen(sorted_path, "rb");
+    ASSERT(file, "Unable to open the sorted file", query_sorted_file);
+
+    // The offsets of an index are meaningless once the sorted file has been rewritten.
+    ASSERT(get_file_size(file) == index->file_size, "The index is stale (the sorted file has changed since it has been indexed)", query_sorted_file);
+
+    // The matching records follow the last indexed record lower than the low key, and precede the first indexed
+    // record greater than the high key.
+    first = search_eytzinger(index, low, 0);
+    last = search_eytzinger(index, high, 1);
+
+    start_offset = first > 0 ? index->offsets[first - 1] : 0;
+    end_offset = last < index->num_entries ? index->offsets[last] : index->file_size;
+    count = 0;
+
+    if (start_offset < end_offset && index->compare(low, high) <= 0)
+        count = filter_range(index, file, start_offset, end_offset, low, high, out_file);
+
+    fclose(file);
+    destroy_sparse_index(index);
+    return count;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include "records-sorter.h"
+
+/**
+ * The magic number at the beginning of a sparse index file.
+ */
+#define INDEX_FILE_MAGIC "SIDX"
+
+/**
+ * The version of the sparse index file format.
+ */
+#define INDEX_FILE_VERSION 1
+
+/**
+ * The extension appended to the path of a sorted file to name its sparse index.
+ */
+#define INDEX_FILE_EXTENSION ".idx"
+
+/**
+ * @brief A sparse index of a sorted CSV file: the key and the byte offset of one record every N.
+ *
+ * @remark Once written, the keys are laid out in Eytzinger (breadth-first) order, so that the binary search walks
+ * the array from the beginning, touching the same few cache lines for the first levels of every lookup.
+ */
+typedef struct SparseIndex SparseIndex;
+
+/**
+ * @brief Creates an empty sparse index, to be filled while the sorted file is written.
+ *
+ * @param field_id The field by which the indexed file is sorted.
+ * @param every    The number of records between two indexed records.
+ * @return The created index.
+ */
+SparseIndex *create_sparse_index(FieldId field_id, size_t every);
+
+/**
+ * @brief Destroys the specified sparse index.
+ *
+ * @param index The index to be destroyed.
+ */
+void destroy_sparse_index(SparseIndex *index);
+
+/**
+ * @brief Retrieves the number of records between two indexed records.
+ *
+ * @param index The index.
+ * @return The number of records between two indexed records.
+ */
+size_t get_sparse_index_every(const SparseIndex *index);
+
+/**
+ * @brief Adds the key of a record of the sorted file, which shall not precede the previously added ones.
+ *
+ * @param index  The index.
+ * @param record The indexed record.
+ * @param offset The byte offset of the record in the sorted file.
+ */
+void add_sparse_index_entry(SparseIndex *index, const Record *record, uint64_t offset);
+
+/**
+ * @brief Writes the specified sparse index to a file.
+ *
+ * @param index       The index.
+ * @param path        The path of the index file.
+ * @param num_records The number of records of the indexed file.
+ * @param file_size   The size of the indexed file, in bytes.
+ */
+void write_sparse_index(SparseIndex *index, const char *path, uint64_t num_records, uint64_t file_size);
+
+/**
+ * @brief Prints the records of a sorted CSV file whose key is in the specified range, using its sparse index
+ * (written beside it by `sort_records_with_options`) to read only the blocks which may contain them.
+ *
+ * @remark The execution is aborted if the size of the sorted file differs from the one recorded in the index
+ * (i.e., the index is stale).
+ *
+ * @param sorted_path The path of the sorted file (its index is at `<sorted_path>.idx`).
+ * @param low_key     The lowest key of the range (e.g., `42`), parsed according to the indexed field.
+ * @param high_key    The highest key of the range (the same as `low_key` for point lookups).
+ * @param out_file    The file receiving the matching records, as CSV lines.
+ * @return The number of matching records.
+ */
+size_t query_sorted_file(const char *sorted_path, const char *low_key, const char *high_key, FILE *out_file);
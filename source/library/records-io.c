@@ -0,0 +1,114 @@
+#include "records-io.h"
+#include "diagnostics.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The header of a binary records file.
+ */
+typedef struct RecordsFileHeader
+{
+    char magic[4];             /** The magic number (RECORDS_FILE_MAGIC). */
+    uint32_t version;          /** The version of the format (RECORDS_FILE_VERSION). */
+    uint32_t record_size;      /** The size of each record, in bytes. */
+    uint32_t string_field_len; /** The max length of the string field (STRING_FIELD_LEN). */
+    uint64_t num_records;      /** The number of records in the file. */
+} RecordsFileHeader;
+
+int read_records_file_header(FILE *in_file, size_t *num_records)
+{
+    RecordsFileHeader header;
+
+    ASSERT_NULL_PARAMETER(in_file, read_records_file_header);
+    ASSERT_NULL_PARAMETER(num_records, read_records_file_header);
+
+    if (fread(header.magic, 1, sizeof(header.magic), in_file) != sizeof(header.magic) ||
+        memcmp(header.magic, RECORDS_FILE_MAGIC, sizeof(header.magic)))
+    {
+        rewind(in_file);
+        return 0;
+    }
+
+    ASSERT(fread(&header.version, sizeof(header) - sizeof(header.magic), 1, in_file) == 1, "Unable to read the records file header", read_records_file_header);
+    ASSERT(header.version == RECORDS_FILE_VERSION, "Unsupported records file version", read_records_file_header);
+    ASSERT(header.record_size == sizeof(Record) && header.string_field_len == STRING_FIELD_LEN, "The records file has been produced with a different record layout", read_records_file_header);
+
+    *num_records = (size_t)header.num_records;
+    return 1;
+}
+
+void write_records_file_header(FILE *out_file, size_t num_records)
+{
+    RecordsFileHeader header;
+
+    ASSERT_NULL_PARAMETER(out_file, write_records_file_header);
+
+    memcpy(header.magic, RECORDS_FILE_MAGIC, sizeof(header.magic));
+    header.version = RECORDS_FILE_VERSION;
+    header.record_size = sizeof(Record);
+    header.string_field_len = STRING_FIELD_LEN;
+    header.num_records = num_records;
+
+    ASSERT(fwrite(&header, sizeof(header), 1, out_file) == 1, "Unable to write the records file header", write_records_file_header);
+}
+
+void read_binary_records(FILE *in_file, Record *records, size_t num_records)
+{
+    ASSERT_NULL_PARAMETER(in_file, read_binary_records);
+    ASSERT(fread(records, sizeof(Record), num_records, in_file) == num_records, "Unable to read the records", read_binary_records);
+}
+
+void write_binary_records(FILE *out_file, const Record *records, size_t num_records)
+{
+    ASSERT_NULL_PARAMETER(out_file, write_binary_records);
+    ASSERT(fwrite(records, sizeof(Record), num_records, out_file) == num_records, "Unable to write the records", write_binary_records);
+}
+
+size_t format_record_csv(char *buffer, const Record *record)
+{
+    return (size_t)sprintf(buffer, "%d,%s,%d,%f\n",
+                           record->id,
+                           record->field1,
+                           record->field2,
+                           record->field3);
+}
+
+void write_record_csv(FILE *out_file, const Record *record)
+{
+    fprintf(out_file, "%d,%s,%d,%f\n",
+            record->id,
+            record->field1,
+            record->field2,
+            record->field3);
+}
+
+const char *parse_record_csv(const char *line, Record *record)
+{
+    const char *field;
+    char *end;
+    size_t len;
+
+    record->id = (int)strtol(line, &end, 10);
+    ASSERT(*end == ',', "Malformed CSV record (id field)", parse_record_csv);
+
+    field = end + 1;
+
+    for (len = 0; field[len] && field[len] != ',' && field[len] != '\n'; len++)
+        ;
+
+    ASSERT(field[len] == ',', "Malformed CSV record (string field)", parse_record_csv);
+
+    memcpy(record->field1, field, len < STRING_FIELD_LEN ? len : STRING_FIELD_LEN - 1);
+    record->field1[len < STRING_FIELD_LEN ? len : STRING_FIELD_LEN - 1] = '\0';
+
+    record->field2 = (int)strtol(field + len + 1, &end, 10);
+    ASSERT(*end == ',', "Malformed CSV record (integer field)", parse_record_csv);
+
+    record->field3 = strtof(end + 1, &end);
+
+    while (*end && *end != '\n')
+        end++;
+
+    return *end ? end + 1 : end;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdio.h>
+#include "records.h"
+
+/**
+ * The magic number at the beginning of a binary records file.
+ */
+#define RECORDS_FILE_MAGIC "SREC"
+
+/**
+ * The version of the binary records file format.
+ */
+#define RECORDS_FILE_VERSION 1
+
+/**
+ * @brief Reads the header of a binary records file.
+ *
+ * @remark A binary records file is made of a header followed by the raw `Record` array, in the native layout and
+ * byte order of the machine which produced it.
+ * If the file is not a binary records file (i.e., it is a CSV file), it is rewound.
+ *
+ * @param in_file     The input file.
+ * @param num_records Pointer to the variable receiving the number of records in the file.
+ * @return A non-zero value if the file is a binary records file, zero otherwise.
+ */
+int read_records_file_header(FILE *in_file, size_t *num_records);
+
+/**
+ * @brief Writes the header of a binary records file.
+ *
+ * @param out_file    The output file.
+ * @param num_records The number of records that will follow the header.
+ */
+void write_records_file_header(FILE *out_file, size_t num_records);
+
+/**
+ * @brief Reads the specified number of records from a binary records file, past its header.
+ *
+ * @param in_file     The input file.
+ * @param records     The array receiving the records.
+ * @param num_records The number of records to be read.
+ */
+void read_binary_records(FILE *in_file, Record *records, size_t num_records);
+
+/**
+ * @brief Writes the specified records to a binary records file, past its header.
+ *
+ * @param out_file    The output file.
+ * @param records     The records to be written.
+ * @param num_records The number of records to be written.
+ */
+void write_binary_records(FILE *out_file, const Record *records, size_t num_records);
+
+/**
+ * The maximum length of a CSV line written by `format_record_csv` (newline and null terminator included).
+ */
+#define MAX_RECORD_CSV_LEN (STRING_FIELD_LEN + 96)
+
+/**
+ * @brief Formats the specified record as a CSV line (`id,string_field,int_field,float_field`), newline included.
+ *
+ * @param buffer The buffer receiving the null-terminated line, of at least `MAX_RECORD_CSV_LEN` characters.
+ * @param record The record to be formatted.
+ * @return The length of the line.
+ */
+size_t format_record_csv(char *buffer, const Record *record);
+
+/**
+ * @brief Writes the specified record as a CSV line (`id,string_field,int_field,float_field`).
+ *
+ * @param out_file The output file.
+ * @param record   The record to be written.
+ */
+void write_record_csv(FILE *out_file, const Record *record);
+
+/**
+ * @brief Parses a CSV line (`id,string_field,int_field,float_field`) into the specified record.
+ *
+ * @remark The line is not modified, so that several threads can parse lines of the same buffer. The string field
+ * is truncated to `STRING_FIELD_LEN - 1` characters.
+ *
+ * @param line   The beginning of the line, inside a null-terminated buffer.
+ * @param record The record receiving the parsed fields.
+ * @return The beginning of the next line (or the end of the buffer).
+ */
+const char *parse_record_csv(const char *line, Record *record);
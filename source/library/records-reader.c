@@ -0,0 +1,139 @@
+#include "records-reader.h"
+#include "compressed-io.h"
+#include "diagnostics.h"
+#include "records-io.h"
+#include <string.h>
+
+/**
+ * The number of records buffered by `next_record`.
+ */
+#define READER_BUFFER_RECORDS 4096
+
+/**
+ * The initial capacity of the line buffer of CSV files.
+ */
+#define READER_LINE_CAPACITY 256
+
+struct RecordsReader
+{
+    FILE *in_file;        /** The input file. */
+    int binary;           /** Whether the file is a binary records file. */
+    size_t remaining;     /** The number of records still to be read from a binary records file. */
+    char *line;           /** The line buffer of CSV files. */
+    size_t line_capacity; /** The capacity of the line buffer. */
+    Record *buffer;       /** The records buffered by `next_record` (NULL until the first call). */
+    size_t buffered;      /** The number of buffered records. */
+    size_t position;      /** The position of the next buffered record. */
+};
+
+RecordsReader *open_records_reader(FILE *in_file)
+{
+    RecordsReader *reader;
+
+    ASSERT_NULL_PARAMETER(in_file, open_records_reader);
+
+    reader = calloc(1, sizeof(RecordsReader));
+    ASSERT(reader, "Unable to allocate memory for the reader", open_records_reader);
+
+    reader->in_file = in_file;
+    reader->binary = read_records_file_header(in_file, &reader->remaining);
+
+    if (!reader->binary)
+    {
+        reader->line_capacity = READER_LINE_CAPACITY;
+        reader->line = malloc(reader->line_capacity);
+        ASSERT(reader->line, "Unable to allocate space for 'line'", open_records_reader);
+    }
+
+    return reader;
+}
+
+size_t get_records_reader_memory(void)
+{
+    return INPUT_FILE_BUFFER_SIZE + sizeof(Record) * READER_BUFFER_RECORDS;
+}
+
+void close_records_reader(RecordsReader *reader)
+{
+    ASSERT_NULL_PARAMETER(reader, close_records_reader);
+
+    free(reader->line);
+    free(reader->buffer);
+    free(reader);
+}
+
+/**
+ * Reads the next line of a CSV file into the line buffer, growing it until the whole line fits.
+ */
+static size_t read_line(RecordsReader *reader)
+{
+    size_t len;
+
+    len = 0;
+
+    while (fgets(reader->line + len, (int)(reader->line_capacity - len), reader->in_file))
+    {
+        len += strlen(reader->line + len);
+
+        if (len > 0 && reader->line[len - 1] == '\n')
+            break;
+
+        if (len + 1 == reader->line_capacity)
+        {
+            reader->line_capacity *= 2;
+            reader->line = realloc(reader->line, reader->line_capacity);
+            ASSERT(reader->line, "Unable to allocate space for 'line'", read_line);
+        }
+    }
+
+    ASSERT(!ferror(reader->in_file), "Unable to read line from input file", read_line);
+    return len;
+}
+
+size_t read_records(RecordsReader *reader, Record *records, size_t max_records)
+{
+    size_t count;
+
+    ASSERT_NULL_PARAMETER(reader, read_records);
+
+    if (reader->binary)
+    {
+        count = reader->remaining < max_records ? reader->remaining : max_records;
+        read_binary_records(reader->in_file, records, count);
+        reader->remaining -= count;
+        return count;
+    }
+
+    for (count = 0; count < max_records && read_line(reader); count++)
+        parse_record_csv(reader->line, &records[count]);
+
+    return count;
+}
+
+const void *next_record(void *source)
+{
+    RecordsReader *reader = (RecordsReader *)source;
+
+    if (reader->position == reader->buffered)
+    {
+        if (!reader->buffer)
+        {
+            reader->buffer = malloc(sizeof(Record) * READER_BUFFER_RECORDS);
+            ASSERT(reader->buffer, "Unable to allocate memory for the reader", next_record);
+        }
+
+        reader->buffered = read_records(reader, reader->buffer, READER_BUFFER_RECORDS);
+        reader->position = 0;
+
+        if (!reader->buffered)
+            return NULL;
+    }
+
+    return &reader->buffer[reader->position++];
+}
+
+int is_binary_records_reader(const RecordsReader *reader)
+{
+    ASSERT_NULL_PARAMETER(reader, is_binary_records_reader);
+    return reader->binary;
+}
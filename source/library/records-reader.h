@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdio.h>
+#include "records.h"
+
+/**
+ * @brief A streaming reader of records from either a CSV or a binary records file.
+ */
+typedef struct RecordsReader RecordsReader;
+
+/**
+ * @brief Opens a reader of records over the specified file, detecting its format.
+ *
+ * @remark The reader does not change the buffering of the file, which must be set (to `INPUT_FILE_BUFFER_SIZE`
+ * bytes) right after opening it, before any I/O: `open_input_file` already does so.
+ *
+ * @param in_file The input file, positioned at its beginning, which is not closed by the reader.
+ * @return The opened reader.
+ */
+RecordsReader *open_records_reader(FILE *in_file);
+
+/**
+ * @brief Retrieves the memory used by the buffers of a reader (the buffer of its file included).
+ *
+ * @return The number of bytes of the buffers of a reader.
+ */
+size_t get_records_reader_memory(void);
+
+/**
+ * @brief Closes the specified reader.
+ *
+ * @param reader The reader to be closed.
+ */
+void close_records_reader(RecordsReader *reader);
+
+/**
+ * @brief Reads up to the specified number of records.
+ *
+ * @param reader      The reader.
+ * @param records     The array receiving the records.
+ * @param max_records The maximum number of records to be read.
+ * @return The number of records read (zero at the end of the file).
+ */
+size_t read_records(RecordsReader *reader, Record *records, size_t max_records);
+
+/**
+ * @brief Reads the next record, from an internal buffer.
+ *
+ * @remark The signature matches `MergeSourceFn`, so that readers can be merged directly.
+ *
+ * @param reader The reader.
+ * @return A pointer to the record (valid until the next call), or NULL at the end of the file.
+ */
+const void *next_record(void *reader);
+
+/**
+ * @brief Tests whether the reader reads a binary records file.
+ *
+ * @param reader The reader.
+ * @return A non-zero value if the file is a binary records file, zero if it is a CSV file.
+ */
+int is_binary_records_reader(const RecordsReader *reader);
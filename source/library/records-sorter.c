@@ -1,196 +1,1932 @@
 #include "records-sorter.h"
+#include "compressed-io.h"
 #include "diagnostics.h"
+#include "distributions.h"
+#include "large-alloc.h"
+#include "memory-usage.h"
+#include "merger.h"
+#include "parallel.h"
+#include "records.h"
+#include "records-arena.h"
+#include "records-io.h"
+#include "records-reader.h"
+#include "records-writer.h"
 #include "sorting.h"
+#include "tuning-config.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-#ifndef STRING_FIELD_LEN
 /**
- * The max length of the string field.
- * @note: Strings are stored statically to prevent allocations and memory fragmentation.
+ * The field id used for comparision.
+ */
+static int g_field_id;
+
+/**
+ * Below this number of bytes per chunk, the CSV input is split into fewer chunks (i.e., parsed by fewer threads).
+ */
+#define MIN_CSV_CHUNK_SIZE (1 << 20)
+
+/**
+ * The CSV input, split into chunks aligned to line boundaries, each one parsed by its own thread.
+ */
+typedef struct CsvChunks
+{
+    const char *data;                  /** The whole input, null-terminated. */
+    size_t size;                       /** The size of the input, in bytes. */
+    size_t bounds[MAX_THREADS + 1];    /** The byte offsets of the chunks (chunk i is [bounds[i], bounds[i + 1])). */
+    size_t first_record[MAX_THREADS];  /** The number of lines of each chunk, then the index of its first record. */
+    Record *records;                   /** The array receiving the records of every chunk. */
+} CsvChunks;
+
+/**
+ * Reads the whole (remaining) content of the specified file into a newly allocated null-terminated buffer.
+ */
+static char *read_whole_file(FILE *in_file, size_t *size)
+{
+    char *data;
+    size_t capacity, read;
+    long start, end;
+
+    capacity = 1 << 16;
+    start = ftell(in_file);
+
+    // Size the buffer at once on seekable files.
+    if (start >= 0 && !fseek(in_file, 0, SEEK_END) && (end = ftell(in_file)) >= start)
+    {
+        capacity = (size_t)(end - start) + 1;
+        ASSERT(!fseek(in_file, start, SEEK_SET), "Unable to seek the input file", read_whole_file);
+    }
+
+    data = malloc(capacity);
+    ASSERT(data, "Unable to allocate space for the input", read_whole_file);
+
+    *size = 0;
+
+    while ((read = fread(data + *size, 1, capacity - *size - 1, in_file)) > 0)
+    {
+        *size += read;
+
+        if (*size + 1 == capacity)
+        {
+            capacity *= 2;
+            data = realloc(data, capacity);
+            ASSERT(data, "Unable to allocate space for the input", read_whole_file);
+        }
+    }
+
+    ASSERT(!ferror(in_file), "Unable to read the input file", read_whole_file);
+
+    data[*size] = '\0';
+    return data;
+}
+
+/**
+ * Counts the lines of a chunk (the last line of the input may lack its newline).
+ */
+static void count_chunk_lines(void *context, size_t chunk)
+{
+    CsvChunks *chunks = (CsvChunks *)context;
+    const char *current, *end;
+    size_t count;
+
+    current = chunks->data + chunks->bounds[chunk];
+    end = chunks->data + chunks->bounds[chunk + 1];
+    count = 0;
+
+    while (current < end && (current = memchr(current, '\n', (size_t)(end - current))))
+    {
+        current++;
+        count++;
+    }
+
+    if (end > chunks->data + chunks->bounds[chunk] && end[-1] != '\n')
+        count++;
+
+    chunks->first_record[chunk] = count;
+}
+
+/**
+ * Parses the lines of a chunk into its own block of the records array.
+ */
+static void parse_chunk_lines(void *context, size_t chunk)
+{
+    CsvChunks *chunks = (CsvChunks *)context;
+    const char *current, *end;
+    Record *record;
+
+    current = chunks->data + chunks->bounds[chunk];
+    end = chunks->data + chunks->bounds[chunk + 1];
+    record = chunks->records + chunks->first_record[chunk];
+
+    while (current < end)
+        current = parse_record_csv(current, record++);
+}
+
+/**
+ * Loads the records of the specified CSV file into a newly allocated array, parsing chunks of the file on
+ * multiple threads.
+ */
+static Record *load_records(FILE *in_file, size_t *num_records)
+{
+    CsvChunks chunks;
+    char *data;
+    size_t num_chunks, i, start, count;
+    const char *newline;
+
+    data = read_whole_file(in_file, &chunks.size);
+    chunks.data = data;
+    count_memory(MEMORY_PHASE_LOAD, chunks.size);
+
+    num_chunks = get_num_threads();
+
+    if (num_chunks > chunks.size / MIN_CSV_CHUNK_SIZE)
+        num_chunks = chunks.size / MIN_CSV_CHUNK_SIZE > 0 ? chunks.size / MIN_CSV_CHUNK_SIZE : 1;
+
+    // Each chunk starts right after the first newline following its evenly spaced offset.
+    chunks.bounds[0] = 0;
+
+    for (i = 1; i < num_chunks; i++)
+    {
+        start = chunks.size / num_chunks * i;
+
+        if (start < chunks.bounds[i - 1])
+            start = chunks.bounds[i - 1];
+
+        newline = memchr(data + start, '\n', chunks.size - start);
+        chunks.bounds[i] = newline ? (size_t)(newline - data) + 1 : chunks.size;
+    }
+
+    chunks.bounds[num_chunks] = chunks.size;
+
+    parallel_for(num_chunks, count_chunk_lines, &chunks);
+
+    // Prefix sum of the line counts, so that each chunk is parsed in place into the final array.
+    *num_records = 0;
+
+    for (i = 0; i < num_chunks; i++)
+    {
+        count = chunks.first_record[i];
+        chunks.first_record[i] = *num_records;
+        *num_records += count;
+    }
+
+    chunks.records = allocate_large(sizeof(Record) * *num_records);
+    ASSERT(chunks.records || !*num_records, "Unable to allocate space for 'records'", load_records);
+    count_memory(MEMORY_PHASE_LOAD, sizeof(Record) * *num_records);
+
+    parallel_for(num_chunks, parse_chunk_lines, &chunks);
+
+    free(data);
+    return chunks.records;
+}
+
+/**
+ * Prints the key of the specified record.
+ */
+static void print_record_key(FILE *out_file, const Record *record, FieldId field_id)
+{
+    switch (field_id)
+    {
+    case FIELD_STRING:
+        fprintf(out_file, "%s", record->field1);
+        return;
+    case FIELD_INTEGER:
+        fprintf(out_file, "%d", record->field2);
+        return;
+    case FIELD_FLOAT:
+        fprintf(out_file, "%f", record->field3);
+        return;
+    }
+
+    PRINT_ERROR("Invalid field ID", print_record_key);
+}
+
+/**
+ * The output of the sorted records, which collapses adjacent records with equal keys when aggregating.
+ */
+typedef struct OutputSink
+{
+    FILE *out_file;           /** The output file. */
+    RecordsWriter *writer;    /** The writer of the records (NULL when groups are counted or summed). */
+    AggregateMode aggregate;  /** How adjacent records with equal keys are collapsed. */
+    FieldId field_id;         /** The field by which records are sorted. */
+    FieldId sum_field_id;     /** The summed field of AGGREGATE_SUM. */
+    compare_fn compare;       /** The comparison function of the records. */
+    Record group;             /** The first record of the current group. */
+    size_t group_count;       /** The number of records of the current group (0 before the first record). */
+    long long group_int_sum;  /** The sum of the summed field over the current group, if it is FIELD_INTEGER (exact). */
+    double group_sum;         /** The sum of the summed field over the current group, if it is FIELD_FLOAT. */
+    size_t num_written;       /** The number of written records or groups. */
+} OutputSink;
+
+/**
+ * Opens the output of the sorted records, building their sparse index if requested by the options.
+ */
+static void open_output_sink(OutputSink *sink, FILE *out_file, FieldId field_id, const SortOptions *options)
+{
+    memset(sink, 0, sizeof(*sink));
+    sink->out_file = out_file;
+    sink->aggregate = options->aggregate;
+    sink->field_id = field_id;
+    sink->sum_field_id = options->sum_field_id;
+    sink->compare = get_records_comparator(field_id);
+
+    // Groups are written as short lines of their own, so they are neither formatted in parallel nor indexed.
+    if (sink->aggregate == AGGREGATE_COUNT || sink->aggregate == AGGREGATE_SUM)
+    {
+        ASSERT(!options->index_every, "The aggregated output cannot be indexed", open_output_sink);
+        return;
+    }
+
+    sink->writer = open_records_writer(out_file);
+
+    if (options->index_every)
+    {
+        ASSERT(options->index_path, "The path of the index file has not been specified", open_output_sink);
+        index_records_writer(sink->writer, field_id, options->index_every, options->index_path);
+    }
+}
+
+/**
+ * Writes the current group (its key, its number of records and, if summed, the sum of the summed field).
+ */
+static void write_group(OutputSink *sink)
+{
+    print_record_key(sink->out_file, &sink->group, sink->field_id);
+
+    if (sink->aggregate == AGGREGATE_SUM && sink->sum_field_id == FIELD_INTEGER)
+        fprintf(sink->out_file, ",%zu,%lld\n", sink->group_count, sink->group_int_sum);
+    else if (sink->aggregate == AGGREGATE_SUM)
+        fprintf(sink->out_file, ",%zu,%f\n", sink->group_count, sink->group_sum);
+    else
+        fprintf(sink->out_file, ",%zu\n", sink->group_count);
+
+    sink->num_written++;
+}
+
+/**
+ * Writes the specified sorted records to the output, collapsing them into the current group while their keys are
+ * equal to its key.
+ */
+static void sink_records(OutputSink *sink, const Record *records, size_t num_records)
+{
+    size_t i;
+
+    if (sink->aggregate == AGGREGATE_NONE)
+    {
+        write_records(sink->writer, records, num_records);
+        sink->num_written += num_records;
+        return;
+    }
+
+    for (i = 0; i < num_records; i++)
+    {
+        if (sink->group_count > 0 && !sink->compare(&sink->group, &records[i]))
+        {
+            sink->group_count++;
+            sink->group_int_sum += records[i].field2;
+            sink->group_sum += records[i].field3;
+            continue;
+        }
+
+        if (sink->group_count > 0 && sink->aggregate != AGGREGATE_UNIQUE)
+            write_group(sink);
+
+        // The first record of each group is kept (the sort being stable, the first one of the input).
+        sink->group = records[i];
+        sink->group_count = 1;
+        sink->group_int_sum = records[i].field2;
+        sink->group_sum = records[i].field3;
+
+        if (sink->aggregate == AGGREGATE_UNIQUE)
+        {
+            write_records(sink->writer, &records[i], 1);
+            sink->num_written++;
+        }
+    }
+}
+
+/**
+ * Writes the pending group and closes the output, returning the number of written records or groups.
+ */
+static size_t close_output_sink(OutputSink *sink)
+{
+    if (sink->group_count > 0 && (sink->aggregate == AGGREGATE_COUNT || sink->aggregate == AGGREGATE_SUM))
+        write_group(sink);
+
+    if (sink->writer)
+        close_records_writer(sink->writer);
+
+    return sink->num_written;
+}
+
+/**
+ * Tests whether the string fields are sorted by a key derived from them (see `StringKeyFlags`).
+ */
+static int has_string_keys(const SortOptions *options)
+{
+    return options->collate || options->fold_case || options->natural_order;
+}
+
+/**
+ * Checks that the aggregation can be combined with the other options.
+ */
+static void check_aggregate_options(const SortOptions *options)
+{
+    if (options->aggregate == AGGREGATE_NONE)
+        return;
+
+    ASSERT(options->aggregate >= AGGREGATE_UNIQUE && options->aggregate <= AGGREGATE_SUM, "Invalid aggregation", check_aggregate_options);
+    ASSERT(options->aggregate != AGGREGATE_SUM || options->sum_field_id == FIELD_INTEGER || options->sum_field_id == FIELD_FLOAT, "Only numeric fields can be summed", check_aggregate_options);
+    ASSERT(!options->limit, "The limit is not available when aggregating", check_aggregate_options);
+    ASSERT(!options->num_quantiles, "The quantile report is not available when aggregating", check_aggregate_options);
+    ASSERT(!options->string_arena && !options->intern_strings && !has_string_keys(options), "The string arena is not available when aggregating", check_aggregate_options);
+}
+
+/**
+ * Stores the records in the specified file from the specified records array.
+ */
+static void store_records(FILE *out_file, Record *records, size_t num_records, FieldId field_id, const SortOptions *options)
+{
+    OutputSink sink;
+
+    open_output_sink(&sink, out_file, field_id, options);
+    sink_records(&sink, records, num_records);
+    close_output_sink(&sink);
+}
+
+/**
+ * Loads the records of the specified file (either CSV or binary) into a newly allocated array.
+ */
+static Record *load_input(FILE *in_file, size_t *num_records)
+{
+    Record *records;
+
+    if (read_records_file_header(in_file, num_records))
+    {
+        records = allocate_large(sizeof(Record) * *num_records);
+        ASSERT(records, "Unable to allocate space for 'records'", load_input);
+        count_memory(MEMORY_PHASE_LOAD, sizeof(Record) * *num_records);
+
+        // The records are read by a single thread, unlike the CSV records parsed in place by the worker threads.
+        prefault_large(records, sizeof(Record) * *num_records);
+        read_binary_records(in_file, records, *num_records);
+        return records;
+    }
+
+    return load_records(in_file, num_records);
+}
+
+/**
+ * The record comparision function.
+ */
+static int compare_records_fn(const void *record_a, const void *record_b)
+{
+    const Record *a = (const Record *)record_a;
+    const Record *b = (const Record *)record_b;
+
+    switch (g_field_id)
+    {
+    case FIELD_STRING:
+        return string_comparator(a->field1, b->field1);
+    case FIELD_INTEGER:
+        return int_comparator(&a->field2, &b->field2);
+    case FIELD_FLOAT:
+        return float_comparator(&a->field3, &b->field3);
+    }
+
+    PRINT_ERROR("Invalid field ID", compare_records_fn);
+}
+
+/**
+ * Compares records by their string field.
+ */
+static int compare_records_by_string(const void *record_a, const void *record_b)
+{
+    return string_comparator(((const Record *)record_a)->field1, ((const Record *)record_b)->field1);
+}
+
+/**
+ * Compares records by their integer field.
+ */
+static int compare_records_by_integer(const void *record_a, const void *record_b)
+{
+    return int_comparator(&((const Record *)record_a)->field2, &((const Record *)record_b)->field2);
+}
+
+/**
+ * Compares records by their float field.
+ */
+static int compare_records_by_float(const void *record_a, const void *record_b)
+{
+    return float_comparator(&((const Record *)record_a)->field3, &((const Record *)record_b)->field3);
+}
+
+compare_fn get_records_comparator(FieldId field_id)
+{
+    switch (field_id)
+    {
+    case FIELD_STRING:
+        return compare_records_by_string;
+    case FIELD_INTEGER:
+        return compare_records_by_integer;
+    case FIELD_FLOAT:
+        return compare_records_by_float;
+    }
+
+    PRINT_ERROR("Invalid field ID", get_records_comparator);
+}
+
+Record *load_records_file(FILE *in_file, size_t *num_records)
+{
+    ASSERT_NULL_PARAMETER(in_file, load_records_file);
+    ASSERT_NULL_PARAMETER(num_records, load_records_file);
+
+    return load_input(in_file, num_records);
+}
+
+const char *get_field_name(FieldId field_id)
+{
+    switch (field_id)
+    {
+    case FIELD_STRING:
+        return "STRING";
+    case FIELD_INTEGER:
+        return "INTEGER";
+    case FIELD_FLOAT:
+        return "FLOAT";
+    }
+
+    PRINT_ERROR("Invalid field ID", get_field_name);
+}
+
+const char *get_algorithm_name(AlgorithmId algorithm_id)
+{
+    switch (algorithm_id)
+    {
+    case ALGORITHM_MERGESORT:
+        return "MERGESORT";
+    case ALGORITHM_QUICKSORT:
+        return "QUICKSORT";
+    case ALGORITHM_BININSSORT:
+        return "BINARYINSERTIONSORT";
+    case ALGORITHM_MERGEBININSSORT:
+        return "MERGEBINARYINSERTIONSORT";
+    case ALGORITHM_AUTO:
+        return "AUTO";
+    }
+
+    PRINT_ERROR("Invalid algorithm ID", get_algorithm_name);
+}
+
+/**
+ * Retrieves the peak scratch memory of an algorithm sorting an array: merge sort (also used by merge binary insertion
+ * sort) allocates a merge buffer as large as the merged elements, the other algorithms only swap elements.
+ */
+static size_t get_sort_scratch(AlgorithmId algorithm_id, size_t num_records, size_t size)
+{
+    return algorithm_id == ALGORITHM_MERGESORT || algorithm_id == ALGORITHM_MERGEBININSSORT ? num_records * size : 0;
+}
+
+/**
+ * Sorts an array of records (of any layout) with the specified algorithm.
+ */
+static void sort_array(void *records, size_t num_records, size_t size, compare_fn compar, AlgorithmId algorithm_id, size_t threshold)
+{
+    count_memory(MEMORY_PHASE_SORT, get_sort_scratch(algorithm_id, num_records, size));
+
+    switch (algorithm_id)
+    {
+    case ALGORITHM_MERGESORT:
+        merge_sort(records, num_records, size, compar);
+        return;
+    case ALGORITHM_QUICKSORT:
+        quick_sort(records, num_records, size, compar);
+        return;
+    case ALGORITHM_BININSSORT:
+        binary_insertion_sort(records, num_records, size, compar);
+        return;
+    case ALGORITHM_MERGEBININSSORT:
+        merge_binary_insertion_sort(records, num_records, size, threshold, compar);
+        return;
+    case ALGORITHM_AUTO:
+        break;
+    }
+
+    PRINT_ERROR("Invalid sorting algorithm id", sort_array);
+}
+
+/**
+ * Sorts the records array with the specified algorithm, by the field set in `g_field_id`.
+ */
+static void sort_records_array(Record *records, size_t num_records, AlgorithmId algorithm_id, size_t threshold)
+{
+    sort_array(records, num_records, sizeof(Record), compare_records_fn, algorithm_id, threshold);
+}
+
+/**
+ * Up to this number of records, ALGORITHM_AUTO uses binary insertion sort.
+ */
+#define AUTO_SMALL_INPUT 32
+
+/**
+ * The number of random pairs of records compared by ALGORITHM_AUTO to estimate the inversions ratio.
+ */
+#define AUTO_INVERSION_PAIRS 2048
+
+/**
+ * The number (and length) of the contiguous windows of records scanned by ALGORITHM_AUTO to count descents.
+ */
+#define AUTO_RUN_WINDOWS 64
+
+/**
+ * The number of random records sorted by ALGORITHM_AUTO to estimate the duplicates ratio.
+ */
+#define AUTO_DUPLICATES_SAMPLE 1024
+
+/**
+ * Above this duplicates ratio, ALGORITHM_AUTO does not use binary insertion sort, which shifts equal keys.
+ */
+#define AUTO_MAX_INSERTION_DUPLICATES 0.1
+
+/**
+ * The inversions ratio range in which ALGORITHM_AUTO considers the records randomly ordered.
+ */
+#define AUTO_RANDOM_MIN_INVERSIONS 0.25
+#define AUTO_RANDOM_MAX_INVERSIONS 0.75
+
+/**
+ * Retrieves the address of the record at the specified index of an array of records of the specified size.
+ */
+#define RECORD_AT(records, index, size) ((const char *)(records) + (size_t)(index) * (size))
+
+/**
+ * Tests whether an array of records is sorted, stopping at the first descent.
+ */
+static int is_records_array_sorted(const void *records, size_t num_records, size_t size, compare_fn compar)
+{
+    size_t i;
+
+    for (i = 1; i < num_records; i++)
+    {
+        if (compar(RECORD_AT(records, i - 1, size), RECORD_AT(records, i, size)) > 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Chooses the sorting algorithm by sampling an array of records (of any layout), printing the choice and its reasons if `verbose`.
+ */
+static AlgorithmId select_array_algorithm(const void *records, size_t num_records, size_t size, compare_fn compar, FieldId field_id, int verbose)
+{
+    Rng rng;
+    char *sample;
+    size_t i, j, window, window_len, sample_len, left, right;
+    size_t inversions, descents, adjacent_pairs, duplicates;
+    double inversions_ratio, descents_ratio, duplicates_ratio;
+    AlgorithmId algorithm_id;
+    const char *reason;
+
+    if (num_records <= AUTO_SMALL_INPUT)
+    {
+        if (verbose)
+            printf("Auto-selected %s: small input (%zu records).\n", get_algorithm_name(ALGORITHM_BININSSORT), num_records);
+        return ALGORITHM_BININSSORT;
+    }
+
+    rng_seed(&rng, num_records);
+
+    // Inversions between random pairs (an ascending input has none, a descending one has all of them).
+    inversions = 0;
+
+    for (i = 0; i < AUTO_INVERSION_PAIRS; i++)
+    {
+        left = (size_t)rng_next_below(&rng, num_records);
+        right = (size_t)rng_next_below(&rng, num_records);
+
+        if (left > right)
+        {
+            j = left;
+            left = right;
+            right = j;
+        }
+
+        if (left != right && compar(RECORD_AT(records, left, size), RECORD_AT(records, right, size)) > 0)
+            inversions++;
+    }
+
+    // Descents between adjacent records of contiguous windows, spread over the input (i.e., how fragmented the runs are).
+    window_len = num_records / AUTO_RUN_WINDOWS < AUTO_RUN_WINDOWS ? num_records / AUTO_RUN_WINDOWS : AUTO_RUN_WINDOWS;
+    window_len = window_len < 2 ? 2 : window_len;
+    descents = adjacent_pairs = 0;
+
+    for (window = 0; window < AUTO_RUN_WINDOWS; window++)
+    {
+        left = window * (num_records - window_len) / (AUTO_RUN_WINDOWS - 1);
+
+        for (j = left + 1; j < left + window_len; j++, adjacent_pairs++)
+        {
+            if (compar(RECORD_AT(records, j - 1, size), RECORD_AT(records, j, size)) > 0)
+                descents++;
+        }
+    }
+
+    // Equal neighbours in a sorted sample of random records.
+    sample_len = num_records < AUTO_DUPLICATES_SAMPLE ? num_records : AUTO_DUPLICATES_SAMPLE;
+    sample = malloc(size * sample_len);
+    ASSERT(sample, "Unable to allocate memory for the records sample", select_array_algorithm);
+
+    for (i = 0; i < sample_len; i++)
+        memcpy(sample + i * size, RECORD_AT(records, rng_next_below(&rng, num_records), size), size);
+
+    merge_sort(sample, sample_len, size, compar);
+
+    duplicates = 0;
+
+    for (i = 1; i < sample_len; i++)
+    {
+        if (!compar(sample + (i - 1) * size, sample + i * size))
+            duplicates++;
+    }
+
+    free(sample);
+
+    inversions_ratio = (double)inversions / AUTO_INVERSION_PAIRS;
+    descents_ratio = (double)descents / (double)adjacent_pairs;
+    duplicates_ratio = (double)duplicates / (double)(sample_len - 1);
+
+    // The sample misses a few displaced records, each of which would make binary insertion sort shift a large part of
+    // the input, so the order is checked in full (in linear time) before choosing it.
+    if (!inversions && !descents && duplicates_ratio <= AUTO_MAX_INSERTION_DUPLICATES && is_records_array_sorted(records, num_records, size, compar))
+    {
+        // Binary insertion sort shifts nothing on ordered inputs, so it only costs the binary searches.
+        algorithm_id = ALGORITHM_BININSSORT;
+        reason = "already sorted";
+    }
+    else if (field_id != FIELD_STRING && inversions_ratio >= AUTO_RANDOM_MIN_INVERSIONS && inversions_ratio <= AUTO_RANDOM_MAX_INVERSIONS &&
+             descents_ratio >= AUTO_RANDOM_MIN_INVERSIONS)
+    {
+        // Quick sort is the fastest in-place engine on shuffled inputs, but degrades on presorted runs.
+        algorithm_id = ALGORITHM_QUICKSORT;
+        reason = "randomly ordered numeric keys";
+    }
+    else if (field_id == FIELD_STRING)
+    {
+        // Merge-based sorting performs fewer (and here expensive) comparisons than quick sort.
+        algorithm_id = ALGORITHM_MERGEBININSSORT;
+        reason = "string keys are expensive to compare";
+    }
+    else
+    {
+        algorithm_id = ALGORITHM_MERGEBININSSORT;
+        reason = "presorted or reversed runs";
+    }
+
+    if (verbose)
+        printf("Auto-selected %s: %s (%zu records, %s keys, sampled inversions %.3f, descents %.3f, duplicates %.3f).\n",
+               get_algorithm_name(algorithm_id), reason, num_records, get_field_name(field_id), inversions_ratio, descents_ratio, duplicates_ratio);
+
+    return algorithm_id;
+}
+
+/**
+ * Chooses the sorting algorithm by sampling the records, by the field set in `g_field_id`.
+ */
+static AlgorithmId select_algorithm(Record *records, size_t num_records, FieldId field_id, int verbose)
+{
+    return select_array_algorithm(records, num_records, sizeof(Record), compare_records_fn, field_id, verbose);
+}
+
+AlgorithmId select_records_algorithm(const Record *records, size_t num_records, FieldId field_id)
+{
+    ASSERT(records || !num_records, "'records' parameter is NULL", select_records_algorithm);
+
+    return select_array_algorithm(records, num_records, sizeof(Record), get_records_comparator(field_id), field_id, 0);
+}
+
+size_t resolve_mergebininssort_threshold(FieldId field_id, size_t size, size_t threshold)
+{
+    const char *config_path;
+
+    if (threshold)
+        return threshold;
+
+    config_path = get_tuning_config_path();
+
+    if (read_tuned_threshold(config_path, get_field_name(field_id), size, &threshold))
+    {
+        printf("Using tuned threshold %zu (from '%s').\n", threshold, config_path);
+        return threshold;
+    }
+
+    printf("Using default threshold %d (no tuned threshold in '%s').\n", DEFAULT_MERGEBININSSORT_THRESHOLD, config_path);
+    return DEFAULT_MERGEBININSSORT_THRESHOLD;
+}
+
+/**
+ * A chunk of records of the pipelined mode, sorted in the background while the next ones are loaded.
+ */
+typedef struct PipelineChunk
+{
+    Record *records;          /** The records of the chunk. */
+    size_t num_records;       /** The number of records of the chunk. */
+    size_t position;          /** The position of the next record to be merged. */
+    size_t index;             /** The index of the chunk. */
+    FieldId field_id;         /** The field by which records are sorted. */
+    AlgorithmId algorithm_id; /** The sorting algorithm (ALGORITHM_AUTO chooses it for each chunk). */
+    size_t threshold;         /** The threshold of merge binary insertion sort. */
+    size_t limit;             /** The number of smallest records to be kept (0 keeps every record). */
+    TaskGroup *sorting;       /** The task sorting the chunk. */
+} PipelineChunk;
+
+/**
+ * Sorts a chunk of the pipelined mode.
+ */
+static void sort_chunk(void *context, size_t index)
+{
+    PipelineChunk *chunk = (PipelineChunk *)context;
+    AlgorithmId algorithm_id;
+    Record *shrunk;
+
+    (void)index;
+
+    // Only the smallest records of each chunk can be among the smallest ones of the whole input.
+    if (chunk->limit)
+    {
+        partial_sort(chunk->records, chunk->num_records, sizeof(Record), chunk->limit, compare_records_fn);
+
+        if (chunk->limit < chunk->num_records)
+        {
+            shrunk = allocate_large(sizeof(Record) * chunk->limit);
+            ASSERT(shrunk, "Unable to shrink the chunk", sort_chunk);
+
+            memcpy(shrunk, chunk->records, sizeof(Record) * chunk->limit);
+            free_large(chunk->records);
+
+            chunk->records = shrunk;
+            chunk->num_records = chunk->limit;
+        }
+
+        return;
+    }
+
+    algorithm_id = chunk->algorithm_id;
+
+    // Chunks are sampled separately, since their order may differ, but only the choice for the first one is printed.
+    if (algorithm_id == ALGORITHM_AUTO)
+        algorithm_id = select_algorithm(chunk->records, chunk->num_records, chunk->field_id, chunk->index == 0);
+
+    sort_records_array(chunk->records, chunk->num_records, algorithm_id, chunk->threshold);
+}
+
+/**
+ * Retrieves the next record of a sorted chunk (see `MergeSourceFn`).
+ */
+static const void *next_chunk_record(void *source)
+{
+    PipelineChunk *chunk = (PipelineChunk *)source;
+
+    return chunk->position < chunk->num_records ? &chunk->records[chunk->position++] : NULL;
+}
+
+/**
+ * Sorts the records in pipelined mode: chunks are sorted on worker threads while the next ones are loaded, then
+ * they are k-way merged into the output writer.
+ */
+static void sort_records_pipelined(FILE *in_file, FILE *out_file, FieldId field_id, AlgorithmId algorithm_id, size_t threshold, size_t chunk_records, const SortOptions *options)
+{
+    PipelineChunk **chunks;
+    PipelineChunk *chunk;
+    Merger *merger;
+    RecordsReader *reader;
+    OutputSink sink;
+    const Record *record;
+    size_t num_chunks, chunks_capacity, max_sorting, num_written, limit, i;
+
+    limit = options->limit;
+    max_sorting = get_num_threads() > 1 ? get_num_threads() - 1 : 1;
+    reader = open_records_reader(in_file);
+
+    chunks_capacity = 16;
+    chunks = malloc(sizeof(PipelineChunk *) * chunks_capacity);
+    ASSERT(chunks, "Unable to allocate memory for the pipeline", sort_records_pipelined);
+
+    printf("Loading and sorting records (%zu records per chunk)...\n", chunk_records);
+
+    for (num_chunks = 0;; num_chunks++)
+    {
+        chunk = malloc(sizeof(PipelineChunk));
+        ASSERT(chunk, "Unable to allocate memory for the pipeline", sort_records_pipelined);
+
+        chunk->records = allocate_large(sizeof(Record) * chunk_records);
+        ASSERT(chunk->records, "Unable to allocate space for 'records'", sort_records_pipelined);
+        count_memory(MEMORY_PHASE_LOAD, sizeof(Record) * chunk_records);
+
+        chunk->num_records = read_records(reader, chunk->records, chunk_records);
+
+        if (!chunk->num_records)
+        {
+            free_large(chunk->records);
+            free(chunk);
+            break;
+        }
+
+        if (num_chunks == chunks_capacity)
+        {
+            chunks_capacity *= 2;
+            chunks = realloc(chunks, sizeof(PipelineChunk *) * chunks_capacity);
+            ASSERT(chunks, "Unable to allocate memory for the pipeline", sort_records_pipelined);
+        }
+
+        chunk->position = 0;
+        chunk->index = num_chunks;
+        chunk->field_id = field_id;
+        chunk->algorithm_id = algorithm_id;
+        chunk->threshold = threshold;
+        chunk->limit = limit;
+        chunks[num_chunks] = chunk;
+
+        // Bound the number of chunks being sorted while the next one is loaded.
+        if (num_chunks >= max_sorting)
+        {
+            wait_tasks(chunks[num_chunks - max_sorting]->sorting);
+            chunks[num_chunks - max_sorting]->sorting = NULL;
+        }
+
+        chunk->sorting = start_tasks(1, sort_chunk, chunk);
+    }
+
+    for (i = 0; i < num_chunks; i++)
+        wait_tasks(chunks[i]->sorting);
+
+    close_records_reader(reader);
+
+    printf("Merging %zu sorted chunks into the output...\n", num_chunks);
+    open_output_sink(&sink, out_file, field_id, options);
+
+    if (num_chunks > 0)
+    {
+        merger = create_merger((void **)chunks, num_chunks, next_chunk_record, compare_records_fn);
+
+        for (num_written = 0; (!limit || num_written < limit) && (record = merger_next(merger)); num_written++)
+            sink_records(&sink, record, 1);
+
+        destroy_merger(merger);
+    }
+
+    close_output_sink(&sink);
+
+    for (i = 0; i < num_chunks; i++)
+    {
+        free_large(chunks[i]->records);
+        free(chunks[i]);
+    }
+
+    free(chunks);
+}
+
+/**
+ * The number of records written at a time to the runs merged by an intermediate pass of the external mode.
  */
-#define STRING_FIELD_LEN 32
-#endif
+#define SPILL_BLOCK_RECORDS 4096
+
+/**
+ * Spills sorted records to a new temporary binary records file, rewound to be read back (it is deleted once closed).
+ */
+static FILE *spill_run(const Record *records, size_t num_records)
+{
+    FILE *run;
+
+    run = tmpfile();
+    ASSERT(run, "Unable to create a temporary file for a spilled run", spill_run);
+    setvbuf(run, NULL, _IOFBF, INPUT_FILE_BUFFER_SIZE);
+
+    write_records_file_header(run, num_records);
+    write_binary_records(run, records, num_records);
+    rewind(run);
+
+    return run;
+}
+
+/**
+ * Merges spilled runs (up to `limit` records, if not zero) into the output sink or, if `sink` is NULL, into a new
+ * spilled run, which is returned. The merged runs are closed.
+ */
+static FILE *merge_runs(FILE **runs, size_t num_runs, OutputSink *sink, size_t limit)
+{
+    RecordsReader **readers;
+    Merger *merger;
+    Record *block;
+    const Record *record;
+    FILE *merged;
+    size_t num_merged, count, i;
+
+    readers = malloc(sizeof(RecordsReader *) * num_runs);
+    ASSERT(readers, "Unable to allocate memory for the runs", merge_runs);
+
+    for (i = 0; i < num_runs; i++)
+        readers[i] = open_records_reader(runs[i]);
+
+    count_memory(MEMORY_PHASE_SPILL, get_records_reader_memory() * num_runs);
+    merger = create_merger((void **)readers, num_runs, next_record, compare_records_fn);
+
+    merged = NULL;
+    block = NULL;
+
+    if (!sink)
+    {
+        // The header is rewritten once the number of merged records is known.
+        merged = tmpfile();
+        ASSERT(merged, "Unable to create a temporary file for a spilled run", merge_runs);
+        setvbuf(merged, NULL, _IOFBF, INPUT_FILE_BUFFER_SIZE);
+        write_records_file_header(merged, 0);
+
+        block = malloc(sizeof(Record) * SPILL_BLOCK_RECORDS);
+        ASSERT(block, "Unable to allocate memory for the runs", merge_runs);
+        count_memory(MEMORY_PHASE_SPILL, sizeof(Record) * SPILL_BLOCK_RECORDS);
+    }
+
+    for (num_merged = 0, count = 0; (!limit || num_merged < limit) && (record = merger_next(merger)); num_merged++)
+    {
+        if (sink)
+        {
+            sink_records(sink, record, 1);
+            continue;
+        }
+
+        block[count++] = *record;
+
+        if (count == SPILL_BLOCK_RECORDS)
+        {
+            write_binary_records(merged, block, count);
+            count = 0;
+        }
+    }
+
+    if (merged)
+    {
+        write_binary_records(merged, block, count);
+        rewind(merged);
+        write_records_file_header(merged, num_merged);
+        rewind(merged);
+        free(block);
+    }
+
+    destroy_merger(merger);
+
+    for (i = 0; i < num_runs; i++)
+    {
+        close_records_reader(readers[i]);
+        ASSERT(!fclose(runs[i]), "Unable to close a spilled run", merge_runs);
+    }
+
+    free(readers);
+    return merged;
+}
+
+/**
+ * Sorts a chunk of the external mode, returning the number of records to be kept. An algorithm chosen by
+ * ALGORITHM_AUTO is replaced by quick sort, which sorts in place, if its scratch memory does not fit `available`.
+ */
+static size_t sort_external_chunk(Record *records, size_t num_records, FieldId field_id, AlgorithmId algorithm_id, size_t threshold, size_t limit, size_t available, int verbose)
+{
+    if (!num_records)
+        return 0;
+
+    if (limit)
+    {
+        partial_sort(records, num_records, sizeof(Record), limit, compare_records_fn);
+        return limit < num_records ? limit : num_records;
+    }
+
+    if (algorithm_id == ALGORITHM_AUTO)
+    {
+        algorithm_id = select_algorithm(records, num_records, field_id, verbose);
+
+        if (sizeof(Record) * num_records + get_sort_scratch(algorithm_id, num_records, sizeof(Record)) > available)
+        {
+            if (verbose)
+                printf("Using %s instead, since the merge buffer does not fit the memory budget.\n", get_algorithm_name(ALGORITHM_QUICKSORT));
+
+            algorithm_id = ALGORITHM_QUICKSORT;
+        }
+    }
+
+    sort_records_array(records, num_records, algorithm_id, threshold);
+    return num_records;
+}
+
+/**
+ * Sorts the records in external mode, within the memory budget: the input is read in runs as large as the budget
+ * allows, which are sorted and spilled to temporary files, then k-way merged into the output (in several passes,
+ * if the buffers of the runs do not fit the budget at once). An input fitting a single run is not spilled.
+ */
+static void sort_records_external(FILE *in_file, FILE *out_file, FieldId field_id, AlgorithmId algorithm_id, size_t threshold, const SortOptions *options)
+{
+    RecordsReader *reader;
+    OutputSink sink;
+    FILE **runs;
+    Record *records;
+    size_t budget, reader_memory, writer_memory, available, capacity, num_records, num_runs, runs_capacity, fan_in, spilled, count, i, j;
+    int exhausted;
+
+    budget = options->max_memory;
+    reader_memory = get_records_reader_memory();
+    writer_memory = get_records_writer_memory();
+
+    // The loaded records share the budget with the input reader and, if the input fits a single run, the writer;
+    // merging needs the writer and at least two readers.
+    if (budget <= reader_memory * 2 + writer_memory)
+    {
+        printf("The memory budget must be greater than %zu bytes.\n", reader_memory * 2 + writer_memory);
+        PRINT_ERROR("The memory budget is too small", sort_records_external);
+    }
+
+    available = budget - reader_memory - writer_memory;
+
+    // Merge sort needs a merge buffer as large as the sorted records (AUTO falls back to quick sort instead).
+    capacity = available / (sizeof(Record) + (options->limit ? 0 : get_sort_scratch(algorithm_id, 1, sizeof(Record))));
+
+    reader = open_records_reader(in_file);
+    count_memory(MEMORY_PHASE_LOAD, reader_memory);
+
+    records = allocate_large(sizeof(Record) * capacity);
+    ASSERT(records, "Unable to allocate space for 'records'", sort_records_external);
+    count_memory(MEMORY_PHASE_LOAD, sizeof(Record) * capacity);
+
+    printf("Loading and sorting records (%zu records per run)...\n", capacity);
+
+    runs = NULL;
+    num_runs = runs_capacity = 0;
+    spilled = 0;
+
+    do
+    {
+        num_records = read_records(reader, records, capacity);
+        exhausted = num_records < capacity;
+        num_records = sort_external_chunk(records, num_records, field_id, algorithm_id, threshold, options->limit, available, num_runs == 0);
+
+        if (exhausted && !num_runs)
+        {
+            close_records_reader(reader);
+
+            printf("Saving records...\n");
+            store_records(out_file, records, num_records, field_id, options);
+
+            free_large(records);
+            return;
+        }
+
+        if (!num_records)
+            continue;
+
+        if (num_runs == runs_capacity)
+        {
+            runs_capacity = runs_capacity ? runs_capacity * 2 : 16;
+            runs = realloc(runs, sizeof(FILE *) * runs_capacity);
+            ASSERT(runs, "Unable to allocate memory for the runs", sort_records_external);
+        }
+
+        runs[num_runs++] = spill_run(records, num_records);
+        spilled += sizeof(Record) * num_records;
+    } while (!exhausted);
+
+    close_records_reader(reader);
+    free_large(records);
+
+    printf("Spilled %zu runs (%zu bytes) to temporary files.\n", num_runs, spilled);
+
+    fan_in = (budget - writer_memory) / reader_memory;
+
+    while (num_runs > fan_in)
+    {
+        printf("Merging %zu runs, %zu at a time...\n", num_runs, fan_in);
+
+        // Consecutive runs are merged in order, so that records with equal keys keep their order.
+        for (i = 0, j = 0; i < num_runs; i += count, j++)
+        {
+            count = num_runs - i < fan_in ? num_runs - i : fan_in;
+            runs[j] = count > 1 ? merge_runs(&runs[i], count, NULL, options->limit) : runs[i];
+        }
+
+        num_runs = j;
+    }
+
+    printf("Merging %zu runs into the output...\n", num_runs);
+
+    open_output_sink(&sink, out_file, field_id, options);
+    merge_runs(runs, num_runs, &sink, options->limit);
+    close_output_sink(&sink);
+
+    free(runs);
+}
+
+/**
+ * Selects the records at the ranks of the requested quantiles, printing their keys and writing them to the output.
+ */
+static void report_quantiles(FILE *out_file, Record *records, size_t num_records, FieldId field_id, const double *quantiles, size_t num_quantiles)
+{
+    size_t ranks[MAX_QUANTILES], sorted_ranks[MAX_QUANTILES];
+    RecordsWriter *writer;
+    size_t i, j, rank;
+
+    ASSERT(num_records > 0, "Quantiles of an empty input", report_quantiles);
+    ASSERT(num_quantiles > 0 && num_quantiles <= MAX_QUANTILES, "Invalid number of quantiles", report_quantiles);
+
+    // Nearest-rank definition: the q-th percentile is the smallest record with at least q% of the records before or at it.
+    for (i = 0; i < num_quantiles; i++)
+    {
+        rank = (size_t)ceil(quantiles[i] / 100.0 * (double)num_records);
+        ranks[i] = rank > 0 ? (rank <= num_records ? rank - 1 : num_records - 1) : 0;
+    }
+
+    // The selection requires ascending ranks, while the report follows the requested order.
+    memcpy(sorted_ranks, ranks, sizeof(size_t) * num_quantiles);
+
+    for (i = 1; i < num_quantiles; i++)
+    {
+        rank = sorted_ranks[i];
+
+        for (j = i; j > 0 && sorted_ranks[j - 1] > rank; j--)
+            sorted_ranks[j] = sorted_ranks[j - 1];
+
+        sorted_ranks[j] = rank;
+    }
+
+    select_quantiles(records, num_records, sizeof(Record), sorted_ranks, num_quantiles, compare_records_fn);
+
+    writer = open_records_writer(out_file);
+
+    for (i = 0; i < num_quantiles; i++)
+    {
+        printf("p%g (rank %zu of %zu): ", quantiles[i], ranks[i] + 1, num_records);
+        print_record_key(stdout, &records[ranks[i]], field_id);
+        printf("\n");
+
+        write_records(writer, &records[ranks[i]], 1);
+    }
+
+    close_records_writer(writer);
+}
+
+/**
+ * An input of the merge whose order is verified while it is read.
+ */
+typedef struct VerifiedInput
+{
+    RecordsReader *reader; /** The reader of the input. */
+    const char *path;      /** The path of the input, to report unsorted records. */
+    compare_fn compare;    /** The comparison function of the records. */
+    Record last;           /** The last record read (valid if `position` is greater than zero). */
+    size_t position;       /** The number of records read. */
+} VerifiedInput;
+
+/**
+ * Reads the next record of a verified input, aborting if it precedes the previous one.
+ */
+static const void *next_verified_record(void *source)
+{
+    VerifiedInput *input = (VerifiedInput *)source;
+    const Record *record;
+
+    record = (const Record *)next_record(input->reader);
+
+    if (!record)
+        return NULL;
+
+    if (input->position > 0 && input->compare(&input->last, record) > 0)
+    {
+        printf("'%s' is not sorted at record %zu\n", input->path, input->position + 1);
+        PRINT_ERROR("Unsorted merge input", next_verified_record);
+    }
+
+    input->last = *record;
+    input->position++;
+
+    return record;
+}
+
+void merge_records_files(const char *const *in_paths, size_t num_files, FILE *out_file, FieldId field_id, const SortOptions *options)
+{
+    FILE **in_files;
+    RecordsReader **readers;
+    VerifiedInput *inputs;
+    void **sources;
+    OutputSink sink;
+    Merger *merger;
+    const void *record;
+    size_t num_written, i;
+
+    ASSERT_NULL_PARAMETER(in_paths, merge_records_files);
+    ASSERT_NULL_PARAMETER(out_file, merge_records_files);
+    ASSERT_NULL_PARAMETER(options, merge_records_files);
+    ASSERT(num_files > 0, "No input files to merge", merge_records_files);
+    ASSERT(field_id >= FIELD_STRING && field_id <= FIELD_FLOAT, "Invalid field id", merge_records_files);
+    ASSERT(!has_string_keys(options), "The string keys are not available when merging", merge_records_files);
+    ASSERT(!options->num_quantiles, "The quantile report is not available when merging", merge_records_files);
+    check_aggregate_options(options);
+
+    in_files = malloc(sizeof(FILE *) * num_files);
+    readers = malloc(sizeof(RecordsReader *) * num_files);
+    inputs = malloc(sizeof(VerifiedInput) * num_files);
+    sources = malloc(sizeof(void *) * num_files);
+    ASSERT(in_files && readers && inputs && sources, "Unable to allocate memory for the merge inputs", merge_records_files);
+
+    for (i = 0; i < num_files; i++)
+    {
+        in_files[i] = open_input_file(in_paths[i]);
+
+        readers[i] = open_records_reader(in_files[i]);
+
+        inputs[i].reader = readers[i];
+        inputs[i].path = in_paths[i];
+        inputs[i].compare = get_records_comparator(field_id);
+        inputs[i].position = 0;
+
+        sources[i] = options->verify ? (void *)&inputs[i] : (void *)readers[i];
+    }
+
+    printf("Merging %zu sorted files...\n", num_files);
+
+    open_output_sink(&sink, out_file, field_id, options);
+    merger = create_merger(sources, num_files, options->verify ? next_verified_record : next_record, get_records_comparator(field_id));
+
+    for (num_written = 0; (!options->limit || num_written < options->limit) && (record = merger_next(merger)); num_written++)
+        sink_records(&sink, (const Record *)record, 1);
+
+    destroy_merger(merger);
+    close_output_sink(&sink);
+
+    for (i = 0; i < num_files; i++)
+    {
+        close_records_reader(readers[i]);
+        ASSERT(!fclose(in_files[i]), "Unable to close input file", merge_records_files);
+    }
+
+    free(in_files);
+    free(readers);
+    free(inputs);
+    free(sources);
+    printf("Done\n");
+}
+
+/**
+ * The number of records converted at a time when a binary input is loaded into the string arena.
+ */
+#define ARENA_LOAD_BLOCK_RECORDS 4096
+
+/**
+ * Loads the records of the specified file (either CSV or binary) into a newly allocated array of arena records,
+ * storing their string fields (of any length, for CSV inputs) into the arena.
+ */
+static ArenaRecord *load_arena_input(FILE *in_file, StringArena *arena, int key_flags, size_t *num_records)
+{
+    ArenaRecord *records;
+    Record *block;
+    char *data;
+    const char *current, *end;
+    size_t size, i, j, count;
+
+    if (read_records_file_header(in_file, num_records))
+    {
+        records = malloc(sizeof(ArenaRecord) * *num_records);
+        block = malloc(sizeof(Record) * ARENA_LOAD_BLOCK_RECORDS);
+        ASSERT((records || !*num_records) && block, "Unable to allocate space for 'records'", load_arena_input);
+        count_memory(MEMORY_PHASE_LOAD, sizeof(ArenaRecord) * *num_records + sizeof(Record) * ARENA_LOAD_BLOCK_RECORDS);
+
+        for (i = 0; i < *num_records; i += count)
+        {
+            count = *num_records - i < ARENA_LOAD_BLOCK_RECORDS ? *num_records - i : ARENA_LOAD_BLOCK_RECORDS;
+            read_binary_records(in_file, block, count);
+
+            for (j = 0; j < count; j++)
+                to_arena_record(&block[j], &records[i + j], arena, key_flags);
+        }
+
+        free(block);
+        return records;
+    }
+
+    // The strings are interned in order, so the CSV input is parsed by a single thread.
+    data = read_whole_file(in_file, &size);
+    end = data + size;
+
+    for (*num_records = 0, current = data; current < end && (current = memchr(current, '\n', (size_t)(end - current))); current++)
+        (*num_records)++;
+
+    if (size > 0 && end[-1] != '\n')
+        (*num_records)++;
+
+    records = malloc(sizeof(ArenaRecord) * *num_records);
+    ASSERT(records || !*num_records, "Unable to allocate space for 'records'", load_arena_input);
+    count_memory(MEMORY_PHASE_LOAD, size + sizeof(ArenaRecord) * *num_records);
+
+    for (i = 0, current = data; current < end; i++)
+        current = parse_arena_record_csv(current, &records[i], arena, key_flags);
+
+    free(data);
+    return records;
+}
+
+/**
+ * Sorts the records with their string fields stored in an arena (see `SortOptions.string_arena`).
+ */
+static void sort_records_in_arena(FILE *in_file, FILE *out_file, FieldId field_id, AlgorithmId algorithm_id, void *param, const SortOptions *options)
+{
+    StringArena *arena;
+    ArenaRecord *records;
+    compare_fn compar;
+    size_t num_records, i;
+    int key_flags;
+
+    ASSERT(!options->index_every, "The index is not available with the string arena", sort_records_in_arena);
+    ASSERT(!options->collate || !options->natural_order, "The natural order cannot be combined with the collation", sort_records_in_arena);
+
+    arena = create_string_arena(options->intern_strings);
+
+    // Only the sorted string field needs its sort key.
+    key_flags = STRING_KEY_NONE;
+
+    if (field_id == FIELD_STRING)
+    {
+        key_flags |= options->collate ? STRING_KEY_COLLATE : 0;
+        key_flags |= options->fold_case ? STRING_KEY_FOLD_CASE : 0;
+        key_flags |= options->natural_order ? STRING_KEY_NATURAL : 0;
+    }
+
+    printf("Loading records...\n");
+    records = load_arena_input(in_file, arena, key_flags, &num_records);
+    count_memory(MEMORY_PHASE_LOAD, get_string_arena_size(arena));
+    printf("Loaded %zu records (%zu bytes of %s strings%s).\n", num_records, get_string_arena_size(arena), options->intern_strings ? "interned" : "arena", key_flags ? " and sort keys" : "");
+
+    compar = get_arena_records_comparator(arena, field_id);
+
+    if (options->limit)
+    {
+        printf("Sorting the first %zu records...\n", options->limit);
+
+        if (num_records > 0)
+            partial_sort(records, num_records, sizeof(ArenaRecord), options->limit, compar);
+
+        num_records = options->limit < num_records ? options->limit : num_records;
+    }
+    else
+    {
+        printf("Sorting records...\n");
+
+        if (algorithm_id == ALGORITHM_AUTO)
+            algorithm_id = select_array_algorithm(records, num_records, sizeof(ArenaRecord), compar, field_id, 1);
+
+        if (algorithm_id == ALGORITHM_MERGEBININSSORT)
+            param = (void *)resolve_mergebininssort_threshold(field_id, sizeof(ArenaRecord), (size_t)param);
+
+        if (num_records > 0)
+            sort_array(records, num_records, sizeof(ArenaRecord), compar, algorithm_id, (size_t)param);
+    }
+
+    printf("Saving records...\n");
+
+    for (i = 0; i < num_records; i++)
+        write_arena_record_csv(out_file, &records[i], arena, key_flags);
+
+    free(records);
+    destroy_string_arena(arena);
+    printf("Done\n");
+}
+
+void sort_loaded_records(Record *records, size_t num_records, FieldId field_id, AlgorithmId algorithm_id, void *param)
+{
+    ASSERT(records || !num_records, "'records' parameter is NULL", sort_loaded_records);
+    ASSERT(field_id >= FIELD_STRING && field_id <= FIELD_FLOAT, "Invalid field id", sort_loaded_records);
+    ASSERT(algorithm_id >= ALGORITHM_MERGESORT && algorithm_id <= ALGORITHM_AUTO, "Invalid algorithm id", sort_loaded_records);
+
+    g_field_id = field_id;
+
+    if (algorithm_id == ALGORITHM_AUTO)
+        algorithm_id = select_algorithm(records, num_records, field_id, 1);
+
+    if (algorithm_id == ALGORITHM_MERGEBININSSORT)
+        param = (void *)resolve_mergebininssort_threshold(field_id, sizeof(Record), (size_t)param);
+
+    if (num_records > 0)
+        sort_records_array(records, num_records, algorithm_id, (size_t)param);
+}
+
+/**
+ * The (key, index) pairs sorted by `sort_record_table`. The key comes first, so that the field comparators (e.g.,
+ * `int_comparator`) compare the pairs directly.
+ */
+typedef struct IntegerKey
+{
+    int key;        /** The integer field. */
+    uint32_t index; /** The index of the record in the table. */
+} IntegerKey;
+
+typedef struct FloatKey
+{
+    float key;      /** The floating point field. */
+    uint32_t index; /** The index of the record in the table. */
+} FloatKey;
+
+typedef struct StringKey
+{
+    char key[STRING_FIELD_LEN]; /** The string field. */
+    uint32_t index;             /** The index of the record in the table. */
+} StringKey;
+
+/**
+ * Gets the size of the (key, index) pairs sorted by `sort_record_table` for the specified field.
+ */
+static size_t get_table_key_size(FieldId field_id)
+{
+    switch (field_id)
+    {
+    case FIELD_STRING:
+        return sizeof(StringKey);
+    case FIELD_INTEGER:
+        return sizeof(IntegerKey);
+    case FIELD_FLOAT:
+        return sizeof(FloatKey);
+    }
+
+    PRINT_ERROR("Invalid field ID", get_table_key_size);
+}
 
 /**
- * The field id used for comparision.
+ * The number of records gathered at a time while a sorted table is written.
  */
-static int g_field_id;
+#define TABLE_GATHER_RECORDS 4096
 
-/**
- * Represents a record, made of an identifier and three fields (string, integer and floating point).
- */
-typedef struct Record
+RecordTable *create_record_table(const Record *records, size_t num_records)
+{
+    RecordTable *table;
+    size_t i;
+
+    ASSERT(records || !num_records, "'records' parameter is NULL", create_record_table);
+
+    table = malloc(sizeof(RecordTable));
+    ASSERT(table, "Unable to allocate memory for the table", create_record_table);
+
+    table->num_records = num_records;
+    table->ids = malloc(sizeof(int) * num_records + 1);
+    table->field1 = malloc(STRING_FIELD_LEN * num_records + 1);
+    table->field2 = malloc(sizeof(int) * num_records + 1);
+    table->field3 = malloc(sizeof(float) * num_records + 1);
+    ASSERT(table->ids && table->field1 && table->field2 && table->field3, "Unable to allocate memory for the table", create_record_table);
+    count_memory(MEMORY_PHASE_LOAD, (sizeof(int) * 2 + STRING_FIELD_LEN + sizeof(float)) * num_records);
+
+    for (i = 0; i < num_records; i++)
+    {
+        table->ids[i] = records[i].id;
+        memcpy(table->field1[i], records[i].field1, STRING_FIELD_LEN);
+        table->field2[i] = records[i].field2;
+        table->field3[i] = records[i].field3;
+    }
+
+    return table;
+}
+
+void destroy_record_table(RecordTable *table)
+{
+    ASSERT_NULL_PARAMETER(table, destroy_record_table);
+
+    free(table->ids);
+    free(table->field1);
+    free(table->field2);
+    free(table->field3);
+    free(table);
+}
+
+void get_table_record(const RecordTable *table, size_t index, Record *record)
 {
-    int id;                        /** The identifier of the record. */
-    char field1[STRING_FIELD_LEN]; /** The string field. */
-    int field2;                    /** The integer field. */
-    float field3;                  /** The floating point field. */
-} Record;
+    record->id = table->ids[index];
+    memcpy(record->field1, table->field1[index], STRING_FIELD_LEN);
+    record->field2 = table->field2[index];
+    record->field3 = table->field3[index];
+}
 
 /**
- * Counts the number of records inside the specified file, and its maximum line length.
+ * Copies the key column of a table into a newly allocated array of (key, index) pairs.
  */
-static size_t count_records(FILE *infile, size_t *max_line_len)
+static char *make_table_keys(const RecordTable *table, FieldId field_id, size_t *size, size_t *index_offset, compare_fn *compar)
 {
-    int current;
-    size_t count, current_line_len;
-
-    *max_line_len = current_line_len = 0;
-    count = 0;
+    IntegerKey *integer_keys;
+    FloatKey *float_keys;
+    StringKey *string_keys;
+    size_t i;
 
-    while ((current = fgetc(infile)) != EOF)
+    switch (field_id)
     {
-        current_line_len++;
+    case FIELD_STRING:
+        string_keys = malloc(sizeof(StringKey) * table->num_records + 1);
+        ASSERT(string_keys, "Unable to allocate memory for the keys", make_table_keys);
+        count_memory(MEMORY_PHASE_SORT, sizeof(StringKey) * table->num_records);
+
+        for (i = 0; i < table->num_records; i++)
+        {
+            memcpy(string_keys[i].key, table->field1[i], STRING_FIELD_LEN);
+            string_keys[i].index = (uint32_t)i;
+        }
+
+        *size = sizeof(StringKey);
+        *index_offset = offsetof(StringKey, index);
+        *compar = string_comparator;
+        return (char *)string_keys;
+    case FIELD_INTEGER:
+        integer_keys = malloc(sizeof(IntegerKey) * table->num_records + 1);
+        ASSERT(integer_keys, "Unable to allocate memory for the keys", make_table_keys);
+        count_memory(MEMORY_PHASE_SORT, sizeof(IntegerKey) * table->num_records);
 
-        if (current == '\n')
+        for (i = 0; i < table->num_records; i++)
         {
-            if (current_line_len > *max_line_len)
-                *max_line_len = current_line_len;
+            integer_keys[i].key = table->field2[i];
+            integer_keys[i].index = (uint32_t)i;
+        }
+
+        *size = sizeof(IntegerKey);
+        *index_offset = offsetof(IntegerKey, index);
+        *compar = int_comparator;
+        return (char *)integer_keys;
+    case FIELD_FLOAT:
+        float_keys = malloc(sizeof(FloatKey) * table->num_records + 1);
+        ASSERT(float_keys, "Unable to allocate memory for the keys", make_table_keys);
+        count_memory(MEMORY_PHASE_SORT, sizeof(FloatKey) * table->num_records);
 
-            current_line_len = 0;
-            count++;
+        for (i = 0; i < table->num_records; i++)
+        {
+            float_keys[i].key = table->field3[i];
+            float_keys[i].index = (uint32_t)i;
         }
+
+        *size = sizeof(FloatKey);
+        *index_offset = offsetof(FloatKey, index);
+        *compar = float_comparator;
+        return (char *)float_keys;
+    }
+
+    PRINT_ERROR("Invalid field ID", make_table_keys);
+}
+
+size_t *sort_record_table(const RecordTable *table, FieldId field_id, AlgorithmId algorithm_id, void *param, size_t limit)
+{
+    char *keys;
+    size_t *permutation;
+    size_t size, index_offset, count, i;
+    uint32_t index;
+    compare_fn compar;
+
+    ASSERT_NULL_PARAMETER(table, sort_record_table);
+    ASSERT(algorithm_id >= ALGORITHM_MERGESORT && algorithm_id <= ALGORITHM_AUTO, "Invalid algorithm id", sort_record_table);
+    ASSERT(table->num_records <= UINT32_MAX, "Too many records for the columnar layout", sort_record_table);
+
+    keys = make_table_keys(table, field_id, &size, &index_offset, &compar);
+    count = table->num_records;
+
+    if (limit)
+    {
+        if (count > 0)
+            partial_sort(keys, count, size, limit, compar);
+
+        count = limit < count ? limit : count;
+    }
+    else
+    {
+        if (algorithm_id == ALGORITHM_AUTO)
+            algorithm_id = select_array_algorithm(keys, count, size, compar, field_id, 1);
+
+        if (algorithm_id == ALGORITHM_MERGEBININSSORT)
+            param = (void *)resolve_mergebininssort_threshold(field_id, size, (size_t)param);
+
+        if (count > 0)
+            sort_array(keys, count, size, compar, algorithm_id, (size_t)param);
     }
 
-    rewind(infile);
+    permutation = malloc(sizeof(size_t) * count + 1);
+    ASSERT(permutation, "Unable to allocate memory for the permutation", sort_record_table);
+
+    for (i = 0; i < count; i++)
+    {
+        memcpy(&index, keys + i * size + index_offset, sizeof(index));
+        permutation[i] = index;
+    }
 
-    return count;
+    free(keys);
+    return permutation;
 }
 
 /**
- * Parse the current line into a record.
+ * Writes the records of a table in the order of the specified permutation, gathering them block by block.
  */
-static void read_record(char *line, Record *record)
+static void store_table_records(FILE *out_file, const RecordTable *table, const size_t *permutation, size_t count, FieldId field_id, const SortOptions *options)
 {
-    char *field;
+    OutputSink sink;
+    Record *gathered;
+    size_t i, j;
 
-    field = strtok(line, ",");
-    record->id = atoi(field);
+    gathered = malloc(sizeof(Record) * TABLE_GATHER_RECORDS);
+    ASSERT(gathered, "Unable to allocate memory for the gathered records", store_table_records);
 
-    field = strtok(NULL, ",");
-    strcpy(record->field1, field);
+    open_output_sink(&sink, out_file, field_id, options);
+
+    for (i = 0; i < count; i += j)
+    {
+        for (j = 0; j < TABLE_GATHER_RECORDS && i + j < count; j++)
+            get_table_record(table, permutation[i + j], &gathered[j]);
 
-    field = strtok(NULL, ",");
-    record->field2 = atoi(field);
+        sink_records(&sink, gathered, j);
+    }
 
-    field = strtok(NULL, ",");
-    record->field3 = (float)atof(field);
+    close_output_sink(&sink);
+    free(gathered);
 }
 
 /**
- * Loads the records in the specified file to the specified array.
+ * Sorts the loaded records in the columnar layout (see `SortOptions.layout`), writing them to the output.
  */
-static void load_records(FILE *in_file, size_t max_line_len, Record *records, size_t num_records)
+static void sort_records_columnar(FILE *out_file, Record *records, size_t num_records, FieldId field_id, AlgorithmId algorithm_id, void *param, const SortOptions *options)
 {
-    char *line;
-    size_t i;
+    RecordTable *table;
+    size_t *permutation;
+    size_t count;
 
-    line = malloc(sizeof(char) * (max_line_len + 1));
-    ASSERT(line, "Unable to allocate space for 'line'", load_records);
+    table = create_record_table(records, num_records);
+    free_large(records);
 
-    i = 0;
+    if (options->limit)
+        printf("Sorting the first %zu records (columnar layout)...\n", options->limit);
+    else
+        printf("Sorting records (columnar layout)...\n");
 
-    while (i < num_records)
-    {
-        ASSERT(fgets(line, (int)(max_line_len + 1), in_file), "Unable to read line from input file", load_records);
-        read_record(line, &records[i++]);
-    }
+    permutation = sort_record_table(table, field_id, algorithm_id, param, options->limit);
+    count = options->limit && options->limit < num_records ? options->limit : num_records;
 
-    free(line);
+    printf("Saving records...\n");
+    store_table_records(out_file, table, permutation, count, field_id, options);
+
+    free(permutation);
+    destroy_record_table(table);
 }
 
 /**
- * Stores the records in the specified file from the specified records array.
+ * The sort jobs of a batch, sharing the loaded records.
  */
-static void store_records(FILE *out_file, Record *records, size_t num_records)
+typedef struct BatchJobs
 {
-    size_t i;
+    const SortJob *jobs;                   /** The jobs. */
+    AlgorithmId algorithms[MAX_SORT_JOBS]; /** The algorithm of each job (once AUTO has been resolved). */
+    size_t params[MAX_SORT_JOBS];          /** The threshold of each job (once resolved). */
+    const Record *records;                 /** The loaded records (NULL in the columnar layout). */
+    const RecordTable *table;              /** The loaded records in the columnar layout (NULL otherwise). */
+    size_t num_records;                    /** The number of loaded records. */
+    const SortOptions *options;            /** The options shared by the jobs. */
+} BatchJobs;
 
-    i = 0;
+/**
+ * Runs a sort job of a batch: sorts a copy (or a permutation, in the columnar layout) of the shared records and
+ * writes it to the job output.
+ */
+static void run_sort_job(void *context, size_t index)
+{
+    BatchJobs *batch = (BatchJobs *)context;
+    const SortJob *job;
+    SortOptions options;
+    Record *records;
+    size_t *permutation;
+    size_t count;
+    compare_fn compar;
 
-    for (i = 0; i < num_records; i++)
+    job = &batch->jobs[index];
+    options = *batch->options;
+    options.index_path = job->index_path;
+
+    count = options.limit && options.limit < batch->num_records ? options.limit : batch->num_records;
+
+    // Every job compares by its own field, so none of them relies on `g_field_id`.
+    if (batch->table)
     {
-        fprintf(out_file, "%d,%s,%d,%f\n",
-                records[i].id,
-                records[i].field1,
-                records[i].field2,
-                records[i].field3);
+        permutation = sort_record_table(batch->table, job->field_id, batch->algorithms[index], (void *)batch->params[index], options.limit);
+        store_table_records(job->out_file, batch->table, permutation, count, job->field_id, &options);
+        free(permutation);
+        return;
     }
+
+    records = allocate_large(sizeof(Record) * batch->num_records);
+    ASSERT(records, "Unable to allocate space for 'records'", run_sort_job);
+    count_memory(MEMORY_PHASE_LOAD, sizeof(Record) * batch->num_records);
+    memcpy(records, batch->records, sizeof(Record) * batch->num_records);
+
+    compar = get_records_comparator(job->field_id);
+
+    if (options.limit && batch->num_records > 0)
+        partial_sort(records, batch->num_records, sizeof(Record), options.limit, compar);
+    else if (batch->num_records > 0)
+        sort_array(records, batch->num_records, sizeof(Record), compar, batch->algorithms[index], batch->params[index]);
+
+    store_records(job->out_file, records, count, job->field_id, &options);
+    free_large(records);
 }
 
-/**
- * The record comparision function.
- */
-static int compare_records_fn(const void *record_a, const void *record_b)
+void sort_records_batch(FILE *in_file, const SortJob *jobs, size_t num_jobs, const SortOptions *options)
 {
-    const Record *a = (const Record *)record_a;
-    const Record *b = (const Record *)record_b;
+    BatchJobs batch;
+    Record *records;
+    RecordTable *table;
+    size_t i;
 
-    switch (g_field_id)
+    ASSERT_NULL_PARAMETER(in_file, sort_records_batch);
+    ASSERT_NULL_PARAMETER(jobs, sort_records_batch);
+    ASSERT_NULL_PARAMETER(options, sort_records_batch);
+    ASSERT(num_jobs > 0 && num_jobs <= MAX_SORT_JOBS, "Invalid number of sort jobs", sort_records_batch);
+    ASSERT(!options->pipeline && !options->num_quantiles && !options->string_arena && !options->intern_strings && !has_string_keys(options),
+           "The pipelined mode, the quantile report and the string arena are not available in batch mode", sort_records_batch);
+    ASSERT(!options->max_memory, "The memory budget is not available in batch mode", sort_records_batch);
+    check_aggregate_options(options);
+
+    printf("Loading records...\n");
+    records = load_input(in_file, &batch.num_records);
+
+    batch.jobs = jobs;
+    batch.options = options;
+    batch.records = records;
+    batch.table = NULL;
+
+    // Algorithms and thresholds are resolved up front, so that the jobs print nothing while they run concurrently.
+    for (i = 0; i < num_jobs; i++)
     {
-    case FIELD_STRING:
-        return string_comparator(a->field1, b->field1);
-    case FIELD_INTEGER:
-        return int_comparator(&a->field2, &b->field2);
-    case FIELD_FLOAT:
-        return float_comparator(&a->field3, &b->field3);
+        ASSERT(jobs[i].out_file, "The output file of a sort job is NULL", sort_records_batch);
+        ASSERT(jobs[i].field_id >= FIELD_STRING && jobs[i].field_id <= FIELD_FLOAT, "Invalid field id", sort_records_batch);
+        ASSERT(jobs[i].algorithm_id >= ALGORITHM_MERGESORT && jobs[i].algorithm_id <= ALGORITHM_AUTO, "Invalid algorithm id", sort_records_batch);
+        ASSERT(!options->index_every || jobs[i].index_path, "The path of the index file has not been specified", sort_records_batch);
+
+        batch.algorithms[i] = jobs[i].algorithm_id;
+        batch.params[i] = (size_t)jobs[i].param;
+
+        if (options->aggregate == AGGREGATE_UNIQUE)
+            batch.algorithms[i] = ALGORITHM_MERGESORT;
+        else if (batch.algorithms[i] == ALGORITHM_AUTO)
+            batch.algorithms[i] = select_array_algorithm(records, batch.num_records, sizeof(Record), get_records_comparator(jobs[i].field_id), jobs[i].field_id, 1);
+
+        if (batch.algorithms[i] == ALGORITHM_MERGEBININSSORT)
+            batch.params[i] = resolve_mergebininssort_threshold(jobs[i].field_id, options->layout == LAYOUT_COLUMNAR ? get_table_key_size(jobs[i].field_id) : sizeof(Record),
+                                                                batch.params[i]);
+
+        printf("Job %zu: sorting by %s with %s.\n", i + 1, get_field_name(jobs[i].field_id),
+               options->limit ? "a partial sort" : get_algorithm_name(batch.algorithms[i]));
     }
 
-    PRINT_ERROR("Invalid field ID", compare_records_fn);
+    table = NULL;
+
+    if (options->layout == LAYOUT_COLUMNAR)
+    {
+        table = create_record_table(records, batch.num_records);
+        free_large(records);
+        batch.records = records = NULL;
+        batch.table = table;
+    }
+
+    printf("Sorting and saving records (%zu jobs)...\n", num_jobs);
+    parallel_for(num_jobs, run_sort_job, &batch);
+
+    free_large(records);
+
+    if (table)
+        destroy_record_table(table);
+
+    printf("Done\n");
+}
+
+void init_sort_options(SortOptions *options)
+{
+    ASSERT_NULL_PARAMETER(options, init_sort_options);
+
+    memset(options, 0, sizeof(*options));
 }
 
 void sort_records(FILE *in_file, FILE *out_file, FieldId field_id, AlgorithmId algorithm_id, void *param)
 {
-    size_t max_line_len;
+    SortOptions options;
+
+    init_sort_options(&options);
+    sort_records_with_options(in_file, out_file, field_id, algorithm_id, param, &options);
+}
+
+void sort_records_with_options(FILE *in_file, FILE *out_file, FieldId field_id, AlgorithmId algorithm_id, void *param, const SortOptions *options)
+{
     size_t num_records;
     Record *records;
 
-    ASSERT_NULL_PARAMETER(in_file, sort_records);
-    ASSERT_NULL_PARAMETER(out_file, sort_records);
-    ASSERT(field_id >= FIELD_STRING && field_id <= FIELD_FLOAT, "Invalid field id", sort_records);
-    ASSERT(algorithm_id >= ALGORITHM_MERGESORT && algorithm_id <= ALGORITHM_MERGEBININSSORT, "Invalid algorithm id", sort_records);
+    ASSERT_NULL_PARAMETER(in_file, sort_records_with_options);
+    ASSERT_NULL_PARAMETER(out_file, sort_records_with_options);
+    ASSERT_NULL_PARAMETER(options, sort_records_with_options);
+    ASSERT(field_id >= FIELD_STRING && field_id <= FIELD_FLOAT, "Invalid field id", sort_records_with_options);
+    ASSERT(algorithm_id >= ALGORITHM_MERGESORT && algorithm_id <= ALGORITHM_AUTO, "Invalid algorithm id", sort_records_with_options);
+
+    g_field_id = field_id;
+    check_aggregate_options(options);
+
+    // The first record of each key is only the first one of the input if records with equal keys keep their order
+    // (binary insertion sort, also used by merge binary insertion sort, may insert an element before an equal one).
+    if (options->aggregate == AGGREGATE_UNIQUE && algorithm_id != ALGORITHM_MERGESORT)
+    {
+        printf("Using %s, since keeping the first record of each key requires a stable sort.\n", get_algorithm_name(ALGORITHM_MERGESORT));
+        algorithm_id = ALGORITHM_MERGESORT;
+    }
+
+    if (options->num_quantiles)
+    {
+        ASSERT(!options->index_every, "The quantile report cannot be indexed", sort_records_with_options);
+        ASSERT(!has_string_keys(options), "The string keys are not available with the quantile report", sort_records_with_options);
+        ASSERT(!options->max_memory, "The memory budget is not available with the quantile report", sort_records_with_options);
+
+        printf("Loading records...\n");
+        records = load_input(in_file, &num_records);
+
+        printf("Selecting %zu quantiles...\n", options->num_quantiles);
+        report_quantiles(out_file, records, num_records, field_id, options->quantiles, options->num_quantiles);
+
+        free_large(records);
+        printf("Done\n");
+        return;
+    }
+
+    if (options->string_arena || options->intern_strings || has_string_keys(options))
+    {
+        ASSERT(!options->pipeline, "The pipelined mode is not available with the string arena", sort_records_with_options);
+        ASSERT(options->layout == LAYOUT_ROWS, "The columnar layout is not available with the string arena", sort_records_with_options);
+        ASSERT(!options->max_memory, "The memory budget is not available with the string arena", sort_records_with_options);
+        sort_records_in_arena(in_file, out_file, field_id, algorithm_id, param, options);
+        return;
+    }
+
+    if (options->pipeline)
+    {
+        ASSERT(options->layout == LAYOUT_ROWS, "The columnar layout is not available in pipelined mode", sort_records_with_options);
+        ASSERT(!options->max_memory, "The memory budget is not available in pipelined mode", sort_records_with_options);
+
+        if (!options->limit && (algorithm_id == ALGORITHM_MERGEBININSSORT || algorithm_id == ALGORITHM_AUTO))
+            param = (void *)resolve_mergebininssort_threshold(field_id, sizeof(Record), (size_t)param);
+
+        sort_records_pipelined(in_file, out_file, field_id, algorithm_id, (size_t)param,
+                               options->chunk_records ? options->chunk_records : DEFAULT_PIPELINE_CHUNK_RECORDS, options);
+        printf("Done\n");
+        return;
+    }
+
+    if (options->max_memory)
+    {
+        ASSERT(options->layout == LAYOUT_ROWS, "The columnar layout is not available with a memory budget", sort_records_with_options);
 
-    printf("Analyzing input file...\n");
-    num_records = count_records(in_file, &max_line_len);
+        if (!options->limit && (algorithm_id == ALGORITHM_MERGEBININSSORT || algorithm_id == ALGORITHM_AUTO))
+            param = (void *)resolve_mergebininssort_threshold(field_id, sizeof(Record), (size_t)param);
 
-    records = calloc(num_records, sizeof(Record));
-    ASSERT(records, "Unable to allocate space for 'records'", sort_records);
+        sort_records_external(in_file, out_file, field_id, algorithm_id, (size_t)param, options);
+        printf("Done\n");
+        return;
+    }
 
     printf("Loading records...\n");
-    load_records(in_file, max_line_len, records, num_records);
+    records = load_input(in_file, &num_records);
 
-    g_field_id = field_id;
+    if (options->layout == LAYOUT_COLUMNAR)
+    {
+        sort_records_columnar(out_file, records, num_records, field_id, algorithm_id, param, options);
+        printf("Done\n");
+        return;
+    }
 
-    printf("Sorting records...\n");
-    switch (algorithm_id)
+    if (options->limit)
     {
-    case ALGORITHM_MERGESORT:
-        merge_sort(records, num_records, sizeof(Record), compare_records_fn);
-        break;
-    case ALGORITHM_QUICKSORT:
-        quick_sort(records, num_records, sizeof(Record), compare_records_fn);
-        break;
-    case ALGORITHM_BININSSORT:
-        binary_insertion_sort(records, num_records, sizeof(Record), compare_records_fn);
-        break;
-    case ALGORITHM_MERGEBININSSORT:
-        merge_binary_insertion_sort(records, num_records, sizeof(Record), (size_t)param, compare_records_fn);
-        break;
-    default:
-        PRINT_ERROR("Invalid sorting algorithm id", sort_records);
-        break;
+        printf("Sorting the first %zu records...\n", options->limit);
+
+        if (num_records > 0)
+            partial_sort(records, num_records, sizeof(Record), options->limit, compare_records_fn);
+
+        printf("Saving records...\n");
+        store_records(out_file, records, options->limit < num_records ? options->limit : num_records, field_id, options);
+
+        free_large(records);
+        printf("Done\n");
+        return;
     }
 
+    printf("Sorting records...\n");
+    sort_loaded_records(records, num_records, field_id, algorithm_id, param);
+
     printf("Saving records...\n");
-    store_records(out_file, records, num_records);
+    store_records(out_file, records, num_records, field_id, options);
 
-    free(records);
+    free_large(records);
     printf("Done\n");
 }
 
 #ifdef _PROFILER
 
+#include "perf-counters.h"
 #include <time.h>
 
 /**
@@ -214,23 +1950,31 @@ void sort_records(FILE *in_file, FILE *out_file, FieldId field_id, AlgorithmId a
  */
 static Record *unsorted_records = NULL;
 
+/**
+ * The columnar copy of the unsorted records (built when the columnar layout is first profiled).
+ */
+static RecordTable *unsorted_table = NULL;
+
+/**
+ * The number of unsorted records.
+ */
+static size_t unsorted_num_records = 0;
+
+/**
+ * The layout of the records sorted by `profile__records_sorter`.
+ */
+static RecordLayout profiled_layout = LAYOUT_ROWS;
+
 void init_profiler__records_sorter(FILE *in_file, size_t *num_records)
 {
-    size_t max_line_len;
-
     ASSERT_NULL_PARAMETER(in_file, init_profiler__records_sorter);
     ASSERT(!unsorted_records, "Profiler has been already initialized", init_profiler__records_sorter);
 
     PROFILER_PRINT("Initializing profiler...");
 
-    *num_records = count_records(in_file, &max_line_len);
-
-    PROFILER_PRINT("Allocating unsorted records...");
-    unsorted_records = (Record *)malloc(sizeof(Record) * *num_records);
-    ASSERT(unsorted_records, "Unable to allocate memory for the unsorted records array", init_profiler__records_sorter);
-
     PROFILER_PRINT("Loading records...");
-    load_records(in_file, max_line_len, unsorted_records, *num_records);
+    unsorted_records = load_input(in_file, num_records);
+    unsorted_num_records = *num_records;
 
     PROFILER_PRINT("Profiler initialized.");
 }
@@ -242,107 +1986,194 @@ void shutdown_profiler__records_sorter(void)
     PROFILER_PRINT("Shutting down profiler...");
 
     PROFILER_PRINT("Deallocating unsorted records...");
-    free((void *)unsorted_records);
+    free_large(unsorted_records);
+    unsorted_records = NULL;
+
+    if (unsorted_table)
+    {
+        destroy_record_table(unsorted_table);
+        unsorted_table = NULL;
+    }
 
     PROFILER_PRINT("Profiler shut down.");
 }
 
 /**
- * Retrieves the name of the field corresponding to the specified FieldId.
+ * Prints the values of the hardware performance counters measured while sorting.
  *
- * @param field_id The ID of the field.
- * @return A string representing the name of the field.
+ * @param perf_values The values of the counters.
+ * @param num_records The number of sorted records, used to normalize the values.
  */
-static const char *get_field_name(FieldId field_id)
+static void print_perf_counters(const PerfCounterValues *perf_values, size_t num_records)
 {
-    switch (field_id)
+    int i;
+
+    printf("[PROFILER]<perf>:");
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++)
     {
-    case FIELD_STRING:
-        return "STRING";
-    case FIELD_INTEGER:
-        return "INTEGER";
-    case FIELD_FLOAT:
-        return "FLOAT";
+        if (perf_values->available[i])
+            printf(" %s=%llu (%.2f/record)", perf_counter_name((PerfCounterId)i), perf_values->values[i],
+                   num_records ? (double)perf_values->values[i] / (double)num_records : 0.0);
+        else
+            printf(" %s=n/a", perf_counter_name((PerfCounterId)i));
     }
 
-    PRINT_ERROR("Invalid field ID", get_field_name);
+    if (perf_values->available[PERF_COUNTER_CYCLES] && perf_values->available[PERF_COUNTER_INSTRUCTIONS] &&
+        perf_values->values[PERF_COUNTER_CYCLES] > 0)
+        printf(" IPC=%.2f", (double)perf_values->values[PERF_COUNTER_INSTRUCTIONS] / (double)perf_values->values[PERF_COUNTER_CYCLES]);
+
+    printf("\n");
 }
 
+#ifdef _SORT_STATS
+
 /**
- * Retrieves the name of the sorting algorithm corresponding to the specified AlgorithmId.
+ * Prints the algorithmic cost (comparisons, moves and allocations) of the last sort.
  *
- * @param algorithm_id The ID of the sorting algorithm.
- * @return A string representing the name of the algorithm.
+ * @param num_records The number of sorted records, used to normalize the values.
  */
-static const char *get_algorithm_name(AlgorithmId algorithm_id)
+static void print_sort_stats(size_t num_records)
 {
-    switch (algorithm_id)
-    {
-    case ALGORITHM_MERGESORT:
-        return "MERGESORT";
-    case ALGORITHM_QUICKSORT:
-        return "QUICKSORT";
-    case ALGORITHM_BININSSORT:
-        return "BINARYINSERTIONSORT";
-    case ALGORITHM_MERGEBININSSORT:
-        return "MERGEBINARYINSERTIONSORT";
-    }
+    SortStats stats;
 
-    PRINT_ERROR("Invalid algorithm ID", get_algorithm_name);
+    get_sort_stats(&stats);
+
+    printf("[PROFILER]<stats>: comparisons=%zu (%.2f/record) moves=%zu (%.2f/record) bytes-copied=%zu allocations=%zu bytes-allocated=%zu\n",
+           stats.comparisons, num_records ? (double)stats.comparisons / (double)num_records : 0.0,
+           stats.moves, num_records ? (double)stats.moves / (double)num_records : 0.0,
+           stats.bytes_copied, stats.allocations, stats.bytes_allocated);
 }
 
+#endif
+
 void profile__records_sorter(FieldId field_id, AlgorithmId algorithm_id, size_t num_records, void *param)
 {
     Record *to_be_sorted;
+    size_t *permutation;
     clock_t start, end;
+    PerfCounterValues perf_values;
 
     ASSERT(field_id >= FIELD_STRING && field_id <= FIELD_FLOAT, "The field id is not in the valid range [1, 3]", profile__records_sorter);
     ASSERT(algorithm_id >= ALGORITHM_MERGESORT && algorithm_id <= ALGORITHM_MERGEBININSSORT, "The algorithm id is not in the valid range [1, 2]", profile__records_sorter);
 
-    to_be_sorted = (Record *)malloc(sizeof(Record) * num_records);
-    ASSERT(to_be_sorted, "Unable to allocate memory for records to be sorted", profile__records_sorter);
-
-    ASSERT(memcpy(to_be_sorted, unsorted_records, sizeof(Record) * num_records), "Unable to copy the unsorted records array", profile__records_sorter);
+    to_be_sorted = NULL;
 
-    g_field_id = field_id;
+    if (profiled_layout == LAYOUT_COLUMNAR)
+    {
+        ASSERT(num_records == unsorted_num_records, "The columnar layout is profiled over every record", profile__records_sorter);
 
-    switch (algorithm_id)
+        if (!unsorted_table)
+            unsorted_table = create_record_table(unsorted_records, unsorted_num_records);
+    }
+    else
     {
-    case ALGORITHM_MERGESORT:
-        start = clock();
-        merge_sort(to_be_sorted, num_records, sizeof(Record), compare_records_fn);
-        end = clock();
-        break;
-    case ALGORITHM_QUICKSORT:
-        start = clock();
-        quick_sort(to_be_sorted, num_records, sizeof(Record), compare_records_fn);
-        end = clock();
-        break;
-    case ALGORITHM_BININSSORT:
-        start = clock();
-        binary_insertion_sort(to_be_sorted, num_records, sizeof(Record), compare_records_fn);
-        end = clock();
-        break;
-    case ALGORITHM_MERGEBININSSORT:
-        start = clock();
-        merge_binary_insertion_sort(to_be_sorted, num_records, sizeof(Record), (size_t)param, compare_records_fn);
-        end = clock();
-        break;
-    default:
-        UNREACHABLE();
-        break;
+        to_be_sorted = allocate_large(sizeof(Record) * num_records);
+        ASSERT(to_be_sorted, "Unable to allocate memory for records to be sorted", profile__records_sorter);
+
+        ASSERT(memcpy(to_be_sorted, unsorted_records, sizeof(Record) * num_records), "Unable to copy the unsorted records array", profile__records_sorter);
     }
 
+    g_field_id = field_id;
+
+    if (perf_counters_active())
+        perf_counters_start();
+
+    start = clock();
+
+    // The columnar sort includes copying the key column and reducing the sorted pairs to the permutation.
+    if (profiled_layout == LAYOUT_COLUMNAR)
+        permutation = sort_record_table(unsorted_table, field_id, algorithm_id, param, 0);
+    else
+        sort_records_array(to_be_sorted, num_records, algorithm_id, (size_t)param);
+
+    end = clock();
+
+    if (perf_counters_active())
+        perf_counters_stop(&perf_values);
+
     PROFILER_PRINT_RESULT(field_id, algorithm_id, start, end);
 
     if (algorithm_id == ALGORITHM_MERGEBININSSORT)
         printf("(Threshold used: %zu)", (size_t)param);
 
+    if (profiled_layout == LAYOUT_COLUMNAR)
+    {
+        printf("(columnar layout)");
+        free(permutation);
+    }
+
     printf(".\n");
 
-    free((void *)to_be_sorted);
+    if (perf_counters_active())
+        print_perf_counters(&perf_values, num_records);
+
+#ifdef _SORT_STATS
+    print_sort_stats(num_records);
+#endif
+
+    free_large(to_be_sorted);
+
+    g_field_id = -1;
+}
+
+double measure__records_sorter(FieldId field_id, AlgorithmId algorithm_id, size_t num_records, void *param)
+{
+    Record *to_be_sorted;
+    RecordTable *table;
+    size_t *permutation;
+    clock_t start, end;
+
+    ASSERT(field_id >= FIELD_STRING && field_id <= FIELD_FLOAT, "The field id is not in the valid range [1, 3]", measure__records_sorter);
+    ASSERT(algorithm_id >= ALGORITHM_MERGESORT && algorithm_id <= ALGORITHM_MERGEBININSSORT, "The algorithm id is not in the valid range [1, 4]", measure__records_sorter);
+
+    to_be_sorted = NULL;
+    table = NULL;
+
+    // The columnar layout sorts (key, index) pairs, so its thresholds are filed under the size of the pairs.
+    if (profiled_layout == LAYOUT_COLUMNAR)
+        table = create_record_table(unsorted_records, num_records);
+    else
+    {
+        to_be_sorted = allocate_large(sizeof(Record) * num_records);
+        ASSERT(to_be_sorted, "Unable to allocate memory for records to be sorted", measure__records_sorter);
+
+        ASSERT(memcpy(to_be_sorted, unsorted_records, sizeof(Record) * num_records), "Unable to copy the unsorted records array", measure__records_sorter);
+    }
+
+    g_field_id = field_id;
+
+    start = clock();
+
+    if (profiled_layout == LAYOUT_COLUMNAR)
+        permutation = sort_record_table(table, field_id, algorithm_id, param, 0);
+    else
+        sort_records_array(to_be_sorted, num_records, algorithm_id, (size_t)param);
+
+    end = clock();
+
+    if (profiled_layout == LAYOUT_COLUMNAR)
+    {
+        free(permutation);
+        destroy_record_table(table);
+    }
+
+    free_large(to_be_sorted);
 
     g_field_id = -1;
+
+    return (double)(end - start) / CLOCKS_PER_SEC;
+}
+
+size_t get_record_size__records_sorter(FieldId field_id)
+{
+    return profiled_layout == LAYOUT_COLUMNAR ? get_table_key_size(field_id) : sizeof(Record);
+}
+
+void set_layout__records_sorter(RecordLayout layout)
+{
+    ASSERT(layout == LAYOUT_ROWS || layout == LAYOUT_COLUMNAR, "Invalid layout", set_layout__records_sorter);
+    profiled_layout = layout;
 }
 
 #endif
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 #include <stdio.h>
+#include "comparators.h"
+#include "records.h"
+#include "sorting.h"
 
 /**
  * @brief Specifies the various field ids to be used in 'sort_records'.
@@ -16,12 +19,103 @@ typedef enum FieldId
  */
 typedef enum AlgorithmId
 {
-    ALGORITHM_MERGESORT = 1,  // The merge sort algorithm.
-    ALGORITHM_QUICKSORT,      // The quick sort algorithm.
-    ALGORITHM_BININSSORT,     // The binary insertion sort algorithm
-    ALGORITHM_MERGEBININSSORT // The merge binary insertion sort algorithm
+    ALGORITHM_MERGESORT = 1,   // The merge sort algorithm.
+    ALGORITHM_QUICKSORT,       // The quick sort algorithm.
+    ALGORITHM_BININSSORT,      // The binary insertion sort algorithm
+    ALGORITHM_MERGEBININSSORT, // The merge binary insertion sort algorithm
+    ALGORITHM_AUTO             // The algorithm is chosen by sampling the loaded records
 } AlgorithmId;
 
+/**
+ * @brief The number of records of each chunk of the pipelined mode, when not specified.
+ */
+#define DEFAULT_PIPELINE_CHUNK_RECORDS (1 << 20)
+
+/**
+ * @brief The maximum number of quantiles of a quantile report.
+ */
+#define MAX_QUANTILES 32
+
+/**
+ * @brief Specifies the in-memory layouts of the sorted records.
+ */
+typedef enum RecordLayout
+{
+    LAYOUT_ROWS = 0,  // An array of `Record` (array of structs).
+    LAYOUT_COLUMNAR   // A `RecordTable`: one array per field, sorted through a permutation (struct of arrays).
+} RecordLayout;
+
+/**
+ * @brief The maximum number of sort jobs of 'sort_records_batch'.
+ */
+#define MAX_SORT_JOBS 16
+
+/**
+ * @brief Specifies how adjacent sorted records with equal keys are collapsed in the output.
+ */
+typedef enum AggregateMode
+{
+    AGGREGATE_NONE = 0, // Every record is written.
+    AGGREGATE_UNIQUE,   // Only the first record of each key is written.
+    AGGREGATE_COUNT,    // A `key,count` line is written for each key.
+    AGGREGATE_SUM       // A `key,count,sum` line is written for each key, summing a numeric field.
+} AggregateMode;
+
+/**
+ * @brief Records stored by column (struct of arrays), so that sorting by a field only reads that field.
+ */
+typedef struct RecordTable
+{
+    int *ids;                         /** The identifiers of the records. */
+    char (*field1)[STRING_FIELD_LEN]; /** The string fields. */
+    int *field2;                      /** The integer fields. */
+    float *field3;                    /** The floating point fields. */
+    size_t num_records;               /** The number of records. */
+} RecordTable;
+
+/**
+ * @brief The options of 'sort_records_with_options'.
+ */
+typedef struct SortOptions
+{
+    int pipeline;         /** Whether chunks are sorted while the next ones are loaded, then merged into the output. */
+    size_t chunk_records; /** The number of records of each pipelined chunk (0 means DEFAULT_PIPELINE_CHUNK_RECORDS). */
+    size_t limit;         /** The number of smallest records to be written (0 writes every record). */
+    double quantiles[MAX_QUANTILES]; /** The percentiles of the quantile report, in range (0, 100]. */
+    size_t num_quantiles;            /** The number of quantiles (0 sorts the records instead of reporting). */
+    size_t index_every;              /** The number of records between two entries of the sparse index (0 builds no index). */
+    const char *index_path;          /** The path of the sparse index file (see `query_sorted_file`). */
+    int verify;                      /** Whether the order of the inputs of 'merge_records_files' is verified. */
+    int string_arena;                /** Whether string fields are stored in an arena, without length limit. */
+    int intern_strings;              /** Whether equal string fields are stored once in the arena (implies `string_arena`). */
+    int collate;                     /** Whether string fields are ordered by the collation of the current locale (implies `string_arena`). */
+    int fold_case;                   /** Whether string fields are ordered ignoring the case of ASCII letters (implies `string_arena`). */
+    int natural_order;               /** Whether digit runs of string fields are ordered by their value (implies `string_arena`). */
+    RecordLayout layout;             /** The in-memory layout of the sorted records. */
+    AggregateMode aggregate;         /** How adjacent records with equal keys are collapsed in the output. */
+    FieldId sum_field_id;            /** The field summed by AGGREGATE_SUM (either FIELD_INTEGER or FIELD_FLOAT). */
+    size_t max_memory;               /** The memory budget, in bytes, of the external mode (0 loads the whole input). */
+} SortOptions;
+
+/**
+ * @brief A sort job of 'sort_records_batch': one order of the shared records, written to its own output file.
+ */
+typedef struct SortJob
+{
+    FieldId field_id;         /** The field by which the records are sorted. */
+    AlgorithmId algorithm_id; /** The sorting algorithm. */
+    void *param;              /** Additional parameter (i.e., the threshold of merge binary insertion sort). */
+    FILE *out_file;           /** The output file. */
+    const char *index_path;   /** The path of the sparse index of the output (only used with `SortOptions.index_every`). */
+} SortJob;
+
+/**
+ * @brief Initializes the specified options to their defaults (i.e., the behaviour of 'sort_records').
+ *
+ * @param options The options to be initialized.
+ */
+void init_sort_options(SortOptions *options);
+
 /**
  * @brief Function sorts records in the provided file given.
  *
@@ -30,9 +124,206 @@ typedef enum AlgorithmId
  * @param field_id Define the field by which the infile should be sorted.
  * @param algorithm_id Define the algorithm used to sort the input file.
  * @param param Additional parameter to pass (i.e., the threshold of merge binary insertion sort).
+ *
+ * @remark If the threshold of merge binary insertion sort is zero, it is read from the tuning configuration file
+ * (see `get_tuning_config_path`), falling back to `DEFAULT_MERGEBININSSORT_THRESHOLD`.
+ * @remark With `ALGORITHM_AUTO`, the algorithm is chosen after loading the records, by estimating the presortedness
+ * and the duplicates ratio of a sample, and considering the number of records and the type of the field; the choice
+ * and its reasons are printed.
  */
 void sort_records(FILE *in_file, FILE *out_file, FieldId field_id, AlgorithmId algorithm_id, void *param);
 
+/**
+ * @brief Sorts records in the provided file given, as 'sort_records' does, with the specified options.
+ *
+ * @param in_file Define the input file.
+ * @param out_file Define the output file.
+ * @param field_id Define the field by which the infile should be sorted.
+ * @param algorithm_id Define the algorithm used to sort the input file.
+ * @param param Additional parameter to pass (i.e., the threshold of merge binary insertion sort).
+ * @param options The sorting options.
+ *
+ * @remark In pipelined mode, fixed-size chunks of records are sorted on worker threads while the next chunks are
+ * loaded; the sorted chunks are then k-way merged straight into the output, which is formatted on worker threads
+ * and written by a dedicated thread. With `ALGORITHM_AUTO`, the algorithm is chosen for each chunk.
+ * @remark With a limit K, only the K smallest records are sorted (see `partial_sort`, the algorithm is ignored) and
+ * written; in pipelined mode, each chunk is shrunk to its K smallest records as soon as it is loaded, so memory
+ * does not grow with the input beyond K records per chunk. Records with equal keys may be reordered.
+ * @remark With quantiles, the records at the nearest ranks of the requested percentiles are selected (see
+ * `select_quantiles`, the algorithm and the pipelined mode are ignored): their keys are printed, and the records are
+ * written to the output file in the order of the requested quantiles.
+ * @remark With an index, the key and the byte offset of one sorted record every N are saved to the index file while
+ * the output is written (see `query_sorted_file`); the output file shall be opened in binary mode.
+ * @remark With the string arena, records hold the offset and length of their string field in a contiguous arena
+ * (see `ArenaRecord`), so string fields of CSV inputs are not truncated to `STRING_FIELD_LEN - 1` characters and the
+ * sorted elements are smaller; with interning, equal strings are stored once and compare equal without reading
+ * them. The pipelined mode and the index are not available, and CSV inputs are parsed by a single thread.
+ * @remark With the collation, sorting by the string field follows the `LC_COLLATE` category of the current locale
+ * (see `setlocale`), as `strcoll` would: each string is stored in the arena after its `strxfrm` sort key, computed once
+ * while the records are loaded, and the sort compares the keys with `memcmp`. Records with equal keys are ordered by
+ * their strings. The string arena is used, with its limits; the quantile report is not available.
+ * @remark With case folding or the natural order, the sort key of each string is normalized instead (or before the
+ * collation, for case folding): ASCII letters are folded to lower case, and runs of digits are encoded as
+ * length-prefixed numbers, so that `item2` precedes `item10` and leading zeros are ignored. Every algorithm sorts the
+ * normalized keys with the same `memcmp` comparator. The natural order cannot be combined with the collation.
+ * @remark With the columnar layout, the loaded records are split into a `RecordTable` and sorted with
+ * `sort_record_table`; the other columns are only gathered, in sorted order, while the output is written.
+ * @remark With an aggregation, adjacent records with equal keys are collapsed while the sorted records are written
+ * (or merged, in pipelined mode), without a separate pass: either the first record of each key is kept (any other
+ * algorithm is replaced by merge sort, which is stable, so that it is the first one of the input), or a line with
+ * the key, the number of records and possibly the sum of a field is written for each key. The limit, the quantile
+ * report and the string arena are not available; counts and sums cannot be indexed.
+ * @remark With a memory budget, the records are sorted in external mode: the input is read in runs as large as the
+ * budget allows (half as large for merge sort and merge binary insertion sort, whose merge buffer is as large as the
+ * records; an algorithm chosen by `ALGORITHM_AUTO` is replaced by quick sort if its merge buffer does not fit), the
+ * runs are spilled to temporary files and k-way merged into the output, in several passes if the buffers of the runs
+ * do not fit the budget at once. An input fitting a single run is sorted in memory. The pipelined mode, the quantile
+ * report, the string arena and the columnar layout are not available.
+ */
+void sort_records_with_options(FILE *in_file, FILE *out_file, FieldId field_id, AlgorithmId algorithm_id, void *param, const SortOptions *options);
+
+/**
+ * @brief Sorts the records of the provided file in several orders, loading the file only once.
+ *
+ * @param in_file  Define the input file.
+ * @param jobs     The sort jobs (at most `MAX_SORT_JOBS`), each one with its own field, algorithm and output file.
+ * @param num_jobs The number of jobs.
+ * @param options  The options shared by the jobs (the pipelined mode, the quantile report and the string arena are
+ *                 not available; `index_path` is replaced by the one of each job).
+ *
+ * @remark The jobs run concurrently, each one on its own thread: every job sorts a private copy of the loaded
+ * records (or, in the columnar layout, a permutation of the shared `RecordTable`, which needs much less memory) and
+ * writes its output while the other jobs are still sorting.
+ */
+void sort_records_batch(FILE *in_file, const SortJob *jobs, size_t num_jobs, const SortOptions *options);
+
+/**
+ * @brief Merges files of records (either CSV or binary) already sorted by the same field into the output file, in a
+ * single streaming pass.
+ *
+ * @param in_paths  The paths of the sorted input files.
+ * @param num_files The number of input files.
+ * @param out_file  The output file.
+ * @param field_id  The field by which the inputs are sorted.
+ * @param options   The options (the limit, the index, the aggregation and the verification are honored).
+ *
+ * @remark The inputs are k-way merged by a loser tree (see `create_merger`) in O(N log K) time, reading each one
+ * through a large buffer, so memory does not grow with the inputs. Records with equal keys are written in the order
+ * of the inputs. With verification, the merge aborts on the first record of an input preceding the previous one;
+ * otherwise unsorted inputs produce an unsorted output.
+ */
+void merge_records_files(const char *const *in_paths, size_t num_files, FILE *out_file, FieldId field_id, const SortOptions *options);
+
+/**
+ * @brief Loads the records of the specified file (either CSV or binary) into a newly allocated array.
+ *
+ * @param in_file     The input file.
+ * @param num_records Pointer to the variable receiving the number of records.
+ * @return The loaded records, to be released with `free_large` (see `allocate_large`).
+ */
+Record *load_records_file(FILE *in_file, size_t *num_records);
+
+/**
+ * @brief Sorts the specified records, as 'sort_records' does once they are loaded.
+ *
+ * @param records      The records to be sorted.
+ * @param num_records  The number of records.
+ * @param field_id     The field by which records are sorted.
+ * @param algorithm_id The sorting algorithm.
+ * @param param        Additional parameter to pass (i.e., the threshold of merge binary insertion sort).
+ */
+void sort_loaded_records(Record *records, size_t num_records, FieldId field_id, AlgorithmId algorithm_id, void *param);
+
+/**
+ * @brief Creates a columnar table holding a copy of the specified records.
+ *
+ * @param records     The records.
+ * @param num_records The number of records.
+ * @return The created table.
+ */
+RecordTable *create_record_table(const Record *records, size_t num_records);
+
+/**
+ * @brief Destroys the specified table.
+ *
+ * @param table The table to be destroyed.
+ */
+void destroy_record_table(RecordTable *table);
+
+/**
+ * @brief Gathers the fields of a record of the specified table.
+ *
+ * @param table  The table.
+ * @param index  The index of the record.
+ * @param record The gathered record.
+ */
+void get_table_record(const RecordTable *table, size_t index, Record *record);
+
+/**
+ * @brief Sorts the records of the specified table by a field, without moving them.
+ *
+ * @remark Only the key column is read: it is copied into (key, index) pairs, which are sorted and then reduced to
+ * the permutation, so that the elements moved by the sort are 8 bytes for numeric fields (instead of a 44 bytes
+ * `Record`). With a stable algorithm, records with equal keys keep their order.
+ *
+ * @param table        The table.
+ * @param field_id     The field by which records are sorted.
+ * @param algorithm_id The sorting algorithm (`ALGORITHM_AUTO` samples the pairs).
+ * @param param        Additional parameter to pass (i.e., the threshold of merge binary insertion sort).
+ * @param limit        The number of smallest records to be sorted (0 sorts every record; see `partial_sort`).
+ * @return The permutation of the table (the index of the i-th sorted record, for each i lower than the number of
+ * records, or the limit), to be released with `free`.
+ */
+size_t *sort_record_table(const RecordTable *table, FieldId field_id, AlgorithmId algorithm_id, void *param, size_t limit);
+
+/**
+ * @brief Retrieves the comparison function of records by the specified field.
+ *
+ * @param field_id The field by which records are compared.
+ * @return The comparison function of two `Record` pointers.
+ */
+compare_fn get_records_comparator(FieldId field_id);
+
+/**
+ * @brief Chooses the algorithm by which `ALGORITHM_AUTO` sorts the specified records, without printing the choice.
+ *
+ * @remark Binary insertion sort is only chosen for inputs which are entirely sorted: the sample is confirmed by a
+ * linear scan, since a few displaced records (which the sample may miss) would make it quadratic.
+ *
+ * @param records     The records.
+ * @param num_records The number of records.
+ * @param field_id    The field by which records are sorted.
+ * @return The chosen algorithm (never `ALGORITHM_AUTO`).
+ */
+AlgorithmId select_records_algorithm(const Record *records, size_t num_records, FieldId field_id);
+
+/**
+ * @brief Retrieves the name of the field corresponding to the specified FieldId.
+ *
+ * @param field_id The ID of the field.
+ * @return A string representing the name of the field.
+ */
+const char *get_field_name(FieldId field_id);
+
+/**
+ * @brief Retrieves the name of the sorting algorithm corresponding to the specified AlgorithmId.
+ *
+ * @param algorithm_id The ID of the sorting algorithm.
+ * @return A string representing the name of the algorithm.
+ */
+const char *get_algorithm_name(AlgorithmId algorithm_id);
+
+/**
+ * @brief Resolves the threshold of merge binary insertion sort for the specified field.
+ *
+ * @param field_id  The field by which records are sorted.
+ * @param size      The size of the sorted elements (records, arena records or key pairs), in bytes.
+ * @param threshold The requested threshold (zero to use the tuned one).
+ * @return The requested threshold if non-zero, otherwise the tuned threshold of the field and element size if
+ *         present in the tuning configuration file, otherwise `DEFAULT_MERGEBININSSORT_THRESHOLD`.
+ */
+size_t resolve_mergebininssort_threshold(FieldId field_id, size_t size, size_t threshold);
+
 #ifdef _PROFILER
 
 /**
@@ -54,4 +345,28 @@ void shutdown_profiler__records_sorter(void);
  */
 void profile__records_sorter(FieldId field_id, AlgorithmId algorithm_id, size_t num_records, void* param);
 
+/**
+ * @brief Measures the execution of the sorting algorithm over the unsorted array, without printing anything.
+ * @remark With the columnar layout (see `set_layout__records_sorter`), a table of the records is sorted with
+ * `sort_record_table`, as by `profile__records_sorter`.
+ * @param field_id The type of fields to be sorted.
+ * @param algorithm_id The algorithm to be used.
+ * @param num_records The number of records to be sorted (the first ones of the unsorted array).
+ * @param param Additional parameter to pass (i.e., the threshold of merge binary insertion sort).
+ * @return The sorting time, in seconds.
+ */
+double measure__records_sorter(FieldId field_id, AlgorithmId algorithm_id, size_t num_records, void *param);
+
+/**
+ * @brief Retrieves the size of the elements sorted by the profiler (records, or key pairs in the columnar layout), in bytes.
+ * @param field_id The field by which records are sorted.
+ */
+size_t get_record_size__records_sorter(FieldId field_id);
+
+/**
+ * @brief Sets the layout of the records sorted by `profile__records_sorter` (rows by default).
+ * @param layout The layout of the records.
+ */
+void set_layout__records_sorter(RecordLayout layout);
+
 #endif
\ No newline at end of file
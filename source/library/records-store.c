@@ -0,0 +1,390 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "records-store.h"
+#include "compressed-io.h"
+#include "diagnostics.h"
+#include "large-alloc.h"
+#include "merger.h"
+#include "records-io.h"
+#include "records-reader.h"
+#include "records-writer.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#define make_directory(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define make_directory(path) mkdir((path), 0777)
+#endif
+
+/**
+ * The maximum length of the paths of the files inside a store.
+ */
+#define STORE_MAX_PATH 4096
+
+/**
+ * The maximum number of runs of a store.
+ */
+#define STORE_MAX_RUNS 1024
+
+/**
+ * A sorted run of a store.
+ */
+typedef struct StoreRun
+{
+    size_t id;          /** The identifier of the run, which names its file. */
+    size_t num_records; /** The number of records of the run. */
+} StoreRun;
+
+/**
+ * The manifest of a store: its sort field and its runs, from the oldest to the newest.
+ */
+typedef struct StoreManifest
+{
+    FieldId field_id;              /** The field by which the runs are sorted (0 if the store is empty). */
+    size_t next_run_id;            /** The identifier of the next run. */
+    StoreRun runs[STORE_MAX_RUNS]; /** The runs, from the oldest to the newest. */
+    size_t num_runs;               /** The number of runs. */
+} StoreManifest;
+
+/**
+ * Builds the path of a file inside the store directory.
+ */
+static void build_store_path(char *path, const char *store_path, const char *name)
+{
+    ASSERT(snprintf(path, STORE_MAX_PATH, "%s/%s", store_path, name) < STORE_MAX_PATH, "The store path is too long", build_store_path);
+}
+
+/**
+ * Builds the path of the file of a run.
+ */
+static void build_run_path(char *path, const char *store_path, size_t run_id)
+{
+    char name[32];
+
+    sprintf(name, "run-%08zu.bin", run_id);
+    build_store_path(path, store_path, name);
+}
+
+/**
+ * Reads the manifest of a store (an empty manifest if the store does not exist yet).
+ */
+static void read_manifest(const char *store_path, StoreManifest *manifest)
+{
+    char path[STORE_MAX_PATH], line[256], field_name[32];
+    FILE *file;
+    StoreRun run;
+    int field;
+
+    memset(manifest, 0, sizeof(*manifest));
+    build_store_path(path, store_path, STORE_MANIFEST_NAME);
+
+    file = fopen(path, "r");
+
+    if (!file)
+        return;
+
+    while (fgets(line, sizeof(line), file))
+    {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        if (sscanf(line, "field=%31s", field_name) == 1)
+        {
+            for (field = FIELD_STRING; field <= FIELD_FLOAT && strcmp(get_field_name((FieldId)field), field_name); field++)
+                ;
+
+            ASSERT(field <= FIELD_FLOAT, "Invalid field in the store manifest", read_manifest);
+            manifest->field_id = (FieldId)field;
+        }
+        else if (sscanf(line, "next_run=%zu", &manifest->next_run_id) == 1)
+            continue;
+        else if (sscanf(line, "run=%zu %zu", &run.id, &run.num_records) == 2)
+        {
+            ASSERT(manifest->num_runs < STORE_MAX_RUNS, "Too many runs in the store manifest", read_manifest);
+            manifest->runs[manifest->num_runs++] = run;
+        }
+        else
+            PRINT_ERROR("Invalid line in the store manifest", read_manifest);
+    }
+
+    ASSERT(!ferror(file), "Unable to read the store manifest", read_manifest);
+    fclose(file);
+}
+
+/**
+ * Writes the manifest of a store, replacing the previous one at once (so that a failure leaves either of them).
+ */
+static void write_manifest(const char *store_path, const StoreManifest *manifest)
+{
+    char path[STORE_MAX_PATH], temp_path[STORE_MAX_PATH];
+    FILE *file;
+    size_t i;
+
+    build_store_path(path, store_path, STORE_MANIFEST_NAME);
+    build_store_path(temp_path, store_path, STORE_MANIFEST_NAME ".tmp");
+
+    file = fopen(temp_path, "w");
+    ASSERT(file, "Unable to write the store manifest", write_manifest);
+
+    fprintf(file, "# Sorted runs, from the oldest to the newest (run=<id> <number of records>).\n");
+    fprintf(file, "field=%s\n", get_field_name(manifest->field_id));
+    fprintf(file, "next_run=%zu\n", manifest->next_run_id);
+
+    for (i = 0; i < manifest->num_runs; i++)
+        fprintf(file, "run=%zu %zu\n", manifest->runs[i].id, manifest->runs[i].num_records);
+
+    ASSERT(!fclose(file), "Unable to write the store manifest", write_manifest);
+
+#if defined(_WIN32)
+    remove(path);
+#endif
+
+    ASSERT(!rename(temp_path, path), "Unable to replace the store manifest", write_manifest);
+}
+
+/**
+ * Computes the size tier of a run (i.e., the base STORE_TIER_FANOUT logarithm of its number of records).
+ */
+static size_t get_run_tier(const StoreRun *run)
+{
+    size_t tier, records;
+
+    for (tier = 0, records = run->num_records; records >= STORE_TIER_FANOUT; tier++)
+        records /= STORE_TIER_FANOUT;
+
+    return tier;
+}
+
+/**
+ * Writes sorted records into a new run file.
+ */
+static void write_run(const char *store_path, size_t run_id, const Record *records, size_t num_records)
+{
+    char path[STORE_MAX_PATH];
+    FILE *file;
+
+    build_run_path(path, store_path, run_id);
+
+    file = fopen(path, "wb");
+    ASSERT(file, "Unable to create a run file", write_run);
+
+    write_records_file_header(file, num_records);
+    write_binary_records(file, records, num_records);
+
+    ASSERT(!fclose(file), "Unable to write a run file", write_run);
+}
+
+/**
+ * Opens the readers of the runs in range `[first, last - 1]`.
+ */
+static void open_runs(const char *store_path, const StoreManifest *manifest, size_t first, size_t last, FILE **files, RecordsReader **readers)
+{
+    char path[STORE_MAX_PATH];
+    size_t i;
+
+    for (i = first; i < last; i++)
+    {
+        build_run_path(path, store_path, manifest->runs[i].id);
+
+        files[i - first] = fopen(path, "rb");
+        ASSERT(files[i - first], "Unable to open a run file", open_runs);
+        setvbuf(files[i - first], NULL, _IOFBF, INPUT_FILE_BUFFER_SIZE);
+
+        readers[i - first] = open_records_reader(files[i - first]);
+        ASSERT(is_binary_records_reader(readers[i - first]), "A run file is not a binary records file", open_runs);
+    }
+}
+
+/**
+ * Closes the readers of some runs.
+ */
+static void close_runs(size_t num_runs, FILE **files, RecordsReader **readers)
+{
+    size_t i;
+
+    for (i = 0; i < num_runs; i++)
+    {
+        close_records_reader(readers[i]);
+        fclose(files[i]);
+    }
+}
+
+/**
+ * Merges the newest runs of a store into a single run, from the specified one on.
+ */
+static void compact_runs(const char *store_path, StoreManifest *manifest, size_t first)
+{
+    FILE *files[STORE_TIER_FANOUT], *out_file;
+    RecordsReader *readers[STORE_TIER_FANOUT];
+    char path[STORE_MAX_PATH];
+    StoreRun merged, compacted[STORE_TIER_FANOUT];
+    Merger *merger;
+    const void *record;
+    size_t num_runs, i;
+
+    num_runs = manifest->num_runs - first;
+    ASSERT(num_runs <= STORE_TIER_FANOUT, "Too many runs to be compacted", compact_runs);
+
+    merged.id = manifest->next_run_id++;
+    merged.num_records = 0;
+
+    for (i = first; i < manifest->num_runs; i++)
+        merged.num_records += manifest->runs[i].num_records;
+
+    printf("Compacting %zu runs (%zu records)...\n", num_runs, merged.num_records);
+
+    open_runs(store_path, manifest, first, manifest->num_runs, files, readers);
+
+    build_run_path(path, store_path, merged.id);
+    out_file = fopen(path, "wb");
+    ASSERT(out_file, "Unable to create a run file", compact_runs);
+    setvbuf(out_file, NULL, _IOFBF, 1 << 20);
+
+    write_records_file_header(out_file, merged.num_records);
+
+    // Runs are merged from the oldest, so that records with equal keys keep the order they were appended.
+    merger = create_merger((void **)readers, num_runs, next_record, get_records_comparator(manifest->field_id));
+
+    while ((record = merger_next(merger)))
+        write_binary_records(out_file, (const Record *)record, 1);
+
+    destroy_merger(merger);
+    ASSERT(!fclose(out_file), "Unable to write a run file", compact_runs);
+    close_runs(num_runs, files, readers);
+
+    // The merged run replaces the compacted ones in the manifest before their files are removed.
+    for (i = 0; i < num_runs; i++)
+        compacted[i] = manifest->runs[first + i];
+
+    manifest->runs[first] = merged;
+    manifest->num_runs = first + 1;
+    write_manifest(store_path, manifest);
+
+    for (i = 0; i < num_runs; i++)
+    {
+        build_run_path(path, store_path, compacted[i].id);
+        remove(path);
+    }
+}
+
+/**
+ * Compacts the newest runs of a store, as long as the newest STORE_TIER_FANOUT ones belong to the same size tier.
+ */
+static void compact_store(const char *store_path, StoreManifest *manifest)
+{
+    size_t first, tier, i;
+
+    while (manifest->num_runs >= STORE_TIER_FANOUT)
+    {
+        first = manifest->num_runs - STORE_TIER_FANOUT;
+        tier = get_run_tier(&manifest->runs[first]);
+
+        for (i = first + 1; i < manifest->num_runs && get_run_tier(&manifest->runs[i]) == tier; i++)
+            ;
+
+        if (i < manifest->num_runs)
+            return;
+
+        compact_runs(store_path, manifest, first);
+    }
+}
+
+void append_to_store(const char *store_path, FILE *in_file, FieldId field_id, AlgorithmId algorithm_id, void *param)
+{
+    StoreManifest *manifest;
+    Record *records;
+    size_t num_records;
+
+    ASSERT_NULL_PARAMETER(store_path, append_to_store);
+    ASSERT_NULL_PARAMETER(in_file, append_to_store);
+    ASSERT(field_id >= FIELD_STRING && field_id <= FIELD_FLOAT, "Invalid field id", append_to_store);
+
+    manifest = malloc(sizeof(StoreManifest));
+    ASSERT(manifest, "Unable to allocate memory for the store manifest", append_to_store);
+
+    read_manifest(store_path, manifest);
+
+    if (!manifest->field_id)
+    {
+        // The first append creates the store (the directory may already exist).
+        make_directory(store_path);
+        manifest->field_id = field_id;
+    }
+
+    ASSERT(manifest->field_id == field_id, "The store is sorted by a different field", append_to_store);
+    ASSERT(manifest->num_runs < STORE_MAX_RUNS, "Too many runs in the store", append_to_store);
+
+    printf("Loading records...\n");
+    records = load_records_file(in_file, &num_records);
+
+    if (num_records > 0)
+    {
+        printf("Sorting records...\n");
+        sort_loaded_records(records, num_records, field_id, algorithm_id, param);
+
+        printf("Appending a run of %zu records...\n", num_records);
+        manifest->runs[manifest->num_runs].id = manifest->next_run_id++;
+        manifest->runs[manifest->num_runs].num_records = num_records;
+        write_run(store_path, manifest->runs[manifest->num_runs].id, records, num_records);
+        manifest->num_runs++;
+    }
+
+    write_manifest(store_path, manifest);
+    free_large(records);
+
+    compact_store(store_path, manifest);
+    printf("The store has %zu runs.\n", manifest->num_runs);
+
+    free(manifest);
+    printf("Done\n");
+}
+
+void read_store(const char *store_path, FILE *out_file)
+{
+    StoreManifest *manifest;
+    FILE **files;
+    RecordsReader **readers;
+    RecordsWriter *writer;
+    Merger *merger;
+    const void *record;
+
+    ASSERT_NULL_PARAMETER(store_path, read_store);
+    ASSERT_NULL_PARAMETER(out_file, read_store);
+
+    manifest = malloc(sizeof(StoreManifest));
+    ASSERT(manifest, "Unable to allocate memory for the store manifest", read_store);
+
+    read_manifest(store_path, manifest);
+    ASSERT(manifest->field_id, "The store does not exist", read_store);
+
+    printf("Merging %zu runs...\n", manifest->num_runs);
+    writer = open_records_writer(out_file);
+
+    if (manifest->num_runs > 0)
+    {
+        files = malloc(sizeof(FILE *) * manifest->num_runs);
+        readers = malloc(sizeof(RecordsReader *) * manifest->num_runs);
+        ASSERT(files && readers, "Unable to allocate memory for the run readers", read_store);
+
+        open_runs(store_path, manifest, 0, manifest->num_runs, files, readers);
+        merger = create_merger((void **)readers, manifest->num_runs, next_record, get_records_comparator(manifest->field_id));
+
+        while ((record = merger_next(merger)))
+            write_records(writer, (const Record *)record, 1);
+
+        destroy_merger(merger);
+        close_runs(manifest->num_runs, files, readers);
+
+        free(files);
+        free(readers);
+    }
+
+    close_records_writer(writer);
+    free(manifest);
+    printf("Done\n");
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdio.h>
+#include "records-sorter.h"
+
+/**
+ * The name of the manifest file inside a store directory.
+ */
+#define STORE_MANIFEST_NAME "MANIFEST"
+
+/**
+ * The number of runs of the same size tier which are compacted into a single run.
+ */
+#define STORE_TIER_FANOUT 4
+
+/**
+ * @brief Appends the records of the specified file to an incrementally sorted store.
+ *
+ * @remark A store is a directory of sorted binary records files (runs), listed by its manifest in the order they
+ * were appended. The appended records are sorted into a new run; then, as long as the newest `STORE_TIER_FANOUT`
+ * runs belong to the same size tier (i.e., the same power of `STORE_TIER_FANOUT` records), they are k-way merged
+ * into a single run. Appending a batch of B records thus costs O(B log B), plus the amortized compactions.
+ * The store, with its manifest, is created by the first append, which fixes its sort field.
+ *
+ * @param store_path   The path of the store directory.
+ * @param in_file      The file containing the appended records (either CSV or binary).
+ * @param field_id     The field by which records are sorted, which shall be the field of the store.
+ * @param algorithm_id The algorithm used to sort the appended records.
+ * @param param        Additional parameter to pass (i.e., the threshold of merge binary insertion sort).
+ */
+void append_to_store(const char *store_path, FILE *in_file, FieldId field_id, AlgorithmId algorithm_id, void *param);
+
+/**
+ * @brief Writes every record of an incrementally sorted store, in order, by k-way merging its runs.
+ *
+ * @remark Records with equal keys are written in the order they were appended.
+ *
+ * @param store_path The path of the store directory.
+ * @param out_file   The output (CSV) file.
+ */
+void read_store(const char *store_path, FILE *out_file);
@@ -0,0 +1,362 @@
+#include "records-writer.h"
+#include "diagnostics.h"
+#include "memory-usage.h"
+#include "parallel.h"
+#include "records-index.h"
+#include "records-io.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_PTHREADS)
+#include <pthread.h>
+#endif
+
+/**
+ * The number of records formatted by each task.
+ */
+#define WRITER_BLOCK_RECORDS 8192
+
+/**
+ * The maximum number of blocks formatted at the same time.
+ */
+#define WRITER_MAX_BLOCKS 8
+
+/**
+ * The number of batches of the circular queue between the writer and its writing thread (including the one being
+ * filled).
+ */
+#define WRITER_QUEUE_BATCHES 3
+
+/**
+ * The sparse index built while writing (shared by every batch, only updated by the writing thread).
+ */
+typedef struct WriterIndex
+{
+    SparseIndex *index;    /** The index. */
+    char *path;            /** The path of the index file. */
+    uint64_t file_offset;  /** The number of bytes written so far. */
+} WriterIndex;
+
+/**
+ * A batch of records, formatted by one task per block and then written in order.
+ */
+typedef struct WriterBatch
+{
+    Record *records;                           /** The records of the batch. */
+    size_t num_records;                        /** The number of records of the batch. */
+    size_t first_record;                       /** The position in the output of the first record of the batch. */
+    char *text[WRITER_MAX_BLOCKS];             /** The formatted text of each block. */
+    size_t text_len[WRITER_MAX_BLOCKS];        /** The length of the formatted text of each block. */
+    WriterIndex *index;                        /** The sparse index being built (NULL if none). */
+    Record *samples[WRITER_MAX_BLOCKS];        /** The indexed records of each block. */
+    size_t *sample_offsets[WRITER_MAX_BLOCKS]; /** The offsets of the indexed records in the text of each block. */
+    size_t num_samples[WRITER_MAX_BLOCKS];     /** The number of indexed records of each block. */
+} WriterBatch;
+
+/**
+ * The writer queues the batches it fills, which its writing thread formats (on a pool of workers, the writing thread
+ * being one of them) and writes in order. The batch at `produced` is being filled, the ones in range
+ * `[consumed, produced - 1]` are queued.
+ */
+struct RecordsWriter
+{
+    FILE *out_file;                                /** The output file. */
+    WriterBatch batches[WRITER_QUEUE_BATCHES];     /** The queued batches. */
+    size_t capacity;                               /** The number of records of a full batch. */
+    size_t num_blocks;                             /** The number of blocks of a full batch. */
+    size_t num_records;                            /** The number of records queued so far. */
+    size_t produced;                               /** The number of batches queued so far. */
+    size_t consumed;                               /** The number of batches written so far. */
+    int done;                                      /** Whether no more batches will be queued. */
+    ThreadPool *pool;                              /** The workers formatting the blocks of a batch. */
+    WriterIndex index;                             /** The sparse index being built (its `index` is NULL if none). */
+#if defined(HAVE_PTHREADS)
+    pthread_mutex_t lock;                          /** Protects the queue. */
+    pthread_cond_t changed;                        /** Signaled whenever a batch is queued or written. */
+    TaskGroup *task;                               /** The writing thread. */
+#endif
+};
+
+/**
+ * Formats a block of a batch.
+ */
+static void format_block(void *context, size_t block)
+{
+    WriterBatch *batch = (WriterBatch *)context;
+    size_t i, end, len, every, samples;
+    char *text;
+
+    i = block * WRITER_BLOCK_RECORDS;
+    end = i + WRITER_BLOCK_RECORDS < batch->num_records ? i + WRITER_BLOCK_RECORDS : batch->num_records;
+    text = batch->text[block];
+    len = 0;
+
+    if (batch->index)
+    {
+        every = get_sparse_index_every(batch->index->index);
+
+        for (samples = 0; i < end; i++)
+        {
+            if ((batch->first_record + i) % every == 0)
+            {
+                batch->samples[block][samples] = batch->records[i];
+                batch->sample_offsets[block][samples++] = len;
+            }
+
+            len += format_record_csv(text + len, &batch->records[i]);
+        }
+
+        batch->num_samples[block] = samples;
+    }
+    else
+    {
+        for (; i < end; i++)
+            len += format_record_csv(text + len, &batch->records[i]);
+    }
+
+    batch->text_len[block] = len;
+}
+
+/**
+ * Formats the blocks of a batch on the pool, and writes them in order.
+ */
+static void write_batch(RecordsWriter *writer, WriterBatch *batch)
+{
+    size_t num_blocks, block, i;
+
+    num_blocks = (batch->num_records + WRITER_BLOCK_RECORDS - 1) / WRITER_BLOCK_RECORDS;
+    run_pool_tasks(writer->pool, num_blocks, format_block, batch);
+
+    for (block = 0; block < num_blocks; block++)
+    {
+        ASSERT(fwrite(batch->text[block], 1, batch->text_len[block], writer->out_file) == batch->text_len[block], "Unable to write the records", write_batch);
+
+        if (!batch->index)
+            continue;
+
+        for (i = 0; i < batch->num_samples[block]; i++)
+            add_sparse_index_entry(batch->index->index, &batch->samples[block][i], batch->index->file_offset + batch->sample_offsets[block][i]);
+
+        batch->index->file_offset += batch->text_len[block];
+    }
+}
+
+#if defined(HAVE_PTHREADS)
+
+/**
+ * Writes the batches queued by the writer, until it is closed.
+ */
+static void writing_task(void *context, size_t index)
+{
+    RecordsWriter *writer;
+    WriterBatch *batch;
+
+    (void)index;
+    writer = context;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&writer->lock);
+
+        while (writer->produced == writer->consumed && !writer->done)
+            pthread_cond_wait(&writer->changed, &writer->lock);
+
+        if (writer->produced == writer->consumed)
+        {
+            pthread_mutex_unlock(&writer->lock);
+            return;
+        }
+
+        batch = &writer->batches[writer->consumed % WRITER_QUEUE_BATCHES];
+        pthread_mutex_unlock(&writer->lock);
+
+        write_batch(writer, batch);
+
+        pthread_mutex_lock(&writer->lock);
+        writer->consumed++;
+        pthread_cond_broadcast(&writer->changed);
+        pthread_mutex_unlock(&writer->lock);
+    }
+}
+
+#endif
+
+/**
+ * Queues the batch being filled, waiting for the writing thread whenever the queue is full.
+ */
+static void dispatch_batch(RecordsWriter *writer)
+{
+    WriterBatch *batch;
+
+    batch = &writer->batches[writer->produced % WRITER_QUEUE_BATCHES];
+    batch->first_record = writer->num_records;
+    writer->num_records += batch->num_records;
+
+#if defined(HAVE_PTHREADS)
+    pthread_mutex_lock(&writer->lock);
+    writer->produced++;
+    pthread_cond_broadcast(&writer->changed);
+
+    // The next batch to be filled is the oldest one, which shall have been written.
+    while (writer->produced - writer->consumed == WRITER_QUEUE_BATCHES)
+        pthread_cond_wait(&writer->changed, &writer->lock);
+
+    pthread_mutex_unlock(&writer->lock);
+#else
+    write_batch(writer, batch);
+    writer->produced++;
+    writer->consumed++;
+#endif
+
+    writer->batches[writer->produced % WRITER_QUEUE_BATCHES].num_records = 0;
+}
+
+/**
+ * Retrieves the number of blocks of a batch (one per worker thread, at most WRITER_MAX_BLOCKS).
+ */
+static size_t get_writer_blocks(void)
+{
+    size_t num_blocks;
+
+    num_blocks = get_num_threads();
+    return num_blocks < WRITER_MAX_BLOCKS ? num_blocks : WRITER_MAX_BLOCKS;
+}
+
+size_t get_records_writer_memory(void)
+{
+    // The queued batches, each one holding its records and the formatted text of each block.
+    return WRITER_QUEUE_BATCHES * get_writer_blocks() * WRITER_BLOCK_RECORDS * (sizeof(Record) + MAX_RECORD_CSV_LEN);
+}
+
+RecordsWriter *open_records_writer(FILE *out_file)
+{
+    RecordsWriter *writer;
+    size_t num_blocks, i, block;
+
+    ASSERT_NULL_PARAMETER(out_file, open_records_writer);
+
+    writer = calloc(1, sizeof(RecordsWriter));
+    ASSERT(writer, "Unable to allocate memory for the writer", open_records_writer);
+
+    num_blocks = get_writer_blocks();
+    writer->out_file = out_file;
+    writer->capacity = num_blocks * WRITER_BLOCK_RECORDS;
+    writer->num_blocks = num_blocks;
+    writer->pool = create_thread_pool(num_blocks);
+
+    for (i = 0; i < WRITER_QUEUE_BATCHES; i++)
+    {
+        writer->batches[i].records = malloc(sizeof(Record) * writer->capacity);
+        ASSERT(writer->batches[i].records, "Unable to allocate memory for the writer", open_records_writer);
+
+        for (block = 0; block < num_blocks; block++)
+        {
+            writer->batches[i].text[block] = malloc(MAX_RECORD_CSV_LEN * WRITER_BLOCK_RECORDS);
+            ASSERT(writer->batches[i].text[block], "Unable to allocate memory for the writer", open_records_writer);
+        }
+    }
+
+#if defined(HAVE_PTHREADS)
+    ASSERT(!pthread_mutex_init(&writer->lock, NULL), "Unable to create the writer lock", open_records_writer);
+    ASSERT(!pthread_cond_init(&writer->changed, NULL), "Unable to create the writer condition", open_records_writer);
+    writer->task = start_tasks(1, writing_task, writer);
+#endif
+
+    count_memory(MEMORY_PHASE_STORE, get_records_writer_memory());
+    return writer;
+}
+
+void index_records_writer(RecordsWriter *writer, FieldId field_id, size_t every, const char *index_path)
+{
+    size_t i, block, max_samples;
+
+    ASSERT_NULL_PARAMETER(writer, index_records_writer);
+    ASSERT_NULL_PARAMETER(index_path, index_records_writer);
+    ASSERT(!writer->num_records && !writer->batches[writer->produced % WRITER_QUEUE_BATCHES].num_records && !writer->index.index, "The writer has already been used", index_records_writer);
+
+    writer->index.index = create_sparse_index(field_id, every);
+    writer->index.path = malloc(strlen(index_path) + 1);
+    ASSERT(writer->index.path, "Unable to allocate memory for the writer", index_records_writer);
+    strcpy(writer->index.path, index_path);
+
+    max_samples = WRITER_BLOCK_RECORDS / every + 1;
+
+    for (i = 0; i < WRITER_QUEUE_BATCHES; i++)
+    {
+        writer->batches[i].index = &writer->index;
+
+        for (block = 0; block < writer->num_blocks; block++)
+        {
+            writer->batches[i].samples[block] = malloc(sizeof(Record) * max_samples);
+            writer->batches[i].sample_offsets[block] = malloc(sizeof(size_t) * max_samples);
+            ASSERT(writer->batches[i].samples[block] && writer->batches[i].sample_offsets[block], "Unable to allocate memory for the writer", index_records_writer);
+        }
+    }
+}
+
+void write_records(RecordsWriter *writer, const Record *records, size_t num_records)
+{
+    WriterBatch *batch;
+    size_t count;
+
+    ASSERT_NULL_PARAMETER(writer, write_records);
+
+    while (num_records > 0)
+    {
+        batch = &writer->batches[writer->produced % WRITER_QUEUE_BATCHES];
+        count = writer->capacity - batch->num_records;
+        count = count < num_records ? count : num_records;
+
+        memcpy(batch->records + batch->num_records, records, sizeof(Record) * count);
+        batch->num_records += count;
+        records += count;
+        num_records -= count;
+
+        if (batch->num_records == writer->capacity)
+            dispatch_batch(writer);
+    }
+}
+
+void close_records_writer(RecordsWriter *writer)
+{
+    size_t i, block;
+
+    ASSERT_NULL_PARAMETER(writer, close_records_writer);
+
+    if (writer->batches[writer->produced % WRITER_QUEUE_BATCHES].num_records)
+        dispatch_batch(writer);
+
+#if defined(HAVE_PTHREADS)
+    pthread_mutex_lock(&writer->lock);
+    writer->done = 1;
+    pthread_cond_broadcast(&writer->changed);
+    pthread_mutex_unlock(&writer->lock);
+
+    wait_tasks(writer->task);
+    pthread_cond_destroy(&writer->changed);
+    pthread_mutex_destroy(&writer->lock);
+#endif
+
+    destroy_thread_pool(writer->pool);
+
+    if (writer->index.index)
+    {
+        write_sparse_index(writer->index.index, writer->index.path, writer->num_records, writer->index.file_offset);
+        destroy_sparse_index(writer->index.index);
+        free(writer->index.path);
+    }
+
+    for (i = 0; i < WRITER_QUEUE_BATCHES; i++)
+    {
+        for (block = 0; block < WRITER_MAX_BLOCKS; block++)
+        {
+            free(writer->batches[i].text[block]);
+            free(writer->batches[i].samples[block]);
+            free(writer->batches[i].sample_offsets[block]);
+        }
+
+        free(writer->batches[i].records);
+    }
+
+    free(writer);
+}
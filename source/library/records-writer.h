@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdio.h>
+#include "records-sorter.h"
+
+/**
+ * @brief A CSV writer of records, queueing batches of records to a dedicated thread, which formats their blocks on a
+ * pool of worker threads and writes them, while the next batches are filled.
+ */
+typedef struct RecordsWriter RecordsWriter;
+
+/**
+ * @brief Opens a writer of records over the specified file.
+ *
+ * @param out_file The output file, which is not closed by the writer.
+ * @return The opened writer.
+ */
+RecordsWriter *open_records_writer(FILE *out_file);
+
+/**
+ * @brief Retrieves the memory used by the buffers of a writer (counted as `MEMORY_PHASE_STORE` when it is opened).
+ *
+ * @return The number of bytes of the buffers of a writer, which depends on the number of worker threads.
+ */
+size_t get_records_writer_memory(void);
+
+/**
+ * @brief Builds a sparse index of the written records, saved when the writer is closed (see `query_sorted_file`).
+ *
+ * @remark The records shall be written sorted by the indexed field, and the output file shall be opened in binary
+ * mode, so that the indexed offsets match the bytes of the file.
+ *
+ * @param writer     The writer, to which no record has been written yet.
+ * @param field_id   The field by which the records are sorted.
+ * @param every      The number of records between two indexed records.
+ * @param index_path The path of the index file.
+ */
+void index_records_writer(RecordsWriter *writer, FieldId field_id, size_t every, const char *index_path);
+
+/**
+ * @brief Writes the specified records, in order.
+ *
+ * @remark Records are copied, so they can be modified as soon as the function returns.
+ *
+ * @param writer      The writer.
+ * @param records     The records to be written.
+ * @param num_records The number of records to be written.
+ */
+void write_records(RecordsWriter *writer, const Record *records, size_t num_records);
+
+/**
+ * @brief Writes the pending records and closes the specified writer.
+ *
+ * @param writer The writer to be closed.
+ */
+void close_records_writer(RecordsWriter *writer);
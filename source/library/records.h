@@ -0,0 +1,20 @@
+#pragma once
+
+#ifndef STRING_FIELD_LEN
+/**
+ * The max length of the string field.
+ * @note: Strings are stored statically to prevent allocations and memory fragmentation.
+ */
+#define STRING_FIELD_LEN 32
+#endif
+
+/**
+ * Represents a record, made of an identifier and three fields (string, integer and floating point).
+ */
+typedef struct Record
+{
+    int id;                        /** The identifier of the record. */
+    char field1[STRING_FIELD_LEN]; /** The string field. */
+    int field2;                    /** The integer field. */
+    float field3;                  /** The floating point field. */
+} Record;
@@ -0,0 +1,242 @@
+#include "sorter.h"
+#include "diagnostics.h"
+#include "large-alloc.h"
+#include "parallel.h"
+#include "sorting.h"
+#include <string.h>
+
+/**
+ * Gets a pointer to the element at the specified index inside the specified array.
+ */
+#define GET_ELEMENT(base, index, size) ((void *)(((unsigned char *)(base)) + (index) * (size)))
+
+struct Sorter
+{
+    SorterOptions options; /** The tuning parameters. */
+    ThreadPool *pool;      /** The workers of the parallel sorts. */
+    void *scratch;         /** The scratch memory, reused by every sort. */
+    size_t scratch_bytes;  /** The size of the scratch memory, in bytes. */
+};
+
+/**
+ * An array being sorted on the thread pool: sorted in slices, which are then merged pairwise.
+ */
+typedef struct SlicedSort
+{
+    void *base;            /** The array. */
+    size_t nitems;         /** The number of elements. */
+    size_t size;           /** The size of each element, in bytes. */
+    compare_fn comparator; /** The comparison function. */
+    size_t threshold;      /** The threshold of the merge binary insertion sort. */
+    void *scratch;         /** The scratch memory, of `(nitems + num_slices) * size` bytes. */
+    size_t num_slices;     /** The number of slices. */
+    size_t width;          /** The number of slices of each run merged by the current level. */
+#ifdef _SORT_STATS
+    SortStats stats[MAX_THREADS]; /** The statistics of each task of the current level (collected by its thread). */
+#endif
+} SlicedSort;
+
+#ifdef _SORT_STATS
+
+/**
+ * Adds the statistics of the first `num_tasks` tasks of the current level to the specified total.
+ */
+static void sum_task_stats(const SlicedSort *sort, size_t num_tasks, SortStats *total)
+{
+    size_t i;
+
+    for (i = 0; i < num_tasks; i++)
+    {
+        total->comparisons += sort->stats[i].comparisons;
+        total->moves += sort->stats[i].moves;
+        total->bytes_copied += sort->stats[i].bytes_copied;
+        total->allocations += sort->stats[i].allocations;
+        total->bytes_allocated += sort->stats[i].bytes_allocated;
+    }
+}
+
+#endif
+
+/**
+ * Gets the index of the first element of a slice (`num_slices` gets the end of the array).
+ */
+static size_t get_slice_start(const SlicedSort *sort, size_t slice)
+{
+    return sort->nitems / sort->num_slices * slice + sort->nitems % sort->num_slices * slice / sort->num_slices;
+}
+
+/**
+ * Sorts a slice, through its own part of the scratch memory (which has an extra element for each slice).
+ */
+static void sort_slice(void *context, size_t slice)
+{
+    SlicedSort *sort = (SlicedSort *)context;
+    size_t start, end;
+
+    start = get_slice_start(sort, slice);
+    end = get_slice_start(sort, slice + 1);
+
+    merge_binary_insertion_sort_scratch(GET_ELEMENT(sort->base, start, sort->size), end - start, sort->size, sort->threshold, sort->comparator, GET_ELEMENT(sort->scratch, start + slice, sort->size));
+
+#ifdef _SORT_STATS
+    get_sort_stats(&sort->stats[slice]);
+#endif
+}
+
+/**
+ * Merges the `pair`-th pair of adjacent runs of `width` slices.
+ */
+static void merge_slices(void *context, size_t pair)
+{
+    SlicedSort *sort = (SlicedSort *)context;
+    size_t first, middle, last, start;
+
+    first = 2 * pair * sort->width;
+    middle = first + sort->width;
+    last = middle + sort->width;
+
+    if (middle >= sort->num_slices)
+    {
+#ifdef _SORT_STATS
+        memset(&sort->stats[pair], 0, sizeof(SortStats));
+#endif
+        return;
+    }
+
+    if (last > sort->num_slices)
+        last = sort->num_slices;
+
+    start = get_slice_start(sort, first);
+
+    merge_sorted_runs(GET_ELEMENT(sort->base, start, sort->size), get_slice_start(sort, middle) - start, get_slice_start(sort, last) - start, sort->size, sort->comparator, GET_ELEMENT(sort->scratch, start, sort->size));
+
+#ifdef _SORT_STATS
+    get_sort_stats(&sort->stats[pair]);
+#endif
+}
+
+void init_sorter_options(SorterOptions *options)
+{
+    ASSERT_NULL_PARAMETER(options, init_sorter_options);
+
+    options->num_threads = 0;
+    options->threshold = DEFAULT_MERGEBININSSORT_THRESHOLD;
+    options->parallel_threshold = DEFAULT_SORTER_PARALLEL_THRESHOLD;
+}
+
+Sorter *create_sorter(const SorterOptions *options)
+{
+    Sorter *sorter;
+
+    sorter = malloc(sizeof(Sorter));
+    ASSERT(sorter, "Unable to allocate memory for the sorter", create_sorter);
+
+    if (options)
+        sorter->options = *options;
+    else
+        init_sorter_options(&sorter->options);
+
+    ASSERT(sorter->options.num_threads <= MAX_THREADS, "Too many sorter threads", create_sorter);
+
+    sorter->pool = create_thread_pool(sorter->options.num_threads);
+    sorter->scratch = NULL;
+    sorter->scratch_bytes = 0;
+
+    return sorter;
+}
+
+void destroy_sorter(Sorter *sorter)
+{
+    if (!sorter)
+        return;
+
+    destroy_thread_pool(sorter->pool);
+    free_large(sorter->scratch);
+    free(sorter);
+}
+
+/**
+ * Grows the scratch memory of the sorter to at least the specified size (at least doubling it, so that a growing
+ * workload reallocates it a logarithmic number of times).
+ */
+static void *reserve_scratch(Sorter *sorter, size_t bytes)
+{
+    if (bytes <= sorter->scratch_bytes)
+        return sorter->scratch;
+
+    if (bytes < 2 * sorter->scratch_bytes)
+        bytes = 2 * sorter->scratch_bytes;
+
+    free_large(sorter->scratch);
+
+    sorter->scratch = allocate_large(bytes);
+    ASSERT(sorter->scratch, "Unable to allocate memory for the sorter scratch", reserve_scratch);
+    sorter->scratch_bytes = bytes;
+
+    return sorter->scratch;
+}
+
+void sorter_reserve(Sorter *sorter, size_t nitems, size_t size)
+{
+    ASSERT_NULL_PARAMETER(sorter, sorter_reserve);
+
+    // Room for an extra element of each slice (see `sort_slice`).
+    reserve_scratch(sorter, (nitems + get_thread_pool_size(sorter->pool)) * size);
+}
+
+void sorter_sort(Sorter *sorter, void *base, size_t nitems, size_t size, compare_fn comparator)
+{
+    SlicedSort sort;
+    size_t num_tasks;
+#ifdef _SORT_STATS
+    SortStats total;
+#endif
+
+    ASSERT_NULL_PARAMETER(sorter, sorter_sort);
+    ASSERT_NULL_PARAMETER(base, sorter_sort);
+    ASSERT_NULL_PARAMETER(comparator, sorter_sort);
+    ASSERT(size > 0, "The element size cannot be zero", sorter_sort);
+
+    if (nitems < 2)
+        return;
+
+    if (nitems < sorter->options.parallel_threshold || get_thread_pool_size(sorter->pool) == 1)
+    {
+        merge_binary_insertion_sort_scratch(base, nitems, size, sorter->options.threshold, comparator, reserve_scratch(sorter, (nitems + 1) * size));
+        return;
+    }
+
+    sort.base = base;
+    sort.nitems = nitems;
+    sort.size = size;
+    sort.comparator = comparator;
+    sort.threshold = sorter->options.threshold;
+    sort.num_slices = get_thread_pool_size(sorter->pool);
+    sort.scratch = reserve_scratch(sorter, (nitems + sort.num_slices) * size);
+
+    if (sort.num_slices > nitems)
+        sort.num_slices = nitems;
+
+    run_pool_tasks(sorter->pool, sort.num_slices, sort_slice, &sort);
+
+#ifdef _SORT_STATS
+    // Each task collects the statistics of its thread, which are summed as the statistics of the calling thread.
+    memset(&total, 0, sizeof(total));
+    sum_task_stats(&sort, sort.num_slices, &total);
+#endif
+
+    // Each level merges pairs of adjacent runs, doubling their width until a single run is left.
+    for (sort.width = 1; sort.width < sort.num_slices; sort.width *= 2)
+    {
+        num_tasks = (sort.num_slices + 2 * sort.width - 1) / (2 * sort.width);
+        run_pool_tasks(sorter->pool, num_tasks, merge_slices, &sort);
+
+#ifdef _SORT_STATS
+        sum_task_stats(&sort, num_tasks, &total);
+#endif
+    }
+
+#ifdef _SORT_STATS
+    set_sort_stats(&total);
+#endif
+}
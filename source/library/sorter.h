@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include "comparators.h"
+#include "sorting.h"
+
+/**
+ * The default number of elements from which `sorter_sort` splits an array over the workers of the sorter.
+ */
+#define DEFAULT_SORTER_PARALLEL_THRESHOLD 65536
+
+/**
+ * @brief The tuning parameters of a sorter.
+ */
+typedef struct SorterOptions
+{
+    size_t num_threads;        /** The number of workers of the thread pool (0 uses `get_num_threads`, 1 starts no thread). */
+    size_t threshold;          /** The threshold of the merge binary insertion sort (1 performs a plain merge sort). */
+    size_t parallel_threshold; /** The number of elements from which an array is split over the workers. */
+} SorterOptions;
+
+/**
+ * @brief A reusable sort context, owning a thread pool and the scratch memory of its sorts.
+ *
+ * @remark Creating a sorter once and sorting many arrays through it saves the setup of each sort: the threads are
+ * started once, and the scratch memory only grows, so sorting arrays no larger than the previous ones allocates
+ * nothing. A sorter shall not be used by several threads at once: concurrent callers should own a sorter each.
+ */
+typedef struct Sorter Sorter;
+
+/**
+ * @brief Initializes the specified options to their defaults: one worker per online processor, the default merge
+ * binary insertion sort threshold (`DEFAULT_MERGEBININSSORT_THRESHOLD`) and `DEFAULT_SORTER_PARALLEL_THRESHOLD`.
+ *
+ * @param options The options to be initialized.
+ */
+void init_sorter_options(SorterOptions *options);
+
+/**
+ * @brief Creates a sorter, starting the workers of its thread pool.
+ *
+ * @param options The tuning parameters (NULL uses the defaults, see `init_sorter_options`).
+ * @return The created sorter.
+ */
+Sorter *create_sorter(const SorterOptions *options);
+
+/**
+ * @brief Stops the workers of the specified sorter, releases its scratch memory and destroys it.
+ *
+ * @param sorter The sorter to be destroyed (NULL is ignored).
+ */
+void destroy_sorter(Sorter *sorter);
+
+/**
+ * @brief Grows the scratch memory of the specified sorter, so that sorting arrays of up to `nitems` elements of
+ * `size` bytes allocates nothing.
+ *
+ * @param sorter The sorter.
+ * @param nitems The number of elements.
+ * @param size   The size of each element, in bytes.
+ */
+void sorter_reserve(Sorter *sorter, size_t nitems, size_t size);
+
+/**
+ * @brief Sorts the provided array with the merge binary insertion sort, through the scratch memory of the sorter.
+ *
+ * @remark Arrays of at least `parallel_threshold` elements are split into one slice per worker, the slices are sorted
+ * on the thread pool and then merged pairwise, each level of merges on the thread pool too. The merges are stable, but
+ * binary insertion sort may reorder equal elements: a `threshold` of 1 makes the whole sort stable.
+ *
+ * @param sorter     The sorter.
+ * @param base       Pointer to the beginning of the array to be sorted.
+ * @param nitems     Number of elements in the array (arrays with less than two elements are left as they are).
+ * @param size       Size of each element in the array, in bytes.
+ * @param comparator Pointer to the comparison function that defines the order of elements.
+ *
+ * @note This operation has linearithmic time complexity O(N log N).
+ */
+void sorter_sort(Sorter *sorter, void *base, size_t nitems, size_t size, compare_fn comparator);
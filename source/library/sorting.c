@@ -1,29 +1,269 @@
 #include "sorting.h"
 #include "diagnostics.h"
+#include "large-alloc.h"
 #include <memory.h>
+#include <stdint.h>
 
 /**
  * Gets a pointer to the element at the specified index inside the specified array.
  */
 #define GET_ELEMENT(base, index, size) ((void *)(((unsigned char *)(base)) + (index) * (size)))
 
+#ifdef _SORT_STATS
+
+/**
+ * Declares a variable of which each thread has its own instance.
+ */
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+/**
+ * The statistics of the current sort call of the thread (so that sorts run concurrently do not race on them).
+ */
+static THREAD_LOCAL SortStats g_stats;
+
 /**
- * Merges two sorted arrays into one.
+ * Resets the statistics at the beginning of a sort call.
  */
-static void merge(void *l_base, size_t l_nitems, void *r_base, size_t r_nitems, size_t size, compare_fn comparator)
+#define STATS_RESET() memset(&g_stats, 0, sizeof(g_stats))
+
+/**
+ * Invokes the comparator, counting the comparison.
+ */
+#define COMPARE(comparator, left, right) (g_stats.comparisons++, (comparator)((left), (right)))
+
+/**
+ * Counts `count` elements of `size` bytes moved.
+ */
+#define STATS_MOVES(count, size) (g_stats.moves += (count), g_stats.bytes_copied += (count) * (size))
+
+/**
+ * Counts an allocation of `bytes` bytes.
+ */
+#define STATS_ALLOCATION(bytes) (g_stats.allocations++, g_stats.bytes_allocated += (bytes))
+
+void get_sort_stats(SortStats *stats)
+{
+    ASSERT_NULL_PARAMETER(stats, get_sort_stats);
+    *stats = g_stats;
+}
+
+void set_sort_stats(const SortStats *stats)
+{
+    ASSERT_NULL_PARAMETER(stats, set_sort_stats);
+    g_stats = *stats;
+}
+
+#else
+
+#define STATS_RESET() ((void)0)
+#define COMPARE(comparator, left, right) (comparator)((left), (right))
+#define STATS_MOVES(count, size) ((void)0)
+#define STATS_ALLOCATION(bytes) ((void)0)
+
+#endif
+
+/**
+ * The largest element held in a stack temporary (e.g., the element inserted by binary insertion sort); larger
+ * elements are held in allocated memory.
+ */
+#define MAX_STACK_ELEMENT 256
+
+/**
+ * The largest element moved and swapped one word at a time (if its size is a multiple of the word size).
+ */
+#define MAX_WORDS_ELEMENT 64
+
+/**
+ * The size of the chunks in which the generic routine swaps elements, through a stack temporary.
+ */
+#define SWAP_CHUNK_SIZE 64
+
+/**
+ * Copies an element (`size` is only read by the generic routines).
+ */
+typedef void (*move_fn)(void *dst, const void *src, size_t size);
+
+/**
+ * Swaps two distinct elements (`size` is only read by the generic routines).
+ */
+typedef void (*swap_fn)(void *left, void *right, size_t size);
+
+/**
+ * The element routines of a sort, selected once by `get_element_ops` according to the element size.
+ */
+typedef struct ElementOps
+{
+    size_t size;   /** The size of each element, in bytes. */
+    move_fn move;  /** Copies an element. */
+    swap_fn swap;  /** Swaps two elements. */
+} ElementOps;
+
+/**
+ * Defines the routines moving and swapping elements of a fixed size, whose copies the compiler turns into a few
+ * loads and stores instead of `memcpy` calls.
+ */
+#define DEFINE_FIXED_ELEMENT_OPS(bytes)                                    \
+    static void move_##bytes(void *dst, const void *src, size_t size)      \
+    {                                                                      \
+        (void)size;                                                        \
+        memcpy(dst, src, bytes);                                           \
+    }                                                                      \
+                                                                           \
+    static void swap_##bytes(void *left, void *right, size_t size)         \
+    {                                                                      \
+        unsigned char temp[bytes];                                         \
+                                                                           \
+        (void)size;                                                        \
+        memcpy(temp, left, bytes);                                         \
+        memcpy(left, right, bytes);                                        \
+        memcpy(right, temp, bytes);                                        \
+    }
+
+DEFINE_FIXED_ELEMENT_OPS(4)
+DEFINE_FIXED_ELEMENT_OPS(8)
+DEFINE_FIXED_ELEMENT_OPS(16)
+DEFINE_FIXED_ELEMENT_OPS(32)
+DEFINE_FIXED_ELEMENT_OPS(44)
+DEFINE_FIXED_ELEMENT_OPS(48)
+
+/**
+ * Copies an element whose size is a multiple of the word size, one word at a time.
+ */
+static void move_words(void *dst, const void *src, size_t size)
+{
+    unsigned char *dst_bytes = dst;
+    const unsigned char *src_bytes = src;
+    size_t i;
+
+    for (i = 0; i < size; i += sizeof(uint64_t))
+        memcpy(dst_bytes + i, src_bytes + i, sizeof(uint64_t));
+}
+
+/**
+ * Swaps two elements whose size is a multiple of the word size, one word at a time.
+ */
+static void swap_words(void *left, void *right, size_t size)
+{
+    unsigned char *left_bytes = left, *right_bytes = right;
+    uint64_t temp;
+    size_t i;
+
+    for (i = 0; i < size; i += sizeof(uint64_t))
+    {
+        memcpy(&temp, left_bytes + i, sizeof(uint64_t));
+        memcpy(left_bytes + i, right_bytes + i, sizeof(uint64_t));
+        memcpy(right_bytes + i, &temp, sizeof(uint64_t));
+    }
+}
+
+/**
+ * Copies an element of any size.
+ */
+static void move_generic(void *dst, const void *src, size_t size)
+{
+    memcpy(dst, src, size);
+}
+
+/**
+ * Swaps two elements of any size, a chunk at a time through a stack temporary.
+ */
+static void swap_generic(void *left, void *right, size_t size)
+{
+    unsigned char temp[SWAP_CHUNK_SIZE];
+    unsigned char *left_bytes = left, *right_bytes = right;
+
+    // Whole chunks are copied with a constant size, which the compiler inlines.
+    for (; size >= SWAP_CHUNK_SIZE; size -= SWAP_CHUNK_SIZE, left_bytes += SWAP_CHUNK_SIZE, right_bytes += SWAP_CHUNK_SIZE)
+    {
+        memcpy(temp, left_bytes, SWAP_CHUNK_SIZE);
+        memcpy(left_bytes, right_bytes, SWAP_CHUNK_SIZE);
+        memcpy(right_bytes, temp, SWAP_CHUNK_SIZE);
+    }
+
+    if (size > 0)
+    {
+        memcpy(temp, left_bytes, size);
+        memcpy(left_bytes, right_bytes, size);
+        memcpy(right_bytes, temp, size);
+    }
+}
+
+/**
+ * Selects the element routines for the specified element size (e.g., 4 bytes for `int` and `float`, 8 bytes for
+ * pointers, 44 bytes for `Record`).
+ */
+static void get_element_ops(size_t size, ElementOps *ops)
+{
+    ops->size = size;
+
+    switch (size)
+    {
+    case 4:
+        ops->move = move_4;
+        ops->swap = swap_4;
+        return;
+    case 8:
+        ops->move = move_8;
+        ops->swap = swap_8;
+        return;
+    case 16:
+        ops->move = move_16;
+        ops->swap = swap_16;
+        return;
+    case 32:
+        ops->move = move_32;
+        ops->swap = swap_32;
+        return;
+    case 44:
+        ops->move = move_44;
+        ops->swap = swap_44;
+        return;
+    case 48:
+        ops->move = move_48;
+        ops->swap = swap_48;
+        return;
+    }
+
+    // Beyond a few words, `memcpy` copies large elements faster than a word loop.
+    if (size % sizeof(uint64_t) == 0 && size <= MAX_WORDS_ELEMENT)
+    {
+        ops->move = move_words;
+        ops->swap = swap_words;
+        return;
+    }
+
+    ops->move = move_generic;
+    ops->swap = swap_generic;
+}
+
+/**
+ * Merges two sorted arrays into one, through the scratch memory if provided (a new merging array otherwise).
+ */
+static void merge(void *l_base, size_t l_nitems, void *r_base, size_t r_nitems, const ElementOps *ops, compare_fn comparator, void *scratch)
 {
     void *res, *src;
-    size_t res_size, l_idx, r_idx, res_idx;
+    size_t size, res_size, l_idx, r_idx, res_idx;
 
+    size = ops->size;
     res_size = (l_nitems + r_nitems) * size;
-    res = malloc(res_size);
-    ASSERT(res, "Unable to allocate memory for the merging array", merge);
+    res = scratch;
+
+    if (!scratch)
+    {
+        res = allocate_large(res_size);
+        ASSERT(res, "Unable to allocate memory for the merging array", merge);
+        STATS_ALLOCATION(res_size);
+    }
 
     l_idx = r_idx = res_idx = 0;
 
     while (l_idx < l_nitems && r_idx < r_nitems)
     {
-        if (comparator(GET_ELEMENT(l_base, l_idx, size), GET_ELEMENT(r_base, r_idx, size)) <= 0)
+        if (COMPARE(comparator, GET_ELEMENT(l_base, l_idx, size), GET_ELEMENT(r_base, r_idx, size)) <= 0)
         {
             src = GET_ELEMENT(l_base, l_idx++, size);
         }
@@ -32,7 +272,7 @@ static void merge(void *l_base, size_t l_nitems, void *r_base, size_t r_nitems,
             src = GET_ELEMENT(r_base, r_idx++, size);
         }
 
-        ASSERT(memcpy(GET_ELEMENT(res, res_idx++, size), src, size), "Unable to copy an element to the merging array", merge);
+        ops->move(GET_ELEMENT(res, res_idx++, size), src, size);
     }
 
     if (l_idx < l_nitems)
@@ -43,13 +283,17 @@ static void merge(void *l_base, size_t l_nitems, void *r_base, size_t r_nitems,
 
     ASSERT(memcpy(l_base, res, res_size), "Unable to copy the merge array to the destination", merge);
 
-    free(res);
+    // Every element is copied to the merging array and back.
+    STATS_MOVES(2 * (l_nitems + r_nitems), size);
+
+    if (!scratch)
+        free_large(res);
 }
 
 /**
  * Performs the merge sort algorithm over the provided array.
  */
-static void merge_sort_rec(void *base, size_t nitems, size_t size, compare_fn comparator)
+static void merge_sort_rec(void *base, size_t nitems, const ElementOps *ops, compare_fn comparator)
 {
     size_t half;
     void *half_base;
@@ -58,89 +302,92 @@ static void merge_sort_rec(void *base, size_t nitems, size_t size, compare_fn co
         return;
 
     half = nitems / 2;
-    half_base = GET_ELEMENT(base, half, size);
+    half_base = GET_ELEMENT(base, half, ops->size);
 
-    merge_sort_rec(base, half, size, comparator);
-    merge_sort_rec(half_base, nitems - half, size, comparator);
+    merge_sort_rec(base, half, ops, comparator);
+    merge_sort_rec(half_base, nitems - half, ops, comparator);
 
-    merge(base, half, half_base, nitems - half, size, comparator);
+    merge(base, half, half_base, nitems - half, ops, comparator, NULL);
 }
 
 void merge_sort(void *base, size_t nitems, size_t size, compare_fn comparator)
 {
+    ElementOps ops;
+
     ASSERT_NULL_PARAMETER(base, merge_sort);
     ASSERT_NULL_PARAMETER(comparator, merge_sort);
     ASSERT(nitems > 0, "The array must contain at least one element", merge_sort);
     ASSERT(size > 0, "The element size cannot be zero", merge_sort);
 
-    merge_sort_rec(base, nitems, size, comparator);
+    STATS_RESET();
+    get_element_ops(size, &ops);
+    merge_sort_rec(base, nitems, &ops, comparator);
 }
 
 /**
  * Swaps two elements of an array given their indexes.
  */
-static inline void exchange_values(void *base, size_t size, int left_index, int right_index, void *temp)
+static inline void exchange_values(void *base, const ElementOps *ops, int left_index, int right_index)
 {
-    ASSERT(memcpy(temp, GET_ELEMENT(base, left_index, size), size), "Unable to copy left into temp", exchange_values);
-    ASSERT(memcpy(GET_ELEMENT(base, left_index, size), GET_ELEMENT(base, right_index, size), size), "Unable to copy right into left", exchange_values);
-    ASSERT(memcpy(GET_ELEMENT(base, right_index, size), temp, size), "Unable to copy temp into right", exchange_values);
+    ops->swap(GET_ELEMENT(base, left_index, ops->size), GET_ELEMENT(base, right_index, ops->size), ops->size);
+    STATS_MOVES(3, ops->size);
 }
 
 /**
  * Performs the partition phase of the quicksort algorithm.
  */
-static int partition(void *base, int low, int high, size_t size, compare_fn comparator)
+static int partition(void *base, int low, int high, const ElementOps *ops, compare_fn comparator)
 {
-    void *temp;
+    size_t size = ops->size;
     int pivot_index = low;
     void *pivot = GET_ELEMENT(base, pivot_index, size);
     int left = low - 1;
     int right = high + 1;
 
-    temp = malloc(size);
-    ASSERT(temp, "Unable to allocate memory for temp variable", partition);
-
     while (left < right)
     {
         do
         {
             left++;
-        } while (comparator(GET_ELEMENT(base, left, size), pivot) < 0);
+        } while (COMPARE(comparator, GET_ELEMENT(base, left, size), pivot) < 0);
 
         do
         {
             right--;
-        } while (comparator(GET_ELEMENT(base, right, size), pivot) > 0);
+        } while (COMPARE(comparator, GET_ELEMENT(base, right, size), pivot) > 0);
 
         if (left < right)
-            exchange_values(base, size, left, right, temp);
+            exchange_values(base, ops, left, right);
     }
 
-    free(temp);
     return right;
 }
 
 /**
  * Performs the quick sort algorithm over the provided array.
  */
-static void quick_sort_rec(void *base, int low, int high, size_t size, compare_fn comparator)
+static void quick_sort_rec(void *base, int low, int high, const ElementOps *ops, compare_fn comparator)
 {
     if (low < high)
     {
-        int pivot = partition(base, low, high, size, comparator);
-        quick_sort_rec(base, low, pivot, size, comparator);
-        quick_sort_rec(base, pivot + 1, high, size, comparator);
+        int pivot = partition(base, low, high, ops, comparator);
+        quick_sort_rec(base, low, pivot, ops, comparator);
+        quick_sort_rec(base, pivot + 1, high, ops, comparator);
     }
 }
 
 void quick_sort(void *base, size_t nitems, size_t size, compare_fn comparator)
 {
+    ElementOps ops;
+
     ASSERT_NULL_PARAMETER(base, quick_sort);
     ASSERT_NULL_PARAMETER(comparator, quick_sort);
     ASSERT(nitems > 0, "The array must contain at least one element", quick_sort);
     ASSERT(size > 0, "The element size cannot be zero", quick_sort);
 
-    quick_sort_rec(base, 0, (int)(nitems - 1), size, comparator);
+    STATS_RESET();
+    get_element_ops(size, &ops);
+    quick_sort_rec(base, 0, (int)(nitems - 1), &ops, comparator);
 }
 
 /**
@@ -161,7 +408,7 @@ static size_t binary_search(void *base, size_t size, void *elem, size_t upper, c
         half = (lower + upper) / 2;
         half_elem = GET_ELEMENT(base, half, size);
 
-        cmp_res = compare(elem, half_elem);
+        cmp_res = COMPARE(compare, elem, half_elem);
 
         if (cmp_res == 0)
             return half + 1;
@@ -172,7 +419,7 @@ static size_t binary_search(void *base, size_t size, void *elem, size_t upper, c
             upper = half;
     }
 
-    return compare(elem, GET_ELEMENT(base, lower, size)) > 0
+    return COMPARE(compare, elem, GET_ELEMENT(base, lower, size)) > 0
                ? lower + 1
                : lower;
 }
@@ -188,70 +435,315 @@ static void *shift_right(void *base, size_t size, size_t insert_idx, size_t from
     pivot = GET_ELEMENT(base, insert_idx, size);
     pivot_dest = GET_ELEMENT(base, insert_idx + 1, size);
 
+    // The source and destination ranges overlap, so they are moved with memmove.
     shift_sz = (from_idx - insert_idx) * size;
-    ASSERT(memcpy(pivot_dest, pivot, shift_sz), "Unable to shift memory", shift_right);
+    memmove(pivot_dest, pivot, shift_sz);
+    STATS_MOVES(from_idx - insert_idx, size);
 
     return pivot;
 }
 
 /**
- * Performs the binary insertion sort algorithm over the provided array.
+ * Performs the binary insertion sort algorithm over the provided array, saving the inserted element to `temp` if
+ * provided (to a stack temporary, or a new buffer for large elements, otherwise).
  */
-static void binary_insertion_sort_it(void *base, size_t nitems, size_t size, compare_fn comparator)
+static void binary_insertion_sort_it(void *base, size_t nitems, const ElementOps *ops, compare_fn comparator, void *temp)
 {
-    size_t i, new_pos;
+    uint64_t stack_elem[MAX_STACK_ELEMENT / sizeof(uint64_t)];
+    size_t i, new_pos, size;
     void *current_elem, *src_elem, *dst_elem;
 
-    src_elem = malloc(size);
+    size = ops->size;
+    src_elem = temp;
 
-    ASSERT(src_elem, "Unable to allocate memory for the inserted element", binary_insertion_sort_it);
+    if (!temp && size <= MAX_STACK_ELEMENT)
+        src_elem = stack_elem;
+    else if (!temp)
+    {
+        src_elem = malloc(size);
+        ASSERT(src_elem, "Unable to allocate memory for the inserted element", binary_insertion_sort_it);
+        STATS_ALLOCATION(size);
+    }
 
     for (i = 1; i < nitems; ++i)
     {
         current_elem = GET_ELEMENT(base, i, size);
         new_pos = binary_search(base, size, current_elem, i - 1, comparator);
 
-        ASSERT(memcpy(src_elem, current_elem, size), "Unable to save a copy of the current element", binary_insertion_sort_it);
+        ops->move(src_elem, current_elem, size);
         dst_elem = shift_right(base, size, new_pos, i);
-        ASSERT(memcpy(dst_elem, src_elem, size), "Unable to copy the inserted element into its destination", binary_insertion_sort_it);
+        ops->move(dst_elem, src_elem, size);
+        STATS_MOVES(2, size);
     }
 
-    free(src_elem);
+    if (src_elem != temp && src_elem != (void *)stack_elem)
+        free(src_elem);
 }
 
 void binary_insertion_sort(void *base, size_t nitems, size_t size, compare_fn comparator)
 {
+    ElementOps ops;
+
     ASSERT_NULL_PARAMETER(base, binary_insertion_sort);
     ASSERT_NULL_PARAMETER(comparator, binary_insertion_sort);
     ASSERT(nitems > 0, "The array must contain at least one element", quick_sort);
     ASSERT(size > 0, "The element size cannot be zero", quick_sort);
 
-    binary_insertion_sort_it(base, nitems, size, comparator);
+    STATS_RESET();
+    get_element_ops(size, &ops);
+    binary_insertion_sort_it(base, nitems, &ops, comparator, NULL);
 }
 
 /**
- * Performs the binary insertion sort algorithm over the provided array.
+ * Performs the merge binary insertion sort algorithm over the provided array.
+ *
+ * The scratch memory, if provided, holds the merging array followed by the element inserted by binary insertion sort.
  */
-static void merge_binary_insertion_sort_rec(void *base, size_t nitems, size_t size, size_t threshold, compare_fn comparator)
+static void merge_binary_insertion_sort_rec(void *base, size_t nitems, const ElementOps *ops, size_t threshold, compare_fn comparator, void *scratch)
 {
+    size_t half;
+    void *half_base;
+
     if (nitems == 1)
         return;
 
     if (nitems <= threshold)
     {
-        binary_insertion_sort(base, nitems, size, comparator);
+        binary_insertion_sort_it(base, nitems, ops, comparator, scratch ? GET_ELEMENT(scratch, nitems, ops->size) : NULL);
         return;
     }
 
-    merge_sort_rec(base, nitems, size, comparator);
+    half = nitems / 2;
+    half_base = GET_ELEMENT(base, half, ops->size);
+
+    merge_binary_insertion_sort_rec(base, half, ops, threshold, comparator, scratch);
+    merge_binary_insertion_sort_rec(half_base, nitems - half, ops, threshold, comparator, scratch);
+
+    merge(base, half, half_base, nitems - half, ops, comparator, scratch);
 }
 
 void merge_binary_insertion_sort(void *base, size_t nitems, size_t size, size_t threshold, compare_fn comparator)
 {
+    ElementOps ops;
+
     ASSERT_NULL_PARAMETER(base, merge_binary_insertion_sort);
     ASSERT_NULL_PARAMETER(comparator, merge_binary_insertion_sort);
     ASSERT(nitems > 0, "The array must contain at least one element", merge_binary_insertion_sort);
     ASSERT(size > 0, "The element size cannot be zero", merge_binary_insertion_sort);
 
-    merge_binary_insertion_sort_rec(base, nitems, size, threshold, comparator);
+    STATS_RESET();
+    get_element_ops(size, &ops);
+    merge_binary_insertion_sort_rec(base, nitems, &ops, threshold, comparator, NULL);
+}
+
+void merge_binary_insertion_sort_scratch(void *base, size_t nitems, size_t size, size_t threshold, compare_fn comparator, void *scratch)
+{
+    ElementOps ops;
+
+    ASSERT_NULL_PARAMETER(base, merge_binary_insertion_sort_scratch);
+    ASSERT_NULL_PARAMETER(comparator, merge_binary_insertion_sort_scratch);
+    ASSERT_NULL_PARAMETER(scratch, merge_binary_insertion_sort_scratch);
+    ASSERT(nitems > 0, "The array must contain at least one element", merge_binary_insertion_sort_scratch);
+    ASSERT(size > 0, "The element size cannot be zero", merge_binary_insertion_sort_scratch);
+
+    STATS_RESET();
+    get_element_ops(size, &ops);
+    merge_binary_insertion_sort_rec(base, nitems, &ops, threshold, comparator, scratch);
+}
+
+void merge_sorted_runs(void *base, size_t l_nitems, size_t nitems, size_t size, compare_fn comparator, void *scratch)
+{
+    ElementOps ops;
+
+    ASSERT_NULL_PARAMETER(base, merge_sorted_runs);
+    ASSERT_NULL_PARAMETER(comparator, merge_sorted_runs);
+    ASSERT_NULL_PARAMETER(scratch, merge_sorted_runs);
+    ASSERT(l_nitems <= nitems, "The left run is longer than the array", merge_sorted_runs);
+    ASSERT(size > 0, "The element size cannot be zero", merge_sorted_runs);
+
+    STATS_RESET();
+    get_element_ops(size, &ops);
+
+    if (l_nitems > 0 && l_nitems < nitems)
+        merge(base, l_nitems, GET_ELEMENT(base, l_nitems, size), nitems - l_nitems, &ops, comparator, scratch);
+}
+
+/**
+ * Restores the max-heap property of the heap with `[0, nitems - 1]` bounds, moving down the element at `root`.
+ */
+static void sift_down(void *base, size_t nitems, const ElementOps *ops, size_t root, compare_fn comparator)
+{
+    size_t child, size;
+
+    size = ops->size;
+
+    while ((child = 2 * root + 1) < nitems)
+    {
+        if (child + 1 < nitems && COMPARE(comparator, GET_ELEMENT(base, child, size), GET_ELEMENT(base, child + 1, size)) < 0)
+            child++;
+
+        if (COMPARE(comparator, GET_ELEMENT(base, root, size), GET_ELEMENT(base, child, size)) >= 0)
+            return;
+
+        exchange_values(base, ops, (int)root, (int)child);
+        root = child;
+    }
+}
+
+/**
+ * Moves the `k` smallest elements of the array at its beginning, in order, keeping them in a bounded max-heap.
+ */
+static void heap_select(void *base, size_t nitems, const ElementOps *ops, size_t k, compare_fn comparator)
+{
+    size_t i;
+
+    if (k > nitems)
+        k = nitems;
+
+    if (k == 0)
+        return;
+
+    // The first k elements become a max-heap of the k smallest elements seen so far.
+    for (i = k / 2; i > 0; i--)
+        sift_down(base, k, ops, i - 1, comparator);
+
+    for (i = k; i < nitems; i++)
+    {
+        if (COMPARE(comparator, GET_ELEMENT(base, i, ops->size), base) < 0)
+        {
+            exchange_values(base, ops, 0, (int)i);
+            sift_down(base, k, ops, 0, comparator);
+        }
+    }
+
+    // Sort the heap, moving its maximum at the end of the shrinking heap.
+    for (i = k - 1; i > 0; i--)
+    {
+        exchange_values(base, ops, 0, (int)i);
+        sift_down(base, i, ops, 0, comparator);
+    }
+}
+
+void partial_sort(void *base, size_t nitems, size_t size, size_t k, compare_fn comparator)
+{
+    ElementOps ops;
+
+    ASSERT_NULL_PARAMETER(base, partial_sort);
+    ASSERT_NULL_PARAMETER(comparator, partial_sort);
+    ASSERT(nitems > 0, "The array must contain at least one element", partial_sort);
+    ASSERT(size > 0, "The element size cannot be zero", partial_sort);
+
+    STATS_RESET();
+    get_element_ops(size, &ops);
+    heap_select(base, nitems, &ops, k, comparator);
+}
+
+/**
+ * Below this number of elements, the selection sorts the partition by binary insertion.
+ */
+#define SELECT_INSERTION_THRESHOLD 16
+
+/**
+ * Moves the median of the first, middle and last elements of the range `[low, high]` at `low`, as the pivot of
+ * `partition`.
+ */
+static void select_pivot(void *base, int low, int high, const ElementOps *ops, compare_fn comparator)
+{
+    size_t size = ops->size;
+    int mid = low + (high - low) / 2;
+
+    if (COMPARE(comparator, GET_ELEMENT(base, mid, size), GET_ELEMENT(base, low, size)) < 0)
+        exchange_values(base, ops, mid, low);
+
+    if (COMPARE(comparator, GET_ELEMENT(base, high, size), GET_ELEMENT(base, low, size)) < 0)
+        exchange_values(base, ops, high, low);
+
+    // Now low is the minimum: the median is the smaller of mid and high.
+    if (COMPARE(comparator, GET_ELEMENT(base, high, size), GET_ELEMENT(base, mid, size)) < 0)
+        exchange_values(base, ops, high, mid);
+
+    exchange_values(base, ops, mid, low);
+}
+
+/**
+ * Selects the ranks in `[ranks[0], ranks[num_ranks - 1]]` of the range `[low, high]` of the array.
+ */
+static void select_rec(void *base, int low, int high, const ElementOps *ops, const size_t *ranks, size_t num_ranks, size_t depth, compare_fn comparator)
+{
+    size_t left_ranks, size;
+    int pivot;
+
+    size = ops->size;
+
+    while (num_ranks > 0 && low < high)
+    {
+        if (high - low < SELECT_INSERTION_THRESHOLD)
+        {
+            binary_insertion_sort_it(GET_ELEMENT(base, low, size), (size_t)(high - low + 1), ops, comparator, NULL);
+            return;
+        }
+
+        // The partitions do not shrink fast enough: sort the rest by heap selection, in O(N log N).
+        if (depth-- == 0)
+        {
+            heap_select(GET_ELEMENT(base, low, size), (size_t)(high - low + 1), ops, (size_t)(high - low + 1), comparator);
+            return;
+        }
+
+        select_pivot(base, low, high, ops, comparator);
+        pivot = partition(base, low, high, ops, comparator);
+
+        // Ranks are sorted: those up to the pivot are selected in the left side, the others in the right side.
+        for (left_ranks = 0; left_ranks < num_ranks && ranks[left_ranks] <= (size_t)pivot; left_ranks++)
+            ;
+
+        if (left_ranks > 0 && left_ranks < num_ranks)
+            select_rec(base, low, pivot, ops, ranks, left_ranks, depth, comparator);
+
+        if (left_ranks < num_ranks)
+        {
+            ranks += left_ranks;
+            num_ranks -= left_ranks;
+            low = pivot + 1;
+        }
+        else
+            high = pivot;
+    }
+}
+
+void select_quantiles(void *base, size_t nitems, size_t size, const size_t *ranks, size_t num_ranks, compare_fn comparator)
+{
+    ElementOps ops;
+    size_t i, depth;
+
+    ASSERT_NULL_PARAMETER(base, select_quantiles);
+    ASSERT_NULL_PARAMETER(comparator, select_quantiles);
+    ASSERT(nitems > 0, "The array must contain at least one element", select_quantiles);
+    ASSERT(size > 0, "The element size cannot be zero", select_quantiles);
+    ASSERT(ranks || !num_ranks, "'ranks' parameter is NULL", select_quantiles);
+
+    for (i = 0; i < num_ranks; i++)
+    {
+        ASSERT(ranks[i] < nitems, "The rank is out of the array", select_quantiles);
+        ASSERT(i == 0 || ranks[i - 1] <= ranks[i], "The ranks must be in ascending order", select_quantiles);
+    }
+
+    STATS_RESET();
+    get_element_ops(size, &ops);
+
+    // As in introsort, the partitioning depth is bounded by 2 log2(N).
+    for (depth = 0, i = nitems; i > 1; i /= 2)
+        depth += 2;
+
+    select_rec(base, 0, (int)(nitems - 1), &ops, ranks, num_ranks, depth, comparator);
+}
+
+void nth_element(void *base, size_t nitems, size_t size, size_t nth, compare_fn comparator)
+{
+    ASSERT_NULL_PARAMETER(base, nth_element);
+    ASSERT_NULL_PARAMETER(comparator, nth_element);
+    ASSERT(nitems > 0, "The array must contain at least one element", nth_element);
+    ASSERT(nth < nitems, "The selected index is out of the array", nth_element);
+
+    select_quantiles(base, nitems, size, &nth, 1, comparator);
 }
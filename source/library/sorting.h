@@ -3,6 +3,12 @@
 #include <stdio.h>
 #include "comparators.h"
 
+/**
+ * @brief The default threshold of the merge binary insertion sort (e.g., when none is given nor found in the tuning
+ * configuration).
+ */
+#define DEFAULT_MERGEBININSSORT_THRESHOLD 50
+
 /**
  * @brief Sorts the provided array with the merge sort algorithm.
  *
@@ -55,3 +61,125 @@ void binary_insertion_sort(void *base, size_t nitems, size_t size, compare_fn co
  * @note This operation has linearithmic time complexity O(N log N).
  */
 void merge_binary_insertion_sort(void *base, size_t nitems, size_t size, size_t threshold, compare_fn comparator);
+
+/**
+ * @brief Performs the merge binary insertion sort over the provided array, using the provided scratch memory
+ * instead of allocating the merging arrays and the inserted element.
+ *
+ * @remark The order is the same as `merge_binary_insertion_sort` (a `threshold` of 1 performs a plain merge sort).
+ * Reusing the same scratch memory over many calls saves an allocation per merge (see `sorter_sort`).
+ *
+ * @param base       Pointer to the beginning of the array to be sorted.
+ * @param nitems     Number of elements in the array.
+ * @param size       Size of each element in the array, in bytes.
+ * @param threshold  The threshold at which the algorithm switches from merge sort to binary insertion sort.
+ * @param comparator Pointer to the comparison function that defines the order of elements.
+ * @param scratch    Scratch memory of at least `(nitems + 1) * size` bytes.
+ *
+ * @note This operation has linearithmic time complexity O(N log N).
+ */
+void merge_binary_insertion_sort_scratch(void *base, size_t nitems, size_t size, size_t threshold, compare_fn comparator, void *scratch);
+
+/**
+ * @brief Merges two adjacent sorted runs of the provided array, `[0, l_nitems - 1]` and `[l_nitems, nitems - 1]`.
+ *
+ * @remark The merge is stable: elements of the left run come before equal elements of the right run.
+ *
+ * @param base       Pointer to the beginning of the array.
+ * @param l_nitems   Number of elements in the left run.
+ * @param nitems     Number of elements in the array (both runs).
+ * @param size       Size of each element in the array, in bytes.
+ * @param comparator Pointer to the comparison function that defines the order of elements.
+ * @param scratch    Scratch memory of at least `nitems * size` bytes.
+ *
+ * @note This operation has linear time complexity O(N).
+ */
+void merge_sorted_runs(void *base, size_t l_nitems, size_t nitems, size_t size, compare_fn comparator, void *scratch);
+
+/**
+ * @brief Partially sorts the provided array, so that its first `k` elements are the `k` smallest ones, in order.
+ *
+ * @remark The order of the remaining elements is unspecified, and equal elements may be reordered (i.e., the
+ * sort is not stable). The `k` smallest elements are kept in a bounded max-heap while the array is scanned, then the
+ * heap is sorted in place.
+ *
+ * @param base       Pointer to the beginning of the array to be partially sorted.
+ * @param nitems     Number of elements in the array.
+ * @param size       Size of each element in the array, in bytes.
+ * @param k          The number of smallest elements to be sorted (values above `nitems` sort the whole array).
+ * @param comparator Pointer to the comparison function that defines the order of elements.
+ *
+ * @note This operation has time complexity O(N log K).
+ */
+void partial_sort(void *base, size_t nitems, size_t size, size_t k, compare_fn comparator);
+
+/**
+ * @brief Rearranges the provided array so that the element at index `nth` is the one which would be there if the
+ * array were sorted, with no greater elements before it and no smaller elements after it.
+ *
+ * @remark The selection is an introselect: quick select with median-of-three pivots over the `partition` kernel of
+ * quick sort, falling back to a heap selection when the partitions do not shrink fast enough.
+ *
+ * @param base       Pointer to the beginning of the array.
+ * @param nitems     Number of elements in the array.
+ * @param size       Size of each element in the array, in bytes.
+ * @param nth        The index of the selected element, in range `[0, nitems - 1]`.
+ * @param comparator Pointer to the comparison function that defines the order of elements.
+ *
+ * @note This operation has linear average time complexity O(N), and O(N log N) in the worst case.
+ */
+void nth_element(void *base, size_t nitems, size_t size, size_t nth, compare_fn comparator);
+
+/**
+ * @brief Selects several ranks of the provided array at once, as if `nth_element` were called for each of them.
+ *
+ * @remark Each partition step splits the requested ranks between its two sides, and only the sides containing some
+ * rank are partitioned further, so the selection of K ranks costs about as much as K levels of a quick sort.
+ *
+ * @param base       Pointer to the beginning of the array.
+ * @param nitems     Number of elements in the array.
+ * @param size       Size of each element in the array, in bytes.
+ * @param ranks      The selected indexes, in ascending order and in range `[0, nitems - 1]`.
+ * @param num_ranks  The number of selected indexes.
+ * @param comparator Pointer to the comparison function that defines the order of elements.
+ *
+ * @note This operation has time complexity O(N log K).
+ */
+void select_quantiles(void *base, size_t nitems, size_t size, const size_t *ranks, size_t num_ranks, compare_fn comparator);
+
+#ifdef _SORT_STATS
+
+/**
+ * @brief The algorithmic cost of the last sort call, collected when the library is compiled with `_SORT_STATS`.
+ *
+ * @note The statistics are kept per thread, so concurrent sorts collect their own statistics, each one retrieved by
+ * the thread which ran it.
+ */
+typedef struct SortStats
+{
+    size_t comparisons;     /** The number of comparator invocations. */
+    size_t moves;           /** The number of elements moved (copied) inside the array or to/from scratch memory. */
+    size_t bytes_copied;    /** The number of bytes copied by element moves. */
+    size_t allocations;     /** The number of scratch memory allocations. */
+    size_t bytes_allocated; /** The number of bytes of scratch memory allocated. */
+} SortStats;
+
+/**
+ * @brief Retrieves the statistics collected by the last sort call.
+ *
+ * @remark Every sorting function resets the statistics when it starts.
+ *
+ * @param stats Pointer to the structure receiving the statistics.
+ */
+void get_sort_stats(SortStats *stats);
+
+/**
+ * @brief Replaces the statistics of the last sort call of the calling thread.
+ *
+ * @remark A sort split over several threads (see `sorter_sort`) reports the sum of the statistics of its parts.
+ *
+ * @param stats Pointer to the statistics.
+ */
+void set_sort_stats(const SortStats *stats);
+
+#endif
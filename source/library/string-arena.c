@@ -0,0 +1,197 @@
+#include "string-arena.h"
+#include "diagnostics.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The initial capacity of the arena buffer, in bytes.
+ */
+#define ARENA_INITIAL_CAPACITY (1 << 16)
+
+/**
+ * The initial number of slots of the interning table (a power of two).
+ */
+#define INTERN_INITIAL_SLOTS 1024
+
+/**
+ * An empty slot of the interning table.
+ */
+#define INTERN_EMPTY_SLOT UINT32_MAX
+
+struct StringArena
+{
+    char *data;         /** The buffer of the strings. */
+    size_t size;        /** The number of bytes used. */
+    size_t capacity;    /** The capacity of the buffer. */
+    int intern;         /** Whether equal strings share the same reference. */
+    StringRef *slots;   /** The open-addressing table of the interned strings (offset INTERN_EMPTY_SLOT if empty). */
+    size_t slots_mask;  /** The number of slots, minus one. */
+    size_t num_strings; /** The number of interned strings. */
+};
+
+/**
+ * Hashes a string (FNV-1a).
+ */
+static uint32_t hash_string(const char *str, size_t length)
+{
+    uint32_t hash;
+    size_t i;
+
+    hash = 2166136261u;
+
+    for (i = 0; i < length; i++)
+        hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+
+    return hash;
+}
+
+/**
+ * Finds the slot of a string in the interning table (either the one of the equal string or an empty one).
+ */
+static StringRef *find_intern_slot(const StringArena *arena, StringRef *slots, size_t slots_mask, const char *str, size_t length)
+{
+    size_t slot;
+
+    slot = hash_string(str, length) & slots_mask;
+
+    while (slots[slot].offset != INTERN_EMPTY_SLOT &&
+           (slots[slot].length != length || memcmp(arena->data + slots[slot].offset, str, length)))
+        slot = (slot + 1) & slots_mask;
+
+    return &slots[slot];
+}
+
+/**
+ * Allocates an empty interning table.
+ */
+static StringRef *allocate_intern_slots(size_t num_slots)
+{
+    StringRef *slots;
+    size_t i;
+
+    slots = malloc(sizeof(StringRef) * num_slots);
+    ASSERT(slots, "Unable to allocate memory for the interning table", allocate_intern_slots);
+
+    for (i = 0; i < num_slots; i++)
+        slots[i].offset = INTERN_EMPTY_SLOT;
+
+    return slots;
+}
+
+/**
+ * Doubles the number of slots of the interning table.
+ */
+static void grow_intern_slots(StringArena *arena)
+{
+    StringRef *slots;
+    size_t slots_mask, i;
+
+    slots_mask = arena->slots_mask * 2 + 1;
+    slots = allocate_intern_slots(slots_mask + 1);
+
+    for (i = 0; i <= arena->slots_mask; i++)
+    {
+        if (arena->slots[i].offset != INTERN_EMPTY_SLOT)
+            *find_intern_slot(arena, slots, slots_mask, arena->data + arena->slots[i].offset, arena->slots[i].length) = arena->slots[i];
+    }
+
+    free(arena->slots);
+    arena->slots = slots;
+    arena->slots_mask = slots_mask;
+}
+
+StringArena *create_string_arena(int intern)
+{
+    StringArena *arena;
+
+    arena = calloc(1, sizeof(StringArena));
+    ASSERT(arena, "Unable to allocate memory for the string arena", create_string_arena);
+
+    arena->capacity = ARENA_INITIAL_CAPACITY;
+    arena->data = malloc(arena->capacity);
+    ASSERT(arena->data, "Unable to allocate memory for the string arena", create_string_arena);
+
+    arena->intern = intern;
+
+    if (intern)
+    {
+        arena->slots = allocate_intern_slots(INTERN_INITIAL_SLOTS);
+        arena->slots_mask = INTERN_INITIAL_SLOTS - 1;
+    }
+
+    return arena;
+}
+
+void destroy_string_arena(StringArena *arena)
+{
+    ASSERT_NULL_PARAMETER(arena, destroy_string_arena);
+
+    free(arena->data);
+    free(arena->slots);
+    free(arena);
+}
+
+StringRef add_arena_string(StringArena *arena, const char *str, size_t length)
+{
+    StringRef *slot;
+    StringRef ref;
+
+    ASSERT_NULL_PARAMETER(arena, add_arena_string);
+    ASSERT(str || !length, "'str' parameter is NULL", add_arena_string);
+
+    slot = NULL;
+
+    if (arena->intern)
+    {
+        slot = find_intern_slot(arena, arena->slots, arena->slots_mask, str, length);
+
+        if (slot->offset != INTERN_EMPTY_SLOT)
+            return *slot;
+    }
+
+    ASSERT(arena->size + length + 1 < INTERN_EMPTY_SLOT, "The string arena is full (4 GiB)", add_arena_string);
+
+    if (arena->size + length + 1 > arena->capacity)
+    {
+        while (arena->size + length + 1 > arena->capacity)
+            arena->capacity *= 2;
+
+        arena->data = realloc(arena->data, arena->capacity);
+        ASSERT(arena->data, "Unable to allocate memory for the string arena", add_arena_string);
+    }
+
+    memcpy(arena->data + arena->size, str, length);
+    arena->data[arena->size + length] = '\0';
+
+    ref.offset = (uint32_t)arena->size;
+    ref.length = (uint32_t)length;
+    arena->size += length + 1;
+
+    if (slot)
+    {
+        *slot = ref;
+
+        // Keep the table at most half full, so that probe sequences stay short.
+        if (++arena->num_strings * 2 > arena->slots_mask + 1)
+            grow_intern_slots(arena);
+    }
+
+    return ref;
+}
+
+const char *get_arena_string(const StringArena *arena, StringRef ref)
+{
+    return arena->data + ref.offset;
+}
+
+size_t get_string_arena_size(const StringArena *arena)
+{
+    ASSERT_NULL_PARAMETER(arena, get_string_arena_size);
+    return arena->size;
+}
+
+int is_string_arena_interning(const StringArena *arena)
+{
+    ASSERT_NULL_PARAMETER(arena, is_string_arena_interning);
+    return arena->intern;
+}
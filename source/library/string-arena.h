@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief A reference to a string stored in a `StringArena`.
+ */
+typedef struct StringRef
+{
+    uint32_t offset; /** The offset of the string in the arena. */
+    uint32_t length; /** The length of the string, in bytes. */
+} StringRef;
+
+/**
+ * @brief A contiguous buffer of strings of any length, referenced by offset, optionally storing each distinct
+ * string only once (interning).
+ *
+ * @remark Strings are null-terminated in the arena, but their length is also stored in their reference. Since the
+ * buffer may be reallocated while strings are added, pointers returned by `get_arena_string` are only valid until
+ * the next string is added.
+ */
+typedef struct StringArena StringArena;
+
+/**
+ * @brief Creates an empty string arena.
+ *
+ * @param intern Whether equal strings share the same reference (i.e., each distinct string is stored once).
+ * @return The created arena.
+ */
+StringArena *create_string_arena(int intern);
+
+/**
+ * @brief Destroys the specified string arena (invalidating every reference to its strings).
+ *
+ * @param arena The arena to be destroyed.
+ */
+void destroy_string_arena(StringArena *arena);
+
+/**
+ * @brief Adds a string to the specified arena.
+ *
+ * @param arena  The arena.
+ * @param str    The string (which does not need to be null-terminated).
+ * @param length The length of the string, in bytes.
+ * @return The reference to the stored string (the existing one, if the arena interns strings and an equal string
+ * has already been added).
+ */
+StringRef add_arena_string(StringArena *arena, const char *str, size_t length);
+
+/**
+ * @brief Retrieves the null-terminated string referenced by `ref`.
+ *
+ * @param arena The arena.
+ * @param ref   The reference to the string.
+ * @return The string.
+ */
+const char *get_arena_string(const StringArena *arena, StringRef ref);
+
+/**
+ * @brief Retrieves the number of bytes stored in the specified arena.
+ *
+ * @param arena The arena.
+ * @return The number of bytes stored in the arena (terminators included).
+ */
+size_t get_string_arena_size(const StringArena *arena);
+
+/**
+ * @brief Tests whether the specified arena interns its strings.
+ *
+ * @param arena The arena.
+ * @return Non-zero if equal strings share the same reference.
+ */
+int is_string_arena_interning(const StringArena *arena);
@@ -0,0 +1,147 @@
+#include "tuning-config.h"
+#include "diagnostics.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The size of the chunks in which the lines of the configuration file are read (longer lines are read in several
+ * chunks), larger than any key.
+ */
+#define CONFIG_CHUNK_LEN 256
+
+/**
+ * The suffix of the temporary file written in place of the configuration file.
+ */
+#define CONFIG_TEMP_SUFFIX ".tmp"
+
+/**
+ * Builds the configuration key of a threshold.
+ */
+static void build_threshold_key(char *key, const char *field_name, size_t record_size)
+{
+    sprintf(key, "mergebininssort.threshold.%.32s.%zu", field_name, record_size);
+}
+
+const char *get_tuning_config_path(void)
+{
+    const char *path;
+
+    path = getenv(TUNING_CONFIG_ENV);
+    return path && *path ? path : DEFAULT_TUNING_CONFIG_PATH;
+}
+
+int read_tuned_threshold(const char *path, const char *field_name, size_t record_size, size_t *threshold)
+{
+    FILE *config_file;
+    char key[CONFIG_CHUNK_LEN], line[CONFIG_CHUNK_LEN];
+    size_t key_len;
+    int found, line_start;
+
+    ASSERT_NULL_PARAMETER(path, read_tuned_threshold);
+    ASSERT_NULL_PARAMETER(field_name, read_tuned_threshold);
+    ASSERT_NULL_PARAMETER(threshold, read_tuned_threshold);
+
+    config_file = fopen(path, "r");
+
+    if (!config_file)
+        return 0;
+
+    build_threshold_key(key, field_name, record_size);
+    key_len = strlen(key);
+    found = 0;
+    line_start = 1;
+
+    while (!found && fgets(line, sizeof(line), config_file))
+    {
+        // Only the first chunk of a line can hold its key.
+        if (line_start && !strncmp(line, key, key_len) && line[key_len] == '=')
+            found = sscanf(line + key_len + 1, "%zu", threshold) == 1 && *threshold > 1;
+
+        line_start = line[strlen(line) - 1] == '\n';
+    }
+
+    ASSERT(!fclose(config_file), "Unable to close the tuning configuration file", read_tuned_threshold);
+
+    return found;
+}
+
+void write_tuned_threshold(const char *path, const char *field_name, size_t record_size, size_t threshold)
+{
+    FILE *config_file, *temp_file;
+    char key[CONFIG_CHUNK_LEN], line[CONFIG_CHUNK_LEN];
+    char *temp_path;
+    size_t key_len;
+    int replaced, line_start, skipping;
+
+    ASSERT_NULL_PARAMETER(path, write_tuned_threshold);
+    ASSERT_NULL_PARAMETER(field_name, write_tuned_threshold);
+    ASSERT(threshold > 1, "The threshold must be greater than one", write_tuned_threshold);
+
+    build_threshold_key(key, field_name, record_size);
+    key_len = strlen(key);
+
+    // The configuration is streamed into a temporary file, which then replaces it, so that no line is lost whatever
+    // the length of the file and of its lines.
+    temp_path = malloc(strlen(path) + sizeof(CONFIG_TEMP_SUFFIX));
+    ASSERT(temp_path, "Unable to allocate memory for the path of the temporary configuration file", write_tuned_threshold);
+    sprintf(temp_path, "%s%s", path, CONFIG_TEMP_SUFFIX);
+
+    temp_file = fopen(temp_path, "w");
+    ASSERT(temp_file, "Unable to open the temporary tuning configuration file for writing", write_tuned_threshold);
+
+    config_file = fopen(path, "r");
+    replaced = 0;
+    line_start = 1;
+
+    if (config_file)
+    {
+        skipping = 0;
+
+        while (fgets(line, sizeof(line), config_file))
+        {
+            // The lines of the key are replaced by a single one (the rest of a long line is skipped).
+            if (line_start && !strncmp(line, key, key_len) && line[key_len] == '=')
+            {
+                if (!replaced)
+                    ASSERT(fprintf(temp_file, "%s=%zu\n", key, threshold) > 0, "Unable to write the tuning configuration file", write_tuned_threshold);
+
+                replaced = 1;
+                skipping = 1;
+            }
+            else if (line_start)
+            {
+                skipping = 0;
+            }
+
+            if (!skipping)
+                ASSERT(fputs(line, temp_file) >= 0, "Unable to write the tuning configuration file", write_tuned_threshold);
+
+            line_start = line[strlen(line) - 1] == '\n';
+        }
+
+        ASSERT(!ferror(config_file), "Unable to read the tuning configuration file", write_tuned_threshold);
+        ASSERT(!fclose(config_file), "Unable to close the tuning configuration file", write_tuned_threshold);
+    }
+    else
+    {
+        ASSERT(fputs("# Tuning configuration of the sorting library (generated by 'sorting_profiler --tune').\n", temp_file) >= 0,
+               "Unable to write the tuning configuration file", write_tuned_threshold);
+    }
+
+    if (!replaced)
+    {
+        // The last line might not be terminated.
+        ASSERT(fprintf(temp_file, "%s%s=%zu\n", line_start ? "" : "\n", key, threshold) > 0, "Unable to write the tuning configuration file", write_tuned_threshold);
+    }
+
+    ASSERT(!fclose(temp_file), "Unable to close the temporary tuning configuration file", write_tuned_threshold);
+
+#ifdef _WIN32
+    // The target of a rename cannot exist on Windows.
+    remove(path);
+#endif
+
+    ASSERT(!rename(temp_path, path), "Unable to replace the tuning configuration file", write_tuned_threshold);
+
+    free(temp_path);
+}
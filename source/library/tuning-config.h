@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * The environment variable which overrides the path of the tuning configuration file.
+ */
+#define TUNING_CONFIG_ENV "SORTING_CONFIG"
+
+/**
+ * The default path of the tuning configuration file.
+ */
+#define DEFAULT_TUNING_CONFIG_PATH "sorting.cfg"
+
+/**
+ * @brief Retrieves the path of the tuning configuration file.
+ *
+ * @return The value of the `SORTING_CONFIG` environment variable if set, `DEFAULT_TUNING_CONFIG_PATH` otherwise.
+ */
+const char *get_tuning_config_path(void);
+
+/**
+ * @brief Reads the tuned merge binary insertion sort threshold for the specified field and record size.
+ *
+ * @remark The configuration file is made of `key=value` lines (lines starting with `#` are comments), where the
+ * thresholds have keys in the form `mergebininssort.threshold.<field_name>.<record_size>`.
+ *
+ * @param path        The path of the configuration file.
+ * @param field_name  The name of the sorted field (e.g., `STRING`).
+ * @param record_size The size of the sorted records, in bytes.
+ * @param threshold   Pointer to the variable receiving the threshold.
+ * @return A non-zero value if the threshold has been found, zero otherwise (including a missing file).
+ */
+int read_tuned_threshold(const char *path, const char *field_name, size_t record_size, size_t *threshold);
+
+/**
+ * @brief Writes the tuned merge binary insertion sort threshold for the specified field and record size.
+ *
+ * @remark The other lines of an existing configuration file are preserved, whatever their number and length: the
+ * file is streamed into `<path>.tmp`, replacing the line of the threshold (or appending it), which then replaces
+ * the file.
+ *
+ * @param path        The path of the configuration file.
+ * @param field_name  The name of the sorted field (e.g., `STRING`).
+ * @param record_size The size of the sorted records, in bytes.
+ * @param threshold   The threshold.
+ */
+void write_tuned_threshold(const char *path, const char *field_name, size_t record_size, size_t threshold);
@@ -1,7 +1,12 @@
+#include <locale.h>
 #include <stdlib.h>
 #include <string.h>
+#include "compressed-io.h"
 #include "diagnostics.h"
+#include "memory-usage.h"
+#include "records-index.h"
 #include "records-sorter.h"
+#include "records-store.h"
 
 /**
  * Defines constants for indexing `argv`.
@@ -15,23 +20,173 @@ enum Args
     OPTARG_THRESHOLD
 };
 
+/**
+ * Parses a comma-separated list of percentiles (e.g., `50,90,99`).
+ */
+static void parse_quantiles(const char *list, SortOptions *options)
+{
+    int consumed;
+
+    options->num_quantiles = 0;
+
+    do
+    {
+        ASSERT(options->num_quantiles < MAX_QUANTILES, "Too many quantiles", parse_quantiles);
+        ASSERT(sscanf(list, "%lf%n", &options->quantiles[options->num_quantiles], &consumed) == 1, "The quantiles have not been correctly specified", parse_quantiles);
+        ASSERT(options->quantiles[options->num_quantiles] > 0 && options->quantiles[options->num_quantiles] <= 100, "The quantiles must be in range (0, 100]", parse_quantiles);
+
+        options->num_quantiles++;
+        list += consumed;
+    } while (*list++ == ',');
+}
+
+/**
+ * Parses the options preceding the positional arguments, returning their number.
+ */
+static int parse_options(int argc, char *argv[], SortOptions *options)
+{
+    int i;
+
+    init_sort_options(options);
+
+    for (i = 1; i < argc && !strncmp(argv[i], "--", 2); i++)
+    {
+        if (!strcmp(argv[i], "--pipeline"))
+        {
+            options->pipeline = 1;
+        }
+        else if (!strcmp(argv[i], "--chunk-records"))
+        {
+            ASSERT(++i < argc, "Wrong number of arguments (number of records per chunk not found)", parse_options);
+            ASSERT(sscanf(argv[i], "%zu", &options->chunk_records) == 1 && options->chunk_records > 0, "The number of records per chunk has not been correctly specified", parse_options);
+        }
+        else if (!strcmp(argv[i], "--limit"))
+        {
+            ASSERT(++i < argc, "Wrong number of arguments (limit not found)", parse_options);
+            ASSERT(sscanf(argv[i], "%zu", &options->limit) == 1 && options->limit > 0, "The limit has not been correctly specified", parse_options);
+        }
+        else if (!strcmp(argv[i], "--quantiles"))
+        {
+            ASSERT(++i < argc, "Wrong number of arguments (quantiles not found)", parse_options);
+            parse_quantiles(argv[i], options);
+        }
+        else if (!strcmp(argv[i], "--string-arena"))
+        {
+            options->string_arena = 1;
+        }
+        else if (!strcmp(argv[i], "--intern"))
+        {
+            options->string_arena = 1;
+            options->intern_strings = 1;
+        }
+        else if (!strcmp(argv[i], "--collate"))
+        {
+            // The collation of the environment (LC_ALL, LC_COLLATE or LANG), instead of the byte order of "C".
+            ASSERT(setlocale(LC_COLLATE, ""), "The locale of the environment is not available", parse_options);
+            options->string_arena = 1;
+            options->collate = 1;
+        }
+        else if (!strcmp(argv[i], "--ignore-case"))
+        {
+            options->string_arena = 1;
+            options->fold_case = 1;
+        }
+        else if (!strcmp(argv[i], "--natural"))
+        {
+            options->string_arena = 1;
+            options->natural_order = 1;
+        }
+        else if (!strcmp(argv[i], "--layout"))
+        {
+            ASSERT(++i < argc, "Wrong number of arguments (layout not found)", parse_options);
+            ASSERT(!strcmp(argv[i], "rows") || !strcmp(argv[i], "columnar"), "The layout has not been correctly specified (valid: rows, columnar)", parse_options);
+            options->layout = !strcmp(argv[i], "columnar") ? LAYOUT_COLUMNAR : LAYOUT_ROWS;
+        }
+        else if (!strcmp(argv[i], "--unique"))
+        {
+            options->aggregate = AGGREGATE_UNIQUE;
+        }
+        else if (!strcmp(argv[i], "--group-count"))
+        {
+            options->aggregate = AGGREGATE_COUNT;
+        }
+        else if (!strcmp(argv[i], "--group-sum"))
+        {
+            ASSERT(++i < argc, "Wrong number of arguments (summed field not found)", parse_options);
+            options->aggregate = AGGREGATE_SUM;
+
+            if (!strcmp(argv[i], "field2") || !strcmp(argv[i], "INTEGER") || !strcmp(argv[i], "FIELD_INTEGER") || !strcmp(argv[i], "2"))
+                options->sum_field_id = FIELD_INTEGER;
+            else if (!strcmp(argv[i], "field3") || !strcmp(argv[i], "FLOAT") || !strcmp(argv[i], "FIELD_FLOAT") || !strcmp(argv[i], "3"))
+                options->sum_field_id = FIELD_FLOAT;
+            else
+                PRINT_ERROR("The summed field has not been correctly specified (valid: field2, field3)", parse_options);
+        }
+        else if (!strcmp(argv[i], "--verify"))
+        {
+            options->verify = 1;
+        }
+        else if (!strcmp(argv[i], "--max-memory"))
+        {
+            ASSERT(++i < argc, "Wrong number of arguments (memory budget not found)", parse_options);
+            ASSERT(parse_memory_size(argv[i], &options->max_memory), "The memory budget has not been correctly specified (e.g., 512M)", parse_options);
+        }
+        else if (!strcmp(argv[i], "--index"))
+        {
+            ASSERT(++i < argc, "Wrong number of arguments (number of records between index entries not found)", parse_options);
+            ASSERT(sscanf(argv[i], "%zu", &options->index_every) == 1 && options->index_every > 0, "The number of records between index entries has not been correctly specified", parse_options);
+        }
+        else
+        {
+            PRINT_ERROR("Unknown option", parse_options);
+        }
+    }
+
+    return i - 1;
+}
+
+/**
+ * Sets the path of the index file beside the output, if requested by the options (the returned path is to be freed).
+ */
+static char *make_index_path(const char *out_path, SortOptions *options)
+{
+    char *index_path;
+
+    if (!options->index_every)
+        return NULL;
+
+    ASSERT(!is_gzip_path(out_path), "The index is not available for gzipped outputs", make_index_path);
+
+    // The index is saved beside the output, whose offsets must match the bytes of the file.
+    index_path = malloc(strlen(out_path) + sizeof(INDEX_FILE_EXTENSION));
+    ASSERT(index_path, "Unable to allocate memory for the index path", make_index_path);
+
+    strcpy(index_path, out_path);
+    strcat(index_path, INDEX_FILE_EXTENSION);
+    options->index_path = index_path;
+
+    return index_path;
+}
+
 /**
  * Processes the input file.
  */
-static void process_file(const char *in_path, const char *out_path, FieldId field_id, AlgorithmId algorithm_id, void* param)
+static void process_file(const char *in_path, const char *out_path, FieldId field_id, AlgorithmId algorithm_id, void* param, SortOptions *options)
 {
     FILE *in_file, *out_file;
+    char *index_path;
 
-    in_file = fopen(in_path, "r");
-    ASSERT(in_file, "Unable to open input file", process_file);
+    index_path = make_index_path(out_path, options);
 
-    out_file = fopen(out_path, "w");
-    ASSERT(out_file, "Unable to open output file", process_file);
+    in_file = open_input_file(in_path);
+    out_file = open_output_file(out_path, options->index_every);
 
-    sort_records(in_file, out_file, field_id, algorithm_id, param);
+    sort_records_with_options(in_file, out_file, field_id, algorithm_id, param, options);
 
     ASSERT(!fclose(out_file), "Unable to close output file", process_file);
     ASSERT(!fclose(in_file), "Unable to close input file", process_file);
+
+    free(index_path);
 }
 
 /**
@@ -45,32 +200,18 @@ static void process_file(const char *in_path, const char *out_path, FieldId fiel
 #define TEST_STR_ALGORITHM_ID(value, str) (!strcmp("ALGORITHM_" value, str) || !strcmp(value, str))
 
 /**
- * Entry point.
+ * Parses a field id, either numeric or by name (e.g., `INTEGER` or `FIELD_INTEGER`).
  */
-int main(int argc, char *argv[])
+static FieldId parse_field_id(const char *arg)
 {
-    const char *in_path;
-    const char *out_path;
     FieldId field_id;
-    AlgorithmId algorithm_id;
     char field_id_str[24];
-    char algorithm_id_str[24];
-    int threshold;
-
-    ASSERT(argc > ARG_IN_FILE_PATH, "Wrong number of arguments (input file path not found)", main);
-    ASSERT(argc > ARG_OUT_FILE_PATH, "Wrong number of arguments (output file path not found)", main);
-    ASSERT(argc > ARG_FIELD_ID, "Wrong number of arguments (field id not found)", main);
-    ASSERT(argc > ARG_ALGORITHM_ID, "Wrong number of arguments (algorithm id not found)", main);
 
-    in_path = argv[ARG_IN_FILE_PATH];
-    out_path = argv[ARG_OUT_FILE_PATH];
     field_id = -1;
-    algorithm_id = -1;
-    threshold = -1;
 
-    if (sscanf(argv[ARG_FIELD_ID], "%d", (int *)&field_id) != 1)
+    if (sscanf(arg, "%d", (int *)&field_id) != 1)
     {
-        if (sscanf(argv[ARG_FIELD_ID], "%s", field_id_str) == 1)
+        if (sscanf(arg, "%23s", field_id_str) == 1)
         {
             if (TEST_STR_FIELD_ID("STRING", field_id_str))
                 field_id = FIELD_STRING;
@@ -84,13 +225,26 @@ int main(int argc, char *argv[])
         else
         {
         ERROR_FIELD_ID:
-            PRINT_ERROR("The field id has not been correctly specified", main);
+            PRINT_ERROR("The field id has not been correctly specified", parse_field_id);
         }
     }
 
-    if (sscanf(argv[ARG_ALGORITHM_ID], "%d", (int *)&algorithm_id) != 1)
+    return field_id;
+}
+
+/**
+ * Parses an algorithm id, either numeric or by name (e.g., `QUICKSORT` or `ALGORITHM_QUICKSORT`).
+ */
+static AlgorithmId parse_algorithm_id(const char *arg)
+{
+    AlgorithmId algorithm_id;
+    char algorithm_id_str[24];
+
+    algorithm_id = -1;
+
+    if (sscanf(arg, "%d", (int *)&algorithm_id) != 1)
     {
-        if (sscanf(argv[ARG_ALGORITHM_ID], "%s", algorithm_id_str) == 1)
+        if (sscanf(arg, "%23s", algorithm_id_str) == 1)
         {
             if (TEST_STR_ALGORITHM_ID("MERGESORT", algorithm_id_str))
                 algorithm_id = ALGORITHM_MERGESORT;
@@ -100,25 +254,247 @@ int main(int argc, char *argv[])
                 algorithm_id = ALGORITHM_BININSSORT;
             else if (TEST_STR_ALGORITHM_ID("MERGEBININSSORT", algorithm_id_str))
                 algorithm_id = ALGORITHM_MERGEBININSSORT;
+            else if (TEST_STR_ALGORITHM_ID("AUTO", algorithm_id_str))
+                algorithm_id = ALGORITHM_AUTO;
             else
                 goto ERROR_ALGORITHM_ID;
         }
         else
         {
         ERROR_ALGORITHM_ID:
-            PRINT_ERROR("The algorithm id has not been correctly specified", main);
+            PRINT_ERROR("The algorithm id has not been correctly specified", parse_algorithm_id);
         }
     }
 
-    if (algorithm_id == ALGORITHM_MERGEBININSSORT) {
+    return algorithm_id;
+}
 
-        ASSERT(argc > OPTARG_THRESHOLD, "Wrong number of arguments (merge binary insertion sort threshold not found)", main);
+/**
+ * Parses the optional threshold argument at the specified index (zero if missing, to use the tuned one).
+ */
+static int parse_threshold(int argc, char *argv[], int index, AlgorithmId algorithm_id)
+{
+    int threshold;
+
+    threshold = 0;
+
+    // Without an explicit threshold, the tuned one (or the default one) is used (also if AUTO selects merge binary insertion sort).
+    if ((algorithm_id == ALGORITHM_MERGEBININSSORT || algorithm_id == ALGORITHM_AUTO) && argc > index) {
 
-        threshold = atoi(argv[OPTARG_THRESHOLD]);
-        ASSERT(threshold > 1, "Merge binary insertion sort threshold must be greater than one", main);
+        threshold = atoi(argv[index]);
+        ASSERT(threshold > 1, "Merge binary insertion sort threshold must be greater than one", parse_threshold);
     }
 
-    process_file(in_path, out_path, field_id, algorithm_id, (void*)(size_t)threshold);
+    return threshold;
+}
+
+/**
+ * Defines constants for indexing `argv` in the store subcommands.
+ */
+enum StoreArgs
+{
+    ARG_STORE_PATH = 2,
+    ARG_STORE_FILE_PATH, // The input file of `append`, the output file of `read`.
+    ARG_STORE_FIELD_ID,
+    ARG_STORE_ALGORITHM_ID,
+    OPTARG_STORE_THRESHOLD
+};
+
+/**
+ * Runs the `append` subcommand, appending the records of a file to a store.
+ */
+static void run_append_command(int argc, char *argv[])
+{
+    FILE *in_file;
+    AlgorithmId algorithm_id;
+
+    ASSERT(argc > ARG_STORE_PATH, "Wrong number of arguments (store path not found)", run_append_command);
+    ASSERT(argc > ARG_STORE_FILE_PATH, "Wrong number of arguments (input file path not found)", run_append_command);
+    ASSERT(argc > ARG_STORE_FIELD_ID, "Wrong number of arguments (field id not found)", run_append_command);
+    ASSERT(argc > ARG_STORE_ALGORITHM_ID, "Wrong number of arguments (algorithm id not found)", run_append_command);
+
+    algorithm_id = parse_algorithm_id(argv[ARG_STORE_ALGORITHM_ID]);
+
+    in_file = open_input_file(argv[ARG_STORE_FILE_PATH]);
+
+    append_to_store(argv[ARG_STORE_PATH], in_file, parse_field_id(argv[ARG_STORE_FIELD_ID]), algorithm_id,
+                    (void *)(size_t)parse_threshold(argc, argv, OPTARG_STORE_THRESHOLD, algorithm_id));
+
+    ASSERT(!fclose(in_file), "Unable to close input file", run_append_command);
+}
+
+/**
+ * Runs the `read` subcommand, writing the sorted records of a store.
+ */
+static void run_read_command(int argc, char *argv[])
+{
+    FILE *out_file;
+
+    ASSERT(argc > ARG_STORE_PATH, "Wrong number of arguments (store path not found)", run_read_command);
+    ASSERT(argc > ARG_STORE_FILE_PATH, "Wrong number of arguments (output file path not found)", run_read_command);
+
+    out_file = open_output_file(argv[ARG_STORE_FILE_PATH], 0);
+
+    read_store(argv[ARG_STORE_PATH], out_file);
+
+    ASSERT(!fclose(out_file), "Unable to close output file", run_read_command);
+}
+
+/**
+ * Defines constants for indexing `argv` in the batch subcommand.
+ */
+enum BatchArgs
+{
+    ARG_BATCH_IN_FILE_PATH = 2,
+    ARG_BATCH_FIRST_JOB, // Each job is an output file path, a field id and an algorithm id.
+    BATCH_JOB_ARGS = 3
+};
+
+/**
+ * Runs the `batch` subcommand, sorting the records of a file in several orders with a single load.
+ */
+static void run_batch_command(int argc, char *argv[], SortOptions *options)
+{
+    SortJob jobs[MAX_SORT_JOBS];
+    char *index_paths[MAX_SORT_JOBS];
+    FILE *in_file;
+    size_t num_jobs, i;
+    int arg;
+
+    ASSERT(argc > ARG_BATCH_IN_FILE_PATH, "Wrong number of arguments (input file path not found)", run_batch_command);
+    ASSERT(argc > ARG_BATCH_FIRST_JOB && (argc - ARG_BATCH_FIRST_JOB) % BATCH_JOB_ARGS == 0,
+           "Wrong number of arguments (each job is an output file path, a field id and an algorithm id)", run_batch_command);
+
+    num_jobs = (size_t)(argc - ARG_BATCH_FIRST_JOB) / BATCH_JOB_ARGS;
+    ASSERT(num_jobs <= MAX_SORT_JOBS, "Too many sort jobs", run_batch_command);
+
+    for (i = 0; i < num_jobs; i++)
+    {
+        arg = ARG_BATCH_FIRST_JOB + (int)i * BATCH_JOB_ARGS;
+
+        jobs[i].field_id = parse_field_id(argv[arg + 1]);
+        jobs[i].algorithm_id = parse_algorithm_id(argv[arg + 2]);
+        jobs[i].param = NULL;
+        jobs[i].index_path = index_paths[i] = make_index_path(argv[arg], options);
+
+        jobs[i].out_file = open_output_file(argv[arg], options->index_every);
+    }
+
+    in_file = open_input_file(argv[ARG_BATCH_IN_FILE_PATH]);
+
+    sort_records_batch(in_file, jobs, num_jobs, options);
+
+    ASSERT(!fclose(in_file), "Unable to close input file", run_batch_command);
+
+    for (i = 0; i < num_jobs; i++)
+    {
+        ASSERT(!fclose(jobs[i].out_file), "Unable to close output file", run_batch_command);
+        free(index_paths[i]);
+    }
+}
+
+/**
+ * Defines constants for indexing `argv` in the query subcommand.
+ */
+enum QueryArgs
+{
+    ARG_QUERY_FILE_PATH = 2,
+    ARG_QUERY_LOW_KEY,
+    OPTARG_QUERY_HIGH_KEY // The low key if missing (point lookup).
+};
+
+/**
+ * Runs the `query` subcommand, printing the records of an indexed sorted file whose key is in a range.
+ */
+static void run_query_command(int argc, char *argv[])
+{
+    ASSERT(argc > ARG_QUERY_FILE_PATH, "Wrong number of arguments (sorted file path not found)", run_query_command);
+    ASSERT(argc > ARG_QUERY_LOW_KEY, "Wrong number of arguments (key not found)", run_query_command);
+
+    query_sorted_file(argv[ARG_QUERY_FILE_PATH], argv[ARG_QUERY_LOW_KEY],
+                      argc > OPTARG_QUERY_HIGH_KEY ? argv[OPTARG_QUERY_HIGH_KEY] : argv[ARG_QUERY_LOW_KEY], stdout);
+}
+
+/**
+ * Defines constants for indexing `argv` in the merge subcommand.
+ */
+enum MergeArgs
+{
+    ARG_MERGE_OUT_FILE_PATH = 2,
+    ARG_MERGE_FIELD_ID,
+    ARG_MERGE_FIRST_IN_FILE_PATH
+};
+
+/**
+ * Runs the `merge` subcommand, merging files already sorted by the same field.
+ */
+static void run_merge_command(int argc, char *argv[], SortOptions *options)
+{
+    FILE *out_file;
+    char *index_path;
+    const char *out_path;
+
+    ASSERT(argc > ARG_MERGE_OUT_FILE_PATH, "Wrong number of arguments (output file path not found)", run_merge_command);
+    ASSERT(argc > ARG_MERGE_FIELD_ID, "Wrong number of arguments (field id not found)", run_merge_command);
+    ASSERT(argc > ARG_MERGE_FIRST_IN_FILE_PATH, "Wrong number of arguments (input file paths not found)", run_merge_command);
+
+    out_path = argv[ARG_MERGE_OUT_FILE_PATH];
+    index_path = make_index_path(out_path, options);
+
+    out_file = open_output_file(out_path, options->index_every);
+
+    merge_records_files((const char *const *)&argv[ARG_MERGE_FIRST_IN_FILE_PATH], (size_t)(argc - ARG_MERGE_FIRST_IN_FILE_PATH), out_file,
+                        parse_field_id(argv[ARG_MERGE_FIELD_ID]), options);
+
+    ASSERT(!fclose(out_file), "Unable to close output file", run_merge_command);
+    free(index_path);
+}
+
+/**
+ * Entry point.
+ */
+int main(int argc, char *argv[])
+{
+    FieldId field_id;
+    AlgorithmId algorithm_id;
+    int threshold, num_options;
+    SortOptions options;
+
+    num_options = parse_options(argc, argv, &options);
+    argv[num_options] = argv[0];
+    argv += num_options;
+    argc -= num_options;
+
+    // The query prints the records to the standard output, so it prints nothing else.
+    if (argc > 1 && !strcmp(argv[1], "query"))
+    {
+        run_query_command(argc, argv);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "append"))
+        run_append_command(argc, argv);
+    else if (argc > 1 && !strcmp(argv[1], "read"))
+        run_read_command(argc, argv);
+    else if (argc > 1 && !strcmp(argv[1], "batch"))
+        run_batch_command(argc, argv, &options);
+    else if (argc > 1 && !strcmp(argv[1], "merge"))
+        run_merge_command(argc, argv, &options);
+    else
+    {
+        ASSERT(argc > ARG_IN_FILE_PATH, "Wrong number of arguments (input file path not found)", main);
+        ASSERT(argc > ARG_OUT_FILE_PATH, "Wrong number of arguments (output file path not found)", main);
+        ASSERT(argc > ARG_FIELD_ID, "Wrong number of arguments (field id not found)", main);
+        ASSERT(argc > ARG_ALGORITHM_ID, "Wrong number of arguments (algorithm id not found)", main);
+
+        field_id = parse_field_id(argv[ARG_FIELD_ID]);
+        algorithm_id = parse_algorithm_id(argv[ARG_ALGORITHM_ID]);
+        threshold = parse_threshold(argc, argv, OPTARG_THRESHOLD, algorithm_id);
+
+        process_file(argv[ARG_IN_FILE_PATH], argv[ARG_OUT_FILE_PATH], field_id, algorithm_id, (void*)(size_t)threshold, &options);
+    }
+
+    print_memory_report(stdout, options.max_memory);
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -1,7 +1,12 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "compressed-io.h"
 #include "diagnostics.h"
+#include "perf-counters.h"
 #include "records-sorter.h"
+#include "tuning-config.h"
 
 #define PROFILER_PRINT(msg) printf("[PROFILER]: " msg "\n")
 
@@ -13,14 +18,224 @@ enum Args
 
 #define DEFAULT_THRESHOLD (void*)50
 
+/**
+ * The default number of records used to tune the thresholds.
+ */
+#define DEFAULT_TUNE_SAMPLE 1000000
+
+/**
+ * The bounds of the tuned thresholds search space, as base 2 logarithms (i.e., thresholds in [2, 2048]).
+ */
+#define TUNE_MIN_LOG2 1.0
+#define TUNE_MAX_LOG2 11.0
+
+/**
+ * The width of the search interval (as base 2 logarithm) under which the tuning stops.
+ */
+#define TUNE_TOLERANCE_LOG2 0.1
+
+/**
+ * The number of measurements of each threshold (the fastest one is kept).
+ */
+#define TUNE_REPETITIONS 3
+
+/**
+ * The max number of thresholds measured while tuning a field.
+ */
+#define TUNE_MAX_MEASURES 64
+
+/**
+ * The options of the profiler.
+ */
+typedef struct ProfilerOptions
+{
+    int tune;           /** Whether the thresholds are tuned instead of profiling the algorithms. */
+    size_t tune_sample; /** The number of records used to tune the thresholds. */
+} ProfilerOptions;
+
+/**
+ * Parses the leading `--option` arguments, returning the number of consumed arguments.
+ */
+static int parse_options(int argc, char *argv[], ProfilerOptions *options)
+{
+    int i, opened;
+
+    options->tune = 0;
+    options->tune_sample = DEFAULT_TUNE_SAMPLE;
+
+    for (i = 1; i < argc && !strncmp(argv[i], "--", 2); i++)
+    {
+        if (!strcmp(argv[i], "--perf"))
+        {
+            opened = perf_counters_open();
+
+            if (opened > 0)
+                printf("[PROFILER]: Hardware performance counters enabled (%d/%d available).\n", opened, PERF_COUNTER_COUNT);
+            else
+                PROFILER_PRINT("Hardware performance counters are not available, profiling timings only.");
+        }
+        else if (!strcmp(argv[i], "--layout"))
+        {
+            ASSERT(++i < argc, "Wrong number of arguments passed (layout not found)", parse_options);
+            ASSERT(!strcmp(argv[i], "rows") || !strcmp(argv[i], "columnar"), "The layout has not been correctly specified (valid: rows, columnar)", parse_options);
+            set_layout__records_sorter(!strcmp(argv[i], "columnar") ? LAYOUT_COLUMNAR : LAYOUT_ROWS);
+        }
+        else if (!strcmp(argv[i], "--tune"))
+        {
+            options->tune = 1;
+        }
+        else if (!strcmp(argv[i], "--tune-sample"))
+        {
+            ASSERT(++i < argc, "Wrong number of arguments passed (tuning sample size not found)", parse_options);
+            ASSERT(sscanf(argv[i], "%zu", &options->tune_sample) == 1 && options->tune_sample > 1, "Unable to parse the tuning sample size", parse_options);
+        }
+        else
+        {
+            PRINT_ERROR("Unknown option", parse_options);
+        }
+    }
+
+    return i - 1;
+}
+
+/**
+ * The thresholds measured while tuning a field.
+ */
+typedef struct TuneMeasures
+{
+    size_t thresholds[TUNE_MAX_MEASURES]; /** The measured thresholds. */
+    double seconds[TUNE_MAX_MEASURES];    /** The sorting time of each measured threshold. */
+    size_t count;                         /** The number of measured thresholds. */
+} TuneMeasures;
+
+/**
+ * Measures the sorting time with the threshold 2^`threshold_log2` (the fastest of some repetitions).
+ */
+static double measure_threshold(FieldId field_id, size_t num_records, double threshold_log2, TuneMeasures *measures)
+{
+    size_t threshold, i;
+    double seconds, best;
+
+    threshold = (size_t)(pow(2.0, threshold_log2) + 0.5);
+
+    // Close points of the search space round to the same threshold.
+    for (i = 0; i < measures->count; i++)
+    {
+        if (measures->thresholds[i] == threshold)
+            return measures->seconds[i];
+    }
+
+    best = -1;
+
+    for (i = 0; i < TUNE_REPETITIONS; i++)
+    {
+        seconds = measure__records_sorter(field_id, ALGORITHM_MERGEBININSSORT, num_records, (void *)threshold);
+
+        if (best < 0 || seconds < best)
+            best = seconds;
+    }
+
+    printf("[PROFILER]<field=%s, tuning>: threshold %zu sorted in %f seconds.\n", get_field_name(field_id), threshold, best);
+
+    if (measures->count < TUNE_MAX_MEASURES)
+    {
+        measures->thresholds[measures->count] = threshold;
+        measures->seconds[measures->count++] = best;
+    }
+
+    return best;
+}
+
+/**
+ * Searches the fastest merge binary insertion sort threshold for the specified field, with a golden-section search
+ * over the logarithm of the threshold.
+ */
+static size_t tune_threshold(FieldId field_id, size_t num_records)
+{
+    const double inv_phi = 0.6180339887498949;
+    TuneMeasures measures;
+    double lower, upper, left, right, left_seconds, right_seconds;
+    size_t i, best;
+
+    measures.count = 0;
+    lower = TUNE_MIN_LOG2;
+    upper = TUNE_MAX_LOG2;
+    left = upper - inv_phi * (upper - lower);
+    right = lower + inv_phi * (upper - lower);
+    left_seconds = measure_threshold(field_id, num_records, left, &measures);
+    right_seconds = measure_threshold(field_id, num_records, right, &measures);
+
+    while (upper - lower > TUNE_TOLERANCE_LOG2)
+    {
+        if (left_seconds < right_seconds)
+        {
+            upper = right;
+            right = left;
+            right_seconds = left_seconds;
+            left = upper - inv_phi * (upper - lower);
+            left_seconds = measure_threshold(field_id, num_records, left, &measures);
+        }
+        else
+        {
+            lower = left;
+            left = right;
+            left_seconds = right_seconds;
+            right = lower + inv_phi * (upper - lower);
+            right_seconds = measure_threshold(field_id, num_records, right, &measures);
+        }
+    }
+
+    best = 0;
+
+    for (i = 1; i < measures.count; i++)
+    {
+        if (measures.seconds[i] < measures.seconds[best])
+            best = i;
+    }
+
+    return measures.thresholds[best];
+}
+
+/**
+ * Tunes the merge binary insertion sort threshold of every field, writing them to the tuning configuration file.
+ */
+static void tune_execution(const char *in_path, size_t sample)
+{
+    static const FieldId fields[] = {FIELD_STRING, FIELD_INTEGER, FIELD_FLOAT};
+    FILE *input_file;
+    size_t num_records, threshold, i;
+    const char *config_path;
+
+    input_file = open_input_file(in_path);
+
+    init_profiler__records_sorter(input_file, &num_records);
+
+    ASSERT(!fclose(input_file), "Unable to close the input file", tune_execution);
+
+    if (sample > num_records)
+        sample = num_records;
+
+    config_path = get_tuning_config_path();
+    printf("[PROFILER]: Tuning thresholds over %zu records...\n", sample);
+
+    for (i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+    {
+        threshold = tune_threshold(fields[i], sample);
+        write_tuned_threshold(config_path, get_field_name(fields[i]), get_record_size__records_sorter(fields[i]), threshold);
+
+        printf("[PROFILER]<field=%s>: Tuned threshold %zu written to '%s'.\n", get_field_name(fields[i]), threshold, config_path);
+    }
+
+    shutdown_profiler__records_sorter();
+}
+
 static void profile_execution(const char *in_path, size_t *thresholds, size_t num_thresholds)
 {
     FILE *input_file;
     size_t num_records;
     size_t i;
 
-    input_file = fopen(in_path, "r");
-    ASSERT(input_file, "Unable to open the input file", profile_execution);
+    input_file = open_input_file(in_path);
 
     init_profiler__records_sorter(input_file, &num_records);
 
@@ -113,11 +328,25 @@ int main(int argc, char *argv[])
     const char *in_path;
     size_t *thresholds, thresholds_count;
     size_t i;
+    int num_options;
+    ProfilerOptions options;
+
+    num_options = parse_options(argc, argv, &options);
+    argv[num_options] = argv[0];
+    argv += num_options;
+    argc -= num_options;
 
     ASSERT(argc > ARG_INPUT_FILE_PATH, "Wrong number of arguments passed (input file path not found)", main);
 
     in_path = argv[ARG_INPUT_FILE_PATH];
 
+    if (options.tune)
+    {
+        tune_execution(in_path, options.tune_sample);
+        perf_counters_close();
+        return EXIT_SUCCESS;
+    }
+
     thresholds = NULL;
     thresholds_count = (argc - OPTARG_FIRST_THRESHOLD);
 
@@ -130,7 +359,7 @@ int main(int argc, char *argv[])
     for (i = OPTARG_FIRST_THRESHOLD; i < OPTARG_FIRST_THRESHOLD + thresholds_count; i++)
     {
         ASSERT(sscanf(argv[i], "%zu", &thresholds[i - OPTARG_FIRST_THRESHOLD]), "Unable to parse a sorting threshold", main);
-        ASSERT(thresholds[i] > 1, "A sorting threshold must be greater than one", main);
+        ASSERT(thresholds[i - OPTARG_FIRST_THRESHOLD] > 1, "A sorting threshold must be greater than one", main);
     }
 
     profile_execution(in_path, thresholds, thresholds_count);
@@ -138,5 +367,7 @@ int main(int argc, char *argv[])
     if (thresholds)
         free(thresholds);
 
+    perf_counters_close();
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
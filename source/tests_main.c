@@ -1,7 +1,12 @@
 #include <time.h>
 #include <stdlib.h>
+#include <string.h>
 #include "unity.h"
 #include "sorting.h"
+#include "sorter.h"
+#include "merger.h"
+#include "records-sorter.h"
+#include "records-arena.h"
 
 /*---------------------------------------------------------------------------------------------------------------*/
 
@@ -677,6 +682,1007 @@ static void merge_binary_insertion_sort_test_string_array_1000000(void)
 
 /*---------------------------------------------------------------------------------------------------------------*/
 
+// PURPOSE: Returns 1 if the first k elements are sorted and not greater than the remaining ones, 0 otherwise.
+static int is_array_partially_sorted(const void *arr, size_t count, size_t size, size_t k, compare_fn comparator)
+{
+    size_t i;
+
+    if (k > count)
+        k = count;
+
+    if (!is_array_sorted(arr, k, size, comparator))
+        return 0;
+
+    for (i = k; i < count && k > 0; i++)
+    {
+        if (comparator(GET_ELEMENT(arr, k - 1, size), GET_ELEMENT(arr, i, size)) > 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+static void partial_sort_int_array_test(size_t size, size_t k)
+{
+    int *array;
+    size_t i;
+
+    array = malloc(sizeof(int) * size);
+
+    for (i = 0; i < size; i++)
+        array[i] = rand_int();
+
+    partial_sort(array, size, sizeof(int), k, int_comparator);
+
+    TEST_ASSERT_TRUE(is_array_partially_sorted(array, size, sizeof(int), k, int_comparator));
+
+    free(array);
+}
+
+static void partial_sort_test_int_array_1000_k_1(void)
+{
+    partial_sort_int_array_test(1000, 1);
+}
+
+static void partial_sort_test_int_array_1000_k_10(void)
+{
+    partial_sort_int_array_test(1000, 10);
+}
+
+static void partial_sort_test_int_array_1000_k_1000(void)
+{
+    partial_sort_int_array_test(1000, 1000);
+}
+
+static void partial_sort_test_int_array_1000_k_5000(void)
+{
+    partial_sort_int_array_test(1000, 5000);
+}
+
+static void partial_sort_test_int_array_1000000_k_1000(void)
+{
+    partial_sort_int_array_test(1000000, 1000);
+}
+
+static void partial_sort_float_array_test(size_t size, size_t k)
+{
+    float *array;
+    size_t i;
+
+    array = malloc(sizeof(float) * size);
+
+    for (i = 0; i < size; i++)
+        array[i] = rand_float();
+
+    partial_sort(array, size, sizeof(float), k, float_comparator);
+
+    TEST_ASSERT_TRUE(is_array_partially_sorted(array, size, sizeof(float), k, float_comparator));
+
+    free(array);
+}
+
+static void partial_sort_test_float_array_100000_k_100(void)
+{
+    partial_sort_float_array_test(100000, 100);
+}
+
+static void partial_sort_string_array_test(size_t size, size_t k)
+{
+    char **array;
+    size_t i;
+
+    array = malloc(sizeof(char *) * size);
+
+    for (i = 0; i < size; i++)
+        array[i] = rand_string();
+
+    partial_sort(array, size, sizeof(char *), k, dyn_string_comparator);
+
+    TEST_ASSERT_TRUE(is_array_partially_sorted(array, size, sizeof(char *), k, dyn_string_comparator));
+
+    for (i = 0; i < size; i++)
+        free(array[i]);
+
+    free(array);
+}
+
+static void partial_sort_test_string_array_100000_k_100(void)
+{
+    partial_sort_string_array_test(100000, 100);
+}
+
+/*---------------------------------------------------------------------------------------------------------------*/
+
+// PURPOSE: Returns 1 if the element at index nth is in its sorted position (no greater elements before it, no
+// smaller elements after it), 0 otherwise.
+static int is_element_selected(const void *arr, size_t count, size_t size, size_t nth, compare_fn comparator)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (i < nth && comparator(GET_ELEMENT(arr, i, size), GET_ELEMENT(arr, nth, size)) > 0)
+            return 0;
+
+        if (i > nth && comparator(GET_ELEMENT(arr, i, size), GET_ELEMENT(arr, nth, size)) < 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+static void nth_element_int_array_test(size_t size, size_t nth)
+{
+    int *array, *sorted;
+    size_t i;
+
+    array = malloc(sizeof(int) * size);
+    sorted = malloc(sizeof(int) * size);
+
+    for (i = 0; i < size; i++)
+        array[i] = sorted[i] = rand_int();
+
+    nth_element(array, size, sizeof(int), nth, int_comparator);
+    merge_sort(sorted, size, sizeof(int), int_comparator);
+
+    TEST_ASSERT_TRUE(is_element_selected(array, size, sizeof(int), nth, int_comparator));
+    TEST_ASSERT_EQUAL_INT(sorted[nth], array[nth]);
+
+    free(array);
+    free(sorted);
+}
+
+static void nth_element_test_int_array_1_nth_0(void)
+{
+    nth_element_int_array_test(1, 0);
+}
+
+static void nth_element_test_int_array_1000_nth_0(void)
+{
+    nth_element_int_array_test(1000, 0);
+}
+
+static void nth_element_test_int_array_1000_nth_500(void)
+{
+    nth_element_int_array_test(1000, 500);
+}
+
+static void nth_element_test_int_array_1000_nth_999(void)
+{
+    nth_element_int_array_test(1000, 999);
+}
+
+static void nth_element_test_int_array_1000000_nth_990000(void)
+{
+    nth_element_int_array_test(1000000, 990000);
+}
+
+static void nth_element_test_sorted_int_array_100000(void)
+{
+    int *array;
+    size_t i;
+
+    array = malloc(sizeof(int) * 100000);
+
+    for (i = 0; i < 100000; i++)
+        array[i] = (int)(100000 - i);
+
+    nth_element(array, 100000, sizeof(int), 50000, int_comparator);
+
+    TEST_ASSERT_EQUAL_INT(50001, array[50000]);
+    TEST_ASSERT_TRUE(is_element_selected(array, 100000, sizeof(int), 50000, int_comparator));
+
+    free(array);
+}
+
+static void select_quantiles_float_array_test(size_t size)
+{
+    float *array, *sorted;
+    size_t ranks[4], i;
+
+    array = malloc(sizeof(float) * size);
+    sorted = malloc(sizeof(float) * size);
+
+    for (i = 0; i < size; i++)
+        array[i] = sorted[i] = rand_float();
+
+    ranks[0] = 0;
+    ranks[1] = size / 2;
+    ranks[2] = size * 9 / 10;
+    ranks[3] = size * 99 / 100;
+
+    select_quantiles(array, size, sizeof(float), ranks, 4, float_comparator);
+    merge_sort(sorted, size, sizeof(float), float_comparator);
+
+    for (i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_TRUE(is_element_selected(array, size, sizeof(float), ranks[i], float_comparator));
+        TEST_ASSERT_TRUE(float_comparator(&sorted[ranks[i]], &array[ranks[i]]) == 0);
+    }
+
+    free(array);
+    free(sorted);
+}
+
+static void select_quantiles_test_float_array_1000(void)
+{
+    select_quantiles_float_array_test(1000);
+}
+
+static void select_quantiles_test_float_array_100000(void)
+{
+    select_quantiles_float_array_test(100000);
+}
+
+/*---------------------------------------------------------------------------------------------------------------*/
+
+#define ELEMENT_SIZES_ARRAY_SIZE 1000
+
+// PURPOSE: Fills an element of `size` bytes with an int key followed by payload bytes derived from the key.
+static void fill_sized_element(unsigned char *element, size_t size, int key)
+{
+    size_t i;
+
+    memcpy(element, &key, sizeof(int));
+
+    for (i = sizeof(int); i < size; i++)
+        element[i] = (unsigned char)(key * 31 + i);
+}
+
+// PURPOSE: Returns 1 if the payload of every element still matches its key (i.e., elements were moved whole).
+static int are_sized_elements_whole(const unsigned char *array, size_t count, size_t size)
+{
+    size_t i, j;
+    int key;
+
+    for (i = 0; i < count; i++, array += size)
+    {
+        memcpy(&key, array, sizeof(int));
+
+        for (j = sizeof(int); j < size; j++)
+        {
+            if (array[j] != (unsigned char)(key * 31 + j))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void element_sizes_test(void)
+{
+    // Sizes with a specialised move and swap, multiples of the word size and odd sizes of the generic routines.
+    static const size_t SIZES[] = {4, 8, 12, 16, 24, 32, 44, 48, 72, 128, 260};
+    unsigned char *array;
+    size_t i, j, algorithm;
+
+    for (i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++)
+    {
+        array = malloc(SIZES[i] * ELEMENT_SIZES_ARRAY_SIZE);
+
+        for (algorithm = 0; algorithm < 4; algorithm++)
+        {
+            for (j = 0; j < ELEMENT_SIZES_ARRAY_SIZE; j++)
+                fill_sized_element(array + j * SIZES[i], SIZES[i], rand_int());
+
+            if (algorithm == 0)
+                merge_sort(array, ELEMENT_SIZES_ARRAY_SIZE, SIZES[i], int_comparator);
+            else if (algorithm == 1)
+                quick_sort(array, ELEMENT_SIZES_ARRAY_SIZE, SIZES[i], int_comparator);
+            else if (algorithm == 2)
+                merge_binary_insertion_sort(array, ELEMENT_SIZES_ARRAY_SIZE, SIZES[i], 16, int_comparator);
+            else
+                partial_sort(array, ELEMENT_SIZES_ARRAY_SIZE, SIZES[i], ELEMENT_SIZES_ARRAY_SIZE, int_comparator);
+
+            TEST_ASSERT_TRUE(is_array_sorted(array, ELEMENT_SIZES_ARRAY_SIZE, SIZES[i], int_comparator));
+            TEST_ASSERT_TRUE(are_sized_elements_whole(array, ELEMENT_SIZES_ARRAY_SIZE, SIZES[i]));
+        }
+
+        free(array);
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------------*/
+
+#define AUTO_ARRAY_SIZE 100000
+
+// PURPOSE: Fills records sorted by their integer field.
+static Record *create_sorted_records(size_t count)
+{
+    Record *records;
+    size_t i;
+
+    records = calloc(count, sizeof(Record));
+
+    for (i = 0; i < count; i++)
+    {
+        records[i].id = (int)i;
+        records[i].field2 = (int)i;
+    }
+
+    return records;
+}
+
+static void select_records_algorithm_test_sorted(void)
+{
+    Record *records;
+
+    records = create_sorted_records(AUTO_ARRAY_SIZE);
+
+    TEST_ASSERT_EQUAL_INT(ALGORITHM_BININSSORT, select_records_algorithm(records, AUTO_ARRAY_SIZE, FIELD_INTEGER));
+
+    free(records);
+}
+
+static void select_records_algorithm_test_few_swaps(void)
+{
+    // Adjacent swaps far apart from each other (and from the sampled windows), which the sampled pairs miss.
+    static const size_t SWAPS[] = {12345, 37000, 61234, 88000};
+    Record *records, record;
+    size_t i;
+
+    records = create_sorted_records(AUTO_ARRAY_SIZE);
+
+    for (i = 0; i < sizeof(SWAPS) / sizeof(SWAPS[0]); i++)
+    {
+        record = records[SWAPS[i]];
+        records[SWAPS[i]] = records[SWAPS[i] + 1];
+        records[SWAPS[i] + 1] = record;
+    }
+
+    TEST_ASSERT_EQUAL_INT(ALGORITHM_MERGEBININSSORT, select_records_algorithm(records, AUTO_ARRAY_SIZE, FIELD_INTEGER));
+
+    free(records);
+}
+
+/*---------------------------------------------------------------------------------------------------------------*/
+
+// PURPOSE: An element whose position in the input is kept, to check the stability of a sort.
+typedef struct KeyedElement
+{
+    int key;
+    size_t index;
+} KeyedElement;
+
+// PURPOSE: Compares two keyed elements by their key only.
+static int keyed_element_comparator(const void *left, const void *right)
+{
+    return int_comparator(&((const KeyedElement *)left)->key, &((const KeyedElement *)right)->key);
+}
+
+static void sorter_sort_test_reused_int_arrays(void)
+{
+    static const int SIZES[] = {10, 100000, 1000, 10, 1000000, 100};
+    SorterOptions options;
+    Sorter *sorter;
+    int *array, *expected;
+    size_t i, j;
+
+    init_sorter_options(&options);
+    options.num_threads = 4;
+    options.parallel_threshold = 1000;
+    sorter = create_sorter(&options);
+
+    // The same sorter (and scratch memory) sorts arrays of growing and shrinking sizes, sequentially and in parallel.
+    for (i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++)
+    {
+        array = malloc(sizeof(int) * SIZES[i]);
+        expected = malloc(sizeof(int) * SIZES[i]);
+
+        for (j = 0; j < (size_t)SIZES[i]; j++)
+            array[j] = expected[j] = rand_int();
+
+        sorter_sort(sorter, array, SIZES[i], sizeof(int), int_comparator);
+        merge_sort(expected, SIZES[i], sizeof(int), int_comparator);
+
+        TEST_ASSERT_EQUAL_INT_ARRAY(expected, array, SIZES[i]);
+
+        free(array);
+        free(expected);
+    }
+
+    destroy_sorter(sorter);
+}
+
+static void sorter_sort_test_stability_parallel(void)
+{
+    SorterOptions options;
+    Sorter *sorter;
+    KeyedElement *array;
+    size_t i, size = 100003;
+
+    init_sorter_options(&options);
+    options.num_threads = 3;
+    options.threshold = 1;
+    options.parallel_threshold = 1;
+    sorter = create_sorter(&options);
+
+    array = malloc(sizeof(KeyedElement) * size);
+
+    for (i = 0; i < size; i++)
+    {
+        array[i].key = rand_int() % 16;
+        array[i].index = i;
+    }
+
+    sorter_sort(sorter, array, size, sizeof(KeyedElement), keyed_element_comparator);
+
+    TEST_ASSERT_TRUE(is_array_sorted(array, size, sizeof(KeyedElement), keyed_element_comparator));
+
+    for (i = 1; i < size; i++)
+    {
+        if (array[i - 1].key == array[i].key)
+            TEST_ASSERT_TRUE(array[i - 1].index < array[i].index);
+    }
+
+    free(array);
+    destroy_sorter(sorter);
+}
+
+/*---------------------------------------------------------------------------------------------------------------*/
+
+#ifndef DISABLE_MERGER
+
+// PURPOSE: A sorted source of keyed elements, read by `merger_next`.
+typedef struct MergeRun
+{
+    const KeyedElement *elements;
+    size_t length;
+    size_t position;
+} MergeRun;
+
+// PURPOSE: Retrieves the next element of a run (NULL once exhausted).
+static const void *next_run_element(void *source)
+{
+    MergeRun *run = (MergeRun *)source;
+
+    return run->position < run->length ? &run->elements[run->position++] : NULL;
+}
+
+// PURPOSE: Merges the specified runs of keyed elements, returning the number of merged elements.
+static size_t merge_runs(MergeRun *runs, size_t num_runs, KeyedElement *merged)
+{
+    void *sources[8];
+    Merger *merger;
+    const KeyedElement *element;
+    size_t i, count;
+
+    for (i = 0; i < num_runs; i++)
+        sources[i] = &runs[i];
+
+    merger = create_merger(sources, num_runs, next_run_element, keyed_element_comparator);
+
+    for (count = 0; (element = merger_next(merger)); count++)
+        merged[count] = *element;
+
+    // An exhausted merger keeps returning NULL.
+    if (merger_next(merger))
+        count = (size_t)-1;
+
+    destroy_merger(merger);
+    return count;
+}
+
+static void merger_test_single_source(void)
+{
+    KeyedElement elements[100], merged[100];
+    MergeRun run;
+    size_t i;
+
+    for (i = 0; i < 100; i++)
+    {
+        elements[i].key = (int)(i / 3);
+        elements[i].index = i;
+    }
+
+    run.elements = elements;
+    run.length = 100;
+    run.position = 0;
+
+    TEST_ASSERT_EQUAL_size_t(100, merge_runs(&run, 1, merged));
+
+    for (i = 0; i < 100; i++)
+        TEST_ASSERT_TRUE(merged[i].key == elements[i].key && merged[i].index == elements[i].index);
+}
+
+static void merger_test_empty_sources(void)
+{
+    KeyedElement elements[3], merged[3];
+    MergeRun runs[4];
+    size_t i;
+
+    for (i = 0; i < 3; i++)
+    {
+        elements[i].key = (int)i;
+        elements[i].index = i;
+    }
+
+    // Every source is empty.
+    for (i = 0; i < 4; i++)
+    {
+        runs[i].elements = elements;
+        runs[i].length = 0;
+        runs[i].position = 0;
+    }
+
+    TEST_ASSERT_EQUAL_size_t(0, merge_runs(runs, 4, merged));
+
+    // The empty sources (first, third and last) are skipped.
+    runs[1].length = 3;
+    TEST_ASSERT_EQUAL_size_t(3, merge_runs(runs, 4, merged));
+
+    for (i = 0; i < 3; i++)
+        TEST_ASSERT_EQUAL_INT((int)i, merged[i].key);
+}
+
+static void merger_test_unequal_runs(void)
+{
+    static const size_t LENGTHS[] = {1, 1000, 37, 0, 500, 2};
+    KeyedElement *elements, *merged, *expected;
+    MergeRun runs[sizeof(LENGTHS) / sizeof(LENGTHS[0])];
+    size_t i, total, offset;
+
+    for (i = 0, total = 0; i < sizeof(LENGTHS) / sizeof(LENGTHS[0]); i++)
+        total += LENGTHS[i];
+
+    elements = malloc(sizeof(KeyedElement) * total);
+    merged = malloc(sizeof(KeyedElement) * total);
+    expected = malloc(sizeof(KeyedElement) * total);
+
+    for (i = 0; i < total; i++)
+    {
+        elements[i].key = rand_int();
+        elements[i].index = i;
+    }
+
+    memcpy(expected, elements, sizeof(KeyedElement) * total);
+    merge_sort(expected, total, sizeof(KeyedElement), keyed_element_comparator);
+
+    for (i = 0, offset = 0; i < sizeof(LENGTHS) / sizeof(LENGTHS[0]); offset += LENGTHS[i++])
+    {
+        if (LENGTHS[i] > 0)
+            merge_sort(elements + offset, LENGTHS[i], sizeof(KeyedElement), keyed_element_comparator);
+
+        runs[i].elements = elements + offset;
+        runs[i].length = LENGTHS[i];
+        runs[i].position = 0;
+    }
+
+    // Merging the sorted runs of a stable sort is the same as stably sorting their concatenation.
+    TEST_ASSERT_EQUAL_size_t(total, merge_runs(runs, sizeof(LENGTHS) / sizeof(LENGTHS[0]), merged));
+
+    for (i = 0; i < total; i++)
+        TEST_ASSERT_TRUE(merged[i].key == expected[i].key && merged[i].index == expected[i].index);
+
+    free(elements);
+    free(merged);
+    free(expected);
+}
+
+static void merger_test_ties_by_source_order(void)
+{
+    KeyedElement elements[5][40], merged[200];
+    MergeRun runs[5];
+    size_t i, j;
+
+    // Every source holds the same keys, each element remembering its source and position.
+    for (i = 0; i < 5; i++)
+    {
+        for (j = 0; j < 40; j++)
+        {
+            elements[i][j].key = (int)(j / 4);
+            elements[i][j].index = i * 40 + j;
+        }
+
+        runs[i].elements = elements[i];
+        runs[i].length = 40;
+        runs[i].position = 0;
+    }
+
+    TEST_ASSERT_EQUAL_size_t(200, merge_runs(runs, 5, merged));
+    TEST_ASSERT_TRUE(is_array_sorted(merged, 200, sizeof(KeyedElement), keyed_element_comparator));
+
+    // Equal keys come from the first source to the last one, in their order inside each source.
+    for (i = 1; i < 200; i++)
+    {
+        if (merged[i - 1].key == merged[i].key)
+            TEST_ASSERT_TRUE(merged[i - 1].index < merged[i].index);
+    }
+}
+
+#endif
+
+/*---------------------------------------------------------------------------------------------------------------*/
+
+#ifndef DISABLE_STRING_KEYS
+
+#define KEYED_LINE_LEN 2048
+
+// PURPOSE: Compares two string fields stored with the specified sort key flags, as the string arena sort does.
+static int compare_keyed_strings(const char *left, const char *right, int key_flags)
+{
+    char line[KEYED_LINE_LEN];
+    ArenaRecord records[2];
+    StringArena *arena;
+    int result;
+
+    arena = create_string_arena(0);
+
+    snprintf(line, sizeof(line), "0,%s,0,0.0\n", left);
+    parse_arena_record_csv(line, &records[0], arena, key_flags);
+    snprintf(line, sizeof(line), "1,%s,0,0.0\n", right);
+    parse_arena_record_csv(line, &records[1], arena, key_flags);
+
+    result = get_arena_records_comparator(arena, FIELD_STRING)(&records[0], &records[1]);
+
+    destroy_string_arena(arena);
+    return result;
+}
+
+// PURPOSE: Fills a string with a prefix followed by a number of `count` digits (its first digit, then `rest`).
+static void make_number_string(char *dest, const char *prefix, char first, char rest, size_t count)
+{
+    size_t len;
+
+    len = strlen(prefix);
+    memcpy(dest, prefix, len);
+    memset(dest + len, rest, count);
+    dest[len] = first;
+    dest[len + count] = '\0';
+}
+
+static void string_keys_test_natural_order(void)
+{
+    // Runs of digits compare by their value, not byte by byte.
+    TEST_ASSERT_TRUE(compare_keyed_strings("item2", "item10", STRING_KEY_NATURAL) < 0);
+    TEST_ASSERT_TRUE(compare_keyed_strings("item2", "item10", STRING_KEY_NONE) > 0);
+    TEST_ASSERT_TRUE(compare_keyed_strings("item10", "item10b", STRING_KEY_NATURAL) < 0);
+    TEST_ASSERT_TRUE(compare_keyed_strings("v1.10", "v1.9", STRING_KEY_NATURAL) > 0);
+    TEST_ASSERT_TRUE(compare_keyed_strings("0", "00", STRING_KEY_NATURAL) < 0);
+}
+
+static void string_keys_test_leading_zeros(void)
+{
+    // Leading zeros are ignored by the key, so "a01" and "a1" are only ordered by their bytes.
+    TEST_ASSERT_TRUE(compare_keyed_strings("a01", "a1", STRING_KEY_NATURAL) < 0);
+    TEST_ASSERT_TRUE(compare_keyed_strings("a1", "a01", STRING_KEY_NATURAL) > 0);
+    TEST_ASSERT_TRUE(compare_keyed_strings("a01", "a01", STRING_KEY_NATURAL) == 0);
+    TEST_ASSERT_TRUE(compare_keyed_strings("a009", "a10", STRING_KEY_NATURAL) < 0);
+    TEST_ASSERT_TRUE(compare_keyed_strings("a01b", "a1a", STRING_KEY_NATURAL) > 0);
+}
+
+static void string_keys_test_fold_case(void)
+{
+    // Folded letters compare equal, so "A" and "a" are only ordered by their bytes.
+    TEST_ASSERT_TRUE(compare_keyed_strings("A", "a", STRING_KEY_FOLD_CASE) < 0);
+    TEST_ASSERT_TRUE(compare_keyed_strings("a", "A", STRING_KEY_FOLD_CASE) > 0);
+    TEST_ASSERT_TRUE(compare_keyed_strings("a", "B", STRING_KEY_FOLD_CASE) < 0);
+    TEST_ASSERT_TRUE(compare_keyed_strings("a", "B", STRING_KEY_NONE) > 0);
+    TEST_ASSERT_TRUE(compare_keyed_strings("ITEM2", "item10", STRING_KEY_FOLD_CASE | STRING_KEY_NATURAL) < 0);
+}
+
+static void string_keys_test_long_digit_runs(void)
+{
+    // The lengths around the continuation bytes of the digit count (255, then 255 + 254).
+    static const size_t LENGTHS[] = {2, 253, 254, 255, 256, 300, 508, 509, 510, 1000};
+    char shorter[KEYED_LINE_LEN / 2], longer[KEYED_LINE_LEN / 2];
+    size_t i;
+
+    for (i = 0; i < sizeof(LENGTHS) / sizeof(LENGTHS[0]); i++)
+    {
+        // A longer number is greater, whatever its digits.
+        make_number_string(shorter, "x", '9', '9', LENGTHS[i] - 1);
+        make_number_string(longer, "x", '1', '0', LENGTHS[i]);
+        TEST_ASSERT_TRUE(compare_keyed_strings(shorter, longer, STRING_KEY_NATURAL) < 0);
+        TEST_ASSERT_TRUE(compare_keyed_strings(longer, shorter, STRING_KEY_NATURAL) > 0);
+
+        // Numbers of the same length compare by their digits.
+        make_number_string(shorter, "x", '1', '9', LENGTHS[i]);
+        make_number_string(longer, "x", '2', '0', LENGTHS[i]);
+        TEST_ASSERT_TRUE(compare_keyed_strings(shorter, longer, STRING_KEY_NATURAL) < 0);
+    }
+}
+
+#endif
+
+/*---------------------------------------------------------------------------------------------------------------*/
+
+#ifndef DISABLE_STRING_ARENA
+
+#define INTERNED_ARRAY_SIZE 10000
+#define INTERNED_DISTINCT_STRINGS 50
+
+static void string_arena_test_interned_offsets(void)
+{
+    StringArena *interning, *plain;
+    StringRef first, second, other, slice;
+
+    interning = create_string_arena(1);
+    plain = create_string_arena(0);
+
+    // Equal strings (also when not null-terminated) share the reference of the first one.
+    first = add_arena_string(interning, "alpha", 5);
+    other = add_arena_string(interning, "beta", 4);
+    second = add_arena_string(interning, "alpha", 5);
+    slice = add_arena_string(interning, "alphabet", 5);
+
+    TEST_ASSERT_TRUE(first.offset == second.offset && first.length == second.length);
+    TEST_ASSERT_TRUE(first.offset == slice.offset && first.length == slice.length);
+    TEST_ASSERT_TRUE(first.offset != other.offset);
+    TEST_ASSERT_TRUE(!strcmp(get_arena_string(interning, second), "alpha"));
+    TEST_ASSERT_EQUAL_size_t(sizeof("alpha") + sizeof("beta"), get_string_arena_size(interning));
+
+    // Without interning, every string is stored again.
+    first = add_arena_string(plain, "alpha", 5);
+    second = add_arena_string(plain, "alpha", 5);
+
+    TEST_ASSERT_TRUE(first.offset != second.offset);
+    TEST_ASSERT_TRUE(!strcmp(get_arena_string(plain, second), "alpha"));
+    TEST_ASSERT_EQUAL_size_t(2 * sizeof("alpha"), get_string_arena_size(plain));
+
+    destroy_string_arena(interning);
+    destroy_string_arena(plain);
+}
+
+// PURPOSE: Stably sorts records in an arena by their string field, returning their ids in sorted order.
+static int *sort_arena_records_ids(const Record *records, size_t count, int intern, int key_flags)
+{
+    StringArena *arena;
+    ArenaRecord *arena_records;
+    compare_fn comparator;
+    int *ids, sorted;
+    size_t i;
+
+    arena = create_string_arena(intern);
+    arena_records = malloc(sizeof(ArenaRecord) * count);
+    ids = malloc(sizeof(int) * count);
+
+    for (i = 0; i < count; i++)
+        to_arena_record(&records[i], &arena_records[i], arena, key_flags);
+
+    comparator = get_arena_records_comparator(arena, FIELD_STRING);
+    merge_sort(arena_records, count, sizeof(ArenaRecord), comparator);
+    sorted = is_array_sorted(arena_records, count, sizeof(ArenaRecord), comparator);
+
+    // An unsorted result is reported as negative ids.
+    for (i = 0; i < count; i++)
+        ids[i] = sorted ? arena_records[i].id : -1;
+
+    free(arena_records);
+    destroy_string_arena(arena);
+    return ids;
+}
+
+static void string_arena_test_interned_sort(void)
+{
+    static const int KEY_FLAGS[] = {STRING_KEY_NONE, STRING_KEY_FOLD_CASE | STRING_KEY_NATURAL};
+    Record *records;
+    int *interned, *plain;
+    size_t i, j;
+
+    records = malloc(sizeof(Record) * INTERNED_ARRAY_SIZE);
+
+    // Few distinct strings, so that most comparisons are between interned duplicates.
+    for (i = 0; i < INTERNED_ARRAY_SIZE; i++)
+    {
+        memset(&records[i], 0, sizeof(Record));
+        records[i].id = (int)i;
+        snprintf(records[i].field1, STRING_FIELD_LEN, rand_int() % 2 ? "Item%d" : "item%d", rand_int() % INTERNED_DISTINCT_STRINGS);
+    }
+
+    for (j = 0; j < sizeof(KEY_FLAGS) / sizeof(KEY_FLAGS[0]); j++)
+    {
+        interned = sort_arena_records_ids(records, INTERNED_ARRAY_SIZE, 1, KEY_FLAGS[j]);
+        plain = sort_arena_records_ids(records, INTERNED_ARRAY_SIZE, 0, KEY_FLAGS[j]);
+
+        TEST_ASSERT_TRUE(interned[0] >= 0 && plain[0] >= 0);
+        TEST_ASSERT_EQUAL_INT_ARRAY(plain, interned, INTERNED_ARRAY_SIZE);
+
+        free(interned);
+        free(plain);
+    }
+
+    free(records);
+}
+
+#endif
+
+/*---------------------------------------------------------------------------------------------------------------*/
+
+#ifdef _SORT_STATS
+
+#define STATS_ARRAY_SIZE 1000
+
+// PURPOSE: Returns the smallest integer not lower than log2(n).
+static size_t ceil_log2(size_t n)
+{
+    size_t log;
+
+    for (log = 0; ((size_t)1 << log) < n; log++)
+        ;
+
+    return log;
+}
+
+static void merge_sort_stats_test(void)
+{
+    int array[STATS_ARRAY_SIZE];
+    SortStats stats;
+    size_t i;
+
+    for (i = 0; i < STATS_ARRAY_SIZE; i++)
+        array[i] = rand_int();
+
+    merge_sort(array, STATS_ARRAY_SIZE, sizeof(int), int_comparator);
+    get_sort_stats(&stats);
+
+    TEST_ASSERT_TRUE(is_array_sorted(array, STATS_ARRAY_SIZE, sizeof(int), int_comparator));
+    TEST_ASSERT_TRUE(stats.comparisons <= STATS_ARRAY_SIZE * ceil_log2(STATS_ARRAY_SIZE));
+    TEST_ASSERT_TRUE(stats.allocations == STATS_ARRAY_SIZE - 1);
+    TEST_ASSERT_TRUE(stats.bytes_copied == stats.moves * sizeof(int));
+}
+
+static void quick_sort_stats_reset_test(void)
+{
+    int array[STATS_ARRAY_SIZE], copy[STATS_ARRAY_SIZE];
+    SortStats first, second;
+    size_t i;
+
+    for (i = 0; i < STATS_ARRAY_SIZE; i++)
+        array[i] = copy[i] = rand_int();
+
+    quick_sort(array, STATS_ARRAY_SIZE, sizeof(int), int_comparator);
+    get_sort_stats(&first);
+
+    quick_sort(copy, STATS_ARRAY_SIZE, sizeof(int), int_comparator);
+    get_sort_stats(&second);
+
+    TEST_ASSERT_TRUE(first.comparisons > 0);
+    TEST_ASSERT_TRUE(first.comparisons == second.comparisons);
+    TEST_ASSERT_TRUE(first.moves == second.moves);
+}
+
+static void binary_insertion_sort_sorted_stats_test(void)
+{
+    int array[STATS_ARRAY_SIZE];
+    SortStats stats;
+    size_t i;
+
+    for (i = 0; i < STATS_ARRAY_SIZE; i++)
+        array[i] = (int)i;
+
+    binary_insertion_sort(array, STATS_ARRAY_SIZE, sizeof(int), int_comparator);
+    get_sort_stats(&stats);
+
+    // An already sorted array requires no shifting, just saving and restoring each inserted element.
+    TEST_ASSERT_TRUE(is_array_sorted(array, STATS_ARRAY_SIZE, sizeof(int), int_comparator));
+    TEST_ASSERT_TRUE(stats.moves == 2 * (STATS_ARRAY_SIZE - 1));
+    TEST_ASSERT_TRUE(stats.comparisons <= (STATS_ARRAY_SIZE - 1) * (ceil_log2(STATS_ARRAY_SIZE) + 1));
+}
+
+static void merge_binary_insertion_sort_below_threshold_stats_test(void)
+{
+    int array[STATS_ARRAY_SIZE], copy[STATS_ARRAY_SIZE];
+    SortStats hybrid, insertion;
+    size_t i;
+
+    for (i = 0; i < STATS_ARRAY_SIZE; i++)
+        array[i] = copy[i] = rand_int();
+
+    merge_binary_insertion_sort(array, STATS_ARRAY_SIZE, sizeof(int), STATS_ARRAY_SIZE, int_comparator);
+    get_sort_stats(&hybrid);
+
+    binary_insertion_sort(copy, STATS_ARRAY_SIZE, sizeof(int), int_comparator);
+    get_sort_stats(&insertion);
+
+    TEST_ASSERT_TRUE(hybrid.comparisons == insertion.comparisons);
+    TEST_ASSERT_TRUE(hybrid.moves == insertion.moves);
+}
+
+static void merge_binary_insertion_sort_above_threshold_stats_test(void)
+{
+    int array[STATS_ARRAY_SIZE], copy[STATS_ARRAY_SIZE];
+    SortStats hybrid, merge;
+    size_t i;
+
+    for (i = 0; i < STATS_ARRAY_SIZE; i++)
+        array[i] = copy[i] = rand_int();
+
+    merge_binary_insertion_sort(array, STATS_ARRAY_SIZE, sizeof(int), 16, int_comparator);
+    get_sort_stats(&hybrid);
+
+    merge_sort(copy, STATS_ARRAY_SIZE, sizeof(int), int_comparator);
+    get_sort_stats(&merge);
+
+    // The partitions below the threshold are sorted by insertion, so fewer merges (and merge buffers) are needed.
+    TEST_ASSERT_TRUE(is_array_sorted(array, STATS_ARRAY_SIZE, sizeof(int), int_comparator));
+    TEST_ASSERT_TRUE(hybrid.allocations < merge.allocations);
+}
+
+static void quick_sort_no_allocations_stats_test(void)
+{
+    int array[STATS_ARRAY_SIZE];
+    SortStats stats;
+    size_t i;
+
+    for (i = 0; i < STATS_ARRAY_SIZE; i++)
+        array[i] = rand_int();
+
+    quick_sort(array, STATS_ARRAY_SIZE, sizeof(int), int_comparator);
+    get_sort_stats(&stats);
+
+    // Elements are swapped through stack temporaries, so partitioning allocates nothing.
+    TEST_ASSERT_TRUE(is_array_sorted(array, STATS_ARRAY_SIZE, sizeof(int), int_comparator));
+    TEST_ASSERT_TRUE(stats.allocations == 0);
+}
+
+static void merge_binary_insertion_sort_scratch_stats_test(void)
+{
+    int array[STATS_ARRAY_SIZE], copy[STATS_ARRAY_SIZE], scratch[STATS_ARRAY_SIZE + 1];
+    SortStats stats;
+    size_t i;
+
+    for (i = 0; i < STATS_ARRAY_SIZE; i++)
+        array[i] = copy[i] = rand_int();
+
+    merge_binary_insertion_sort_scratch(array, STATS_ARRAY_SIZE, sizeof(int), 16, int_comparator, scratch);
+    get_sort_stats(&stats);
+
+    merge_binary_insertion_sort(copy, STATS_ARRAY_SIZE, sizeof(int), 16, int_comparator);
+
+    // The same order as the allocating sort, with every merge done through the provided scratch memory.
+    TEST_ASSERT_EQUAL_INT_ARRAY(copy, array, STATS_ARRAY_SIZE);
+    TEST_ASSERT_TRUE(stats.allocations == 0);
+}
+
+#ifndef DISABLE_SORTER
+
+#define SORTER_STATS_ARRAY_SIZE 100000
+
+static void sorter_sort_parallel_stats_test(void)
+{
+    SorterOptions options;
+    Sorter *sorter;
+    int *array, *copy;
+    SortStats first, second;
+    size_t i;
+
+    init_sorter_options(&options);
+    options.num_threads = 4;
+    options.parallel_threshold = 1000;
+    sorter = create_sorter(&options);
+    sorter_reserve(sorter, SORTER_STATS_ARRAY_SIZE, sizeof(int));
+
+    array = malloc(sizeof(int) * SORTER_STATS_ARRAY_SIZE);
+    copy = malloc(sizeof(int) * SORTER_STATS_ARRAY_SIZE);
+
+    for (i = 0; i < SORTER_STATS_ARRAY_SIZE; i++)
+        array[i] = copy[i] = rand_int();
+
+    sorter_sort(sorter, array, SORTER_STATS_ARRAY_SIZE, sizeof(int), int_comparator);
+    get_sort_stats(&first);
+
+    sorter_sort(sorter, copy, SORTER_STATS_ARRAY_SIZE, sizeof(int), int_comparator);
+    get_sort_stats(&second);
+
+    // The statistics of the slices and merges (run on several threads) are summed, the same for the same input.
+    TEST_ASSERT_TRUE(is_array_sorted(array, SORTER_STATS_ARRAY_SIZE, sizeof(int), int_comparator));
+    TEST_ASSERT_TRUE(first.comparisons == second.comparisons && first.moves == second.moves);
+    TEST_ASSERT_TRUE(first.comparisons >= SORTER_STATS_ARRAY_SIZE - 1);
+    TEST_ASSERT_TRUE(first.comparisons <= SORTER_STATS_ARRAY_SIZE * ceil_log2(SORTER_STATS_ARRAY_SIZE));
+    TEST_ASSERT_TRUE(first.allocations == 0);
+
+    free(array);
+    free(copy);
+    destroy_sorter(sorter);
+}
+
+#endif
+
+#endif
+
+/*---------------------------------------------------------------------------------------------------------------*/
+
 void setUp(void) {}
 
 void tearDown(void) {}
@@ -804,6 +1810,101 @@ int main(void)
     RUN_TEST(binary_insertion_sort_test_string_array_100000);
     RUN_TEST(binary_insertion_sort_test_string_array_1000000);
 
+#endif
+
+#ifndef DISABLE_PARTIAL_SORT
+
+    printf("====== TESTING 'partial_sort' ======\n");
+
+    RUN_TEST(partial_sort_test_int_array_1000_k_1);
+    RUN_TEST(partial_sort_test_int_array_1000_k_10);
+    RUN_TEST(partial_sort_test_int_array_1000_k_1000);
+    RUN_TEST(partial_sort_test_int_array_1000_k_5000);
+    RUN_TEST(partial_sort_test_int_array_1000000_k_1000);
+    RUN_TEST(partial_sort_test_float_array_100000_k_100);
+    RUN_TEST(partial_sort_test_string_array_100000_k_100);
+
+#endif
+
+#ifndef DISABLE_SELECTION
+
+    printf("====== TESTING 'nth_element' and 'select_quantiles' ======\n");
+
+    RUN_TEST(nth_element_test_int_array_1_nth_0);
+    RUN_TEST(nth_element_test_int_array_1000_nth_0);
+    RUN_TEST(nth_element_test_int_array_1000_nth_500);
+    RUN_TEST(nth_element_test_int_array_1000_nth_999);
+    RUN_TEST(nth_element_test_int_array_1000000_nth_990000);
+    RUN_TEST(nth_element_test_sorted_int_array_100000);
+    RUN_TEST(select_quantiles_test_float_array_1000);
+    RUN_TEST(select_quantiles_test_float_array_100000);
+
+#endif
+
+    printf("====== TESTING ELEMENT SIZES ======\n");
+
+    RUN_TEST(element_sizes_test);
+
+    printf("====== TESTING 'select_records_algorithm' ======\n");
+
+    RUN_TEST(select_records_algorithm_test_sorted);
+    RUN_TEST(select_records_algorithm_test_few_swaps);
+
+#ifndef DISABLE_SORTER
+
+    printf("====== TESTING 'sorter_sort' ======\n");
+
+    RUN_TEST(sorter_sort_test_reused_int_arrays);
+    RUN_TEST(sorter_sort_test_stability_parallel);
+
+#endif
+
+#ifndef DISABLE_MERGER
+
+    printf("====== TESTING 'merger' ======\n");
+
+    RUN_TEST(merger_test_single_source);
+    RUN_TEST(merger_test_empty_sources);
+    RUN_TEST(merger_test_unequal_runs);
+    RUN_TEST(merger_test_ties_by_source_order);
+
+#endif
+
+#ifndef DISABLE_STRING_KEYS
+
+    printf("====== TESTING STRING SORT KEYS ======\n");
+
+    RUN_TEST(string_keys_test_natural_order);
+    RUN_TEST(string_keys_test_leading_zeros);
+    RUN_TEST(string_keys_test_fold_case);
+    RUN_TEST(string_keys_test_long_digit_runs);
+
+#endif
+
+#ifndef DISABLE_STRING_ARENA
+
+    printf("====== TESTING STRING ARENA INTERNING ======\n");
+
+    RUN_TEST(string_arena_test_interned_offsets);
+    RUN_TEST(string_arena_test_interned_sort);
+
+#endif
+
+#ifdef _SORT_STATS
+
+    printf("====== TESTING SORT STATISTICS ======\n");
+
+    RUN_TEST(merge_sort_stats_test);
+    RUN_TEST(quick_sort_stats_reset_test);
+    RUN_TEST(binary_insertion_sort_sorted_stats_test);
+    RUN_TEST(merge_binary_insertion_sort_below_threshold_stats_test);
+    RUN_TEST(merge_binary_insertion_sort_above_threshold_stats_test);
+    RUN_TEST(quick_sort_no_allocations_stats_test);
+    RUN_TEST(merge_binary_insertion_sort_scratch_stats_test);
+#ifndef DISABLE_SORTER
+    RUN_TEST(sorter_sort_parallel_stats_test);
+#endif
+
 #endif
 
     return UNITY_END();